@@ -0,0 +1,494 @@
+#include "mock_reaper.h"
+#include "host_checks.h"
+#include "action_stats.h"
+#include "arena.h"
+#include "batch_api.h"
+#include "envelope_index.h"
+#include "log.h"
+#include "pipeline.h"
+#include "refresh.h"
+#include "track_meter.h"
+#include "actions/append_duplicate.h"
+#include "actions/automation_file.h"
+#include "actions/clean_envelope_points.h"
+#include "actions/level_to_target.h"
+#include "actions/normalize_items.h"
+#include "actions/setup_global_midisend.h"
+#include "actions/smart_midi_vel_adjust.h"
+#include "actions/smart_vol_adjust.h"
+#include "actions/switch_triplet_grid.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Runs the toolkit's actions against synthetic projects in the mock REAPER host and reports
+// wall-clock time per action, e.g.
+//   ethlt_bench --tracks 1000 --envelope-points 1000000 --notes 500000 --output results.json
+// With --check-only it runs the behaviour checks in host_checks.cpp instead and exits non-zero on
+// any failure.
+
+using namespace PROJECT_NAME;
+
+namespace
+{
+
+struct Scale
+{
+    int tracks = 1000;
+    int items = 100000;
+    int envelope_points = 1000000;
+    int notes = 500000;
+};
+
+struct Scenario
+{
+    const char *name;
+    void (*build)(const Scale &);
+    void (*run)();
+};
+
+struct Result
+{
+    const Scenario *scenario;
+    std::vector<double> samples_ms;
+    uint64_t objects_touched, arena_high_water;
+    int undo_points, console_messages, ui_refreshes;
+};
+
+// envelope values with long runs of equal values, so the cleaner has redundant points to remove
+void fill_envelope(mock::Envelope *env, int point_count, bool selected)
+{
+    env->points.reserve(point_count);
+    for (int i = 0; i < point_count; i++) {
+        const double value = ((i / 8) % 16) / 16.0;
+        env->points.push_back({i * 0.05, value, 0, 0, selected});
+    }
+}
+
+void build_tracks(const Scale &scale)
+{
+    for (int i = 0; i < scale.tracks; i++)
+        mock::add_track("Track " + std::to_string(i + 1))->selected = true;
+}
+
+void build_items(const Scale &scale)
+{
+    build_tracks(scale);
+    auto &tracks = mock::project().tracks;
+    for (int i = 0; i < scale.items; i++) {
+        mock::Track *track = tracks[i % tracks.size()].get();
+        mock::Item *item = mock::add_item(track, static_cast<double>(i / tracks.size()) * 2, 2);
+        item->selected = true;
+        mock::add_take(item);
+    }
+    mock::project().item_under_mouse = tracks[0]->items[0].get();
+}
+
+void build_track_envelopes(const Scale &scale)
+{
+    build_tracks(scale);
+    const int per_track = std::max(1, scale.envelope_points / scale.tracks);
+    for (auto &track : mock::project().tracks) {
+        mock::Envelope *env = mock::add_envelope(track.get(), "VOLENV2");
+        fill_envelope(env, per_track - per_track / 5, false);
+
+        mock::AutomationItem autoitem {0, 0, 10, {}};
+        for (int i = 0; i < per_track / 5; i++)
+            autoitem.points.push_back({i * 0.05, ((i / 8) % 4) / 4.0, 0, 0, false});
+        env->automation_items.push_back(std::move(autoitem));
+    }
+}
+
+void build_selected_envelope(const Scale &scale)
+{
+    mock::Track *track = mock::add_track("Envelope");
+    mock::Envelope *env = mock::add_envelope(track, "VOLENV2");
+    fill_envelope(env, scale.envelope_points, true);
+    mock::project().selected_envelope = env;
+    mock::project().cursor_context = 2;
+}
+
+void build_midi_take(const Scale &scale)
+{
+    mock::Track *track = mock::add_track("MIDI");
+    mock::Item *item = mock::add_item(track, 0, 60);
+    mock::Take *take = mock::add_take(item);
+    take->notes.reserve(scale.notes * 2);
+    for (int i = 0; i < scale.notes; i++)
+        take->notes.push_back({true, false, i * 120.0, i * 120.0 + 110, 0, 36 + i % 48, 1 + i % 127});
+    mock::project().midi_editor_take = take;
+}
+
+void build_midisend_warm(const Scale &scale)
+{
+    build_tracks(scale);
+    setup_global_midisend();
+}
+
+// a short phrase selected for filling: the first 8 seconds of every track, or the first notes
+void build_items_fill(const Scale &scale)
+{
+    build_items(scale);
+    for (auto &track : mock::project().tracks)
+        for (auto &item : track->items)
+            item->selected = item->position < 8;
+    mock::project().time_selection_end = 8 * 17;
+    SetExtState("ethlt_reaper_toolkit", "append_duplicate_times", "16", true);
+}
+
+void build_midi_fill(const Scale &scale)
+{
+    build_midi_take(scale);
+    auto &notes = mock::project().midi_editor_take->notes;
+    for (size_t i = 0; i < notes.size(); i++)
+        notes[i].selected = i < 2000;
+    mock::project().time_selection_end = (notes[1999].end_ppq + 10) * 17 / 1920;
+    SetExtState("ethlt_reaper_toolkit", "append_duplicate_times", "16", true);
+}
+
+// inventory already built, then a take envelope appears on one track
+void build_inventory_one_track_changed(const Scale &scale)
+{
+    build_items(scale);
+    for (auto &track : mock::project().tracks)
+        fill_envelope(mock::add_envelope(track.get(), "VOLENV2"), 10, false);
+    envelope_inventory();
+
+    mock::Take *take = mock::project().tracks[0]->items[0]->takes[0].get();
+    fill_envelope(mock::add_envelope(take, "VOLENV"), 100, false);
+    mock::project().state_change_count++;
+}
+
+// up to 500 selected stereo 48 kHz stems of 20 s at assorted levels, for loudness normalization
+void build_audio_stems(const Scale &scale)
+{
+    build_tracks(scale);
+    auto &tracks = mock::project().tracks;
+    const int stems = std::min(scale.items, 500);
+    for (int i = 0; i < stems; i++) {
+        mock::Item *item = mock::add_item(tracks[i % tracks.size()].get(), 0, 20);
+        item->selected = true;
+        mock::Take *take = mock::add_take(item);
+        take->sample_rate = 48000;
+        take->channels = 2;
+        take->amplitude = 0.05 + 0.9 * (i % 19) / 18.0;
+    }
+    SetExtState("ethlt_reaper_toolkit", "normalize_loudness", "-14,-1", true);
+}
+
+// the same stems as instances of 20 source files on disk, so the analysis cache can kick in: each
+// file is analysed once in the first repetition, later repetitions (and runs) find all of them in
+// ./ethlt_analysis_cache.bin
+void build_shared_stems(const Scale &scale)
+{
+    build_audio_stems(scale);
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "ethlt_bench_sources";
+    std::filesystem::create_directories(dir);
+    constexpr int SOURCE_FILES = 20;
+    for (int i = 0; i < SOURCE_FILES; i++) {
+        const std::filesystem::path path = dir / ("stem_" + std::to_string(i) + ".wav");
+        if (!std::filesystem::exists(path)) // rewriting would change the key
+            if (FILE *file = fopen(path.string().c_str(), "wb"))
+                fclose(file);
+    }
+
+    int i = 0;
+    for (auto &track : mock::project().tracks) {
+        for (auto &item : track->items) {
+            mock::Take *take = item->takes[0].get();
+            const int source = i++ % SOURCE_FILES;
+            take->file = (dir / ("stem_" + std::to_string(source) + ".wav")).string();
+            take->amplitude = 0.05 + 0.9 * source / (SOURCE_FILES - 1);
+        }
+    }
+}
+
+// a four minute song at 120 bpm on the only selected track
+void build_kick_track(const Scale &scale)
+{
+    build_tracks(scale);
+    for (auto &track : mock::project().tracks)
+        track->selected = false;
+    mock::Track *kick = mock::project().tracks[0].get();
+    kick->selected = true;
+    kick->kick_interval = 0.5;
+    kick->audio_length = 240;
+}
+
+// selected items on selected tracks with volume envelopes to clean, for the pipelines
+void build_pipeline_project(const Scale &scale)
+{
+    build_track_envelopes(scale);
+    auto &tracks = mock::project().tracks;
+    for (int i = 0; i < scale.items; i++) {
+        mock::Item *item = mock::add_item(tracks[i % tracks.size()].get(), static_cast<double>(i / tracks.size()) * 2, 2);
+        item->selected = true;
+        mock::add_take(item);
+    }
+}
+
+// the kick track's triggers already detected, for the pump envelope to be rendered from
+void build_pump_triggers(const Scale &scale)
+{
+    build_kick_track(scale);
+    detect_kick_triggers();
+}
+
+// the selected tracks metered live at different levels, with a second of audio played; the
+// metering of the previous run goes first, its tracks are gone
+void build_metered_tracks(const Scale &scale)
+{
+    if (is_live_track_metering())
+        toggle_live_track_meters();
+    build_tracks(scale);
+    auto &tracks = mock::project().tracks;
+    for (size_t i = 0; i < tracks.size(); i++) {
+        tracks[i]->selected = i < MAX_METERED_TRACKS;
+        tracks[i]->meter_peak = 0.02 + (i % 40) * 0.02;
+    }
+    SetExtState("ethlt_reaper_toolkit", "live_meter_target_level", "-18", false);
+    toggle_live_track_meters();
+    mock::run_audio(1);
+}
+
+// the file the export and import prompts offer, in the temp directory rather than the working one
+void build_automation_file_project(const Scale &scale)
+{
+    build_track_envelopes(scale);
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "ethlt_bench_automation.ethltau";
+    SetExtState("ethlt_reaper_toolkit", "automation_file_path", path.string().c_str(), false);
+}
+
+// packed inputs for the batch ReaScript exports, built outside the timed region
+std::string packed_values, packed_indices;
+std::vector<char> packed_result;
+
+void build_packed_volumes(const Scale &scale)
+{
+    packed_values.clear();
+    for (int i = 0; i < scale.items; i++)
+        packed_values += std::to_string(0.01 + (i % 400) / 100.0) + " ";
+    packed_result.assign(packed_values.size() * 4 + 1, '\0');
+}
+
+void build_packed_track_indices(const Scale &scale)
+{
+    build_tracks(scale);
+    packed_indices.clear();
+    for (int i = 0; i < scale.tracks; i++)
+        packed_indices += std::to_string(i) + " ";
+}
+
+const Scenario scenarios[] = {
+    {"clean_envelope_points", build_track_envelopes, clean_envelope_points},
+    {"clean_envelope_points/recorded_range", build_track_envelopes,
+     [] {
+         // what Clean Automation After Recording does after a 2 s pass that wrote every envelope
+         for (const EnvelopeRecord &record : envelope_inventory())
+             clean_envelope_point_range(record.envelope, 2, 4);
+     }},
+    {"automation_file/export", build_automation_file_project, export_automation},
+    {"automation_file/import",
+     [](const Scale &scale) {
+         build_automation_file_project(scale);
+         export_automation();
+     },
+     import_automation},
+    {"smart_vol_adjust/items", build_items, smart_vol_adjust<true, false>},
+    {"smart_vol_adjust/tracks",
+     [](const Scale &scale) {
+         build_tracks(scale);
+         mock::project().track_under_mouse = mock::project().tracks[0].get();
+     },
+     smart_vol_adjust<true, false>},
+    {"smart_vol_adjust/envelope_points", build_selected_envelope, smart_vol_adjust<true, true>},
+    {"smart_vol_adjust/key_repeat_x30", build_items,
+     [] {
+         for (int i = 0; i < 30; i++)
+             smart_vol_adjust<true, true>();
+     }},
+    {"smart_midi_vel_adjust", build_midi_take, smart_midi_vel_adjust<true, false>},
+    {"append_duplicate_midi_editor", build_midi_take, append_duplicate_midi_editor},
+    {"append_duplicate_main", build_items, append_duplicate_main},
+    {"append_duplicate_times_midi_editor/x16", build_midi_fill, append_duplicate_times_midi_editor},
+    {"append_duplicate_times_main/x16", build_items_fill, append_duplicate_times_main},
+    {"append_duplicate_to_time_selection_midi_editor", build_midi_fill, append_duplicate_to_time_selection_midi_editor},
+    {"append_duplicate_to_time_selection_main", build_items_fill, append_duplicate_to_time_selection_main},
+    {"normalize_selected_items_loudness", build_audio_stems, normalize_selected_items_loudness},
+    {"normalize_selected_items_loudness/shared_sources", build_shared_stems, normalize_selected_items_loudness},
+    {"setup_global_midisend/create", build_tracks, setup_global_midisend},
+    {"setup_global_midisend/unchanged", build_midisend_warm, setup_global_midisend},
+    {"detect_kick_triggers", build_kick_track, detect_kick_triggers},
+    {"step_tracks_toward_target_level", build_metered_tracks, step_tracks_toward_target_level},
+    {"render_pump_envelope/create", build_pump_triggers, render_pump_envelope},
+    {"render_pump_envelope/replace",
+     [](const Scale &scale) {
+         build_pump_triggers(scale);
+         render_pump_envelope();
+     },
+     render_pump_envelope},
+    {"pipeline/clean_then_volumes", build_pipeline_project,
+     [] { RunPipeline("clean_envelopes, item_vol_up_fine, item_vol_up_fine, track_vol_down"); }},
+    {"pipeline/volume_then_append", build_pipeline_project,
+     [] { RunPipeline("item_vol_down, append_duplicate, item_vol_up_fine"); }},
+    {"envelope_inventory/rebuild", build_items, [] { envelope_inventory(); }},
+    {"envelope_inventory/unchanged",
+     [](const Scale &scale) {
+         build_items(scale);
+         envelope_inventory();
+     },
+     [] { envelope_inventory(); }},
+    {"envelope_inventory/one_track_changed", build_inventory_one_track_changed, [] { envelope_inventory(); }},
+    {"batch_api/StepVolumes", build_packed_volumes,
+     [] {
+         StepVolumes(packed_values.c_str(), true, true, packed_result.data(),
+                     static_cast<int>(packed_result.size()));
+     }},
+    {"batch_api/AdjustTracksVolume", build_packed_track_indices,
+     [] { AdjustTracksVolume(packed_indices.c_str(), true, false); }},
+    {"switch_triplet_main_grid", [](const Scale &) {}, switch_triplet_main_grid},
+    {"switch_triplet_midi_grid", [](const Scale &) { build_midi_take({0, 0, 0, 1}); }, switch_triplet_midi_grid},
+};
+constexpr int SCENARIO_COUNT = sizeof(scenarios) / sizeof(scenarios[0]);
+
+Result run_scenario(int index, const Scale &scale, int repeat)
+{
+    const Scenario &scenario = scenarios[index];
+    Result result {&scenario, {}, 0, 0, 0, 0, 0};
+
+    for (int r = 0; r < repeat; r++) {
+        mock::reset();
+        scenario.build(scale);
+        mock::project().undo_points = 0;
+        mock::project().console_messages = 0;
+        flush_refresh();
+        mock::project().ui_refreshes = 0;
+        reset_action_stats();
+
+        const auto start = std::chrono::steady_clock::now();
+        {
+            ScopedActionTimer timer {index};
+            ScopedActionArena arena;
+            scenario.run();
+        }
+        log_flush(); // as OnAction does, so buffered console output is part of the cost
+        flush_refresh(); // as the next UI timer tick does
+        const auto end = std::chrono::steady_clock::now();
+        result.samples_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    result.objects_touched = get_action_stats(index)->objects_touched;
+    result.arena_high_water = get_action_stats(index)->arena_high_water;
+    result.undo_points = mock::project().undo_points;
+    result.console_messages = mock::project().console_messages;
+    result.ui_refreshes = mock::project().ui_refreshes;
+    mock::reset(); // release the project before the next scenario builds its own
+    return result;
+}
+
+void write_json(FILE *out, const Scale &scale, int repeat, const std::vector<Result> &results)
+{
+    fprintf(out, "{\n  \"scale\": {\"tracks\": %d, \"items\": %d, \"envelope_points\": %d, \"notes\": %d},\n",
+            scale.tracks, scale.items, scale.envelope_points, scale.notes);
+    fprintf(out, "  \"repeat\": %d,\n  \"results\": [", repeat);
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        std::vector<double> sorted = r.samples_ms;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for (double ms : sorted)
+            total += ms;
+
+        fprintf(out,
+                "%s\n    {\"name\": \"%s\", \"min_ms\": %.4f, \"median_ms\": %.4f, \"mean_ms\": %.4f, "
+                "\"max_ms\": %.4f, \"objects_touched\": %llu, \"undo_points\": %d, \"console_messages\": %d, "
+                "\"ui_refreshes\": %d, \"arena_high_water\": %llu}",
+                i ? "," : "", r.scenario->name, sorted.front(), sorted[sorted.size() / 2],
+                total / sorted.size(), sorted.back(), static_cast<unsigned long long>(r.objects_touched),
+                r.undo_points, r.console_messages, r.ui_refreshes,
+                static_cast<unsigned long long>(r.arena_high_water));
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+void print_usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--tracks N] [--items N] [--envelope-points N] [--notes N] [--repeat N]\n"
+            "          [--filter SUBSTRING] [--output FILE] [--list] [--check-only]\n",
+            argv0);
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    Scale scale;
+    int repeat = 5;
+    const char *filter = nullptr;
+    const char *output = nullptr;
+    bool check_only = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto int_option = [&](const char *name, int *target) {
+            if (strcmp(arg, name) || !value)
+                return false;
+            *target = std::max(1, atoi(value));
+            i++;
+            return true;
+        };
+
+        if (int_option("--tracks", &scale.tracks) || int_option("--items", &scale.items) ||
+            int_option("--envelope-points", &scale.envelope_points) || int_option("--notes", &scale.notes) ||
+            int_option("--repeat", &repeat))
+            continue;
+        if (!strcmp(arg, "--filter") && value) {
+            filter = argv[++i];
+        } else if (!strcmp(arg, "--output") && value) {
+            output = argv[++i];
+        } else if (!strcmp(arg, "--list")) {
+            for (const Scenario &scenario : scenarios)
+                printf("%s\n", scenario.name);
+            return 0;
+        } else if (!strcmp(arg, "--check-only")) {
+            check_only = true;
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    mock::install();
+    if (check_only)
+        return run_host_checks() ? 1 : 0;
+    init_action_stats(SCENARIO_COUNT);
+
+    std::vector<Result> results;
+    for (int i = 0; i < SCENARIO_COUNT; i++) {
+        if (filter && !strstr(scenarios[i].name, filter))
+            continue;
+        results.push_back(run_scenario(i, scale, repeat));
+
+        const Result &r = results.back();
+        fprintf(stderr, "%-36s %10.3f ms (min of %d)\n", r.scenario->name,
+                *std::min_element(r.samples_ms.begin(), r.samples_ms.end()), repeat);
+    }
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot open %s\n", output);
+        return 1;
+    }
+    write_json(out, scale, repeat, results);
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
@@ -0,0 +1,626 @@
+#include "core/almost_equal.h"
+#include "core/envelope_cleaner.h"
+#include "core/envelope_info.h"
+#include "core/grid.h"
+#include "core/loudness.h"
+#include "core/velocity.h"
+#include "core/volume.h"
+#include "reference_kernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// Exactness checks and microbenchmarks for the numeric kernels in src/core/. Every kernel is run
+// against its verbatim pre-refactor copy in reference_kernels.h over edge cases, lattice
+// boundaries and random inputs; results must be bit-identical. Exits non-zero on any mismatch.
+//   ethlt_bench_kernels [--inputs N] [--min-time MS] [--check-only] [--output FILE]
+
+using namespace PROJECT_NAME;
+
+namespace
+{
+
+std::mt19937_64 rng {0x65746c74};
+int mismatches = 0;
+
+double uniform(double lo, double hi)
+{
+    return std::uniform_real_distribution<double>(lo, hi)(rng);
+}
+
+bool same_bits(double a, double b)
+{
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+void report_mismatch(const char *kernel, const std::string &input, double got, double expected)
+{
+    if (mismatches++ < 20)
+        fprintf(stderr, "MISMATCH %s(%s): %.17g, expected %.17g\n", kernel, input.c_str(), got, expected);
+}
+
+std::string num(double x)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.17g", x);
+    return buf;
+}
+
+// a few ulps either side of x, where floor() based stepping flips
+void push_neighbourhood(std::vector<double> &out, double x, int ulps = 4)
+{
+    double lo = x, hi = x;
+    out.push_back(x);
+    for (int i = 0; i < ulps; i++) {
+        lo = std::nextafter(lo, -HUGE_VAL);
+        hi = std::nextafter(hi, HUGE_VAL);
+        out.push_back(lo);
+        out.push_back(hi);
+    }
+}
+
+std::vector<double> volume_inputs(size_t random_count)
+{
+    std::vector<double> in = {0.0,
+                              -0.0,
+                              -1.0,
+                              1.0,
+                              2.0,
+                              4.0,
+                              std::numeric_limits<double>::denorm_min(),
+                              std::numeric_limits<double>::min(),
+                              std::numeric_limits<double>::max(),
+                              HUGE_VAL,
+                              -HUGE_VAL,
+                              std::numeric_limits<double>::quiet_NaN()};
+    push_neighbourhood(in, core::MIN_VOL_FACTOR, 16);
+    // step lattice of the coarse (1/2 octave) and fine (1/12 octave) adjustments, and the points
+    // where STEP_OFFSET moves them
+    for (int k = -12 * 12; k <= 12 * 4; k++) {
+        for (double offset : {0.0, 1.4, -0.4, 0.6, -0.6}) {
+            push_neighbourhood(in, std::exp2((k - offset) / 12));
+            push_neighbourhood(in, std::exp2((k - offset) / 2));
+        }
+    }
+    while (in.size() < random_count)
+        in.push_back(std::exp2(uniform(-40, 10)));
+    return in;
+}
+
+struct EnvRange
+{
+    double min_val, max_val, mid_val;
+    int adjust_type;
+};
+
+struct EnvInput
+{
+    double val;
+    EnvRange range;
+};
+
+std::vector<EnvInput> envpt_inputs(size_t random_count)
+{
+    std::vector<EnvRange> ranges = {{0, 1, 0.5, 0}, {0, 2, 1, 1},   {0, 1, 0.25, 1},   {0, 4, 1, 1},
+                                    {-1, 1, 0, 0},  {0, 1, 0.5, 2}, {-60, 12, 0, 0},   {0, 1, 0.5, 1},
+                                    {-24, 24, 0, 0}, {0, 1000, 10, 0}, {20, 20000, 1000, 0}};
+    for (int i = 0; i < 32; i++) {
+        double a = uniform(-100, 100), b = uniform(-100, 100);
+        if (a > b)
+            std::swap(a, b);
+        ranges.push_back({a, b, uniform(a, b), 0});
+    }
+
+    std::vector<EnvInput> in;
+    for (const EnvRange &range : ranges) {
+        const double span = range.max_val - range.min_val;
+        std::vector<double> vals = {range.min_val, range.max_val, range.mid_val, 0.0,
+                                    std::numeric_limits<double>::quiet_NaN()};
+        for (int step = 0; step <= 64; step++) {
+            push_neighbourhood(vals, range.min_val + span * step / 64);
+            push_neighbourhood(vals, range.min_val + (range.mid_val - range.min_val) * step / 32);
+        }
+        for (double v : vals)
+            in.push_back({v, range});
+    }
+    while (in.size() < random_count) {
+        const EnvRange &range = ranges[rng() % ranges.size()];
+        const double span = range.max_val - range.min_val;
+        in.push_back({uniform(range.min_val - span / 5, range.max_val + span / 5), range});
+    }
+    return in;
+}
+
+std::vector<double> grid_inputs(size_t random_count)
+{
+    std::vector<double> in;
+    for (int n = 1; n <= 4096; n++) {
+        push_neighbourhood(in, 1.0 / n, 2);
+        push_neighbourhood(in, 4.0 / n, 2);
+    }
+    while (in.size() < random_count)
+        in.push_back(uniform(1.0 / 8192, 4));
+    return in;
+}
+
+std::vector<std::string> envelope_chunks()
+{
+    std::vector<std::string> in;
+    const char *types[] = {"VOLENV",  "VOLENV2",   "VOLENV3",   "AUXVOLENV", "PANENV",  "PANENV2",
+                           "AUXPANENV", "WIDTHENV", "WIDTHENV2", "MUTEENV",  "AUXMUTEENV", "PITCHENV",
+                           "TEMPOENV", "POOLEDENV"};
+    for (const char *type : types) {
+        in.push_back(std::string("<") + type + "\nACT 1 -1\nVIS 1 1 1\nDEFSHAPE 0 -1 -1\n");
+        in.push_back(std::string("<") + type + " \n");
+    }
+
+    const char *parm_ranges[] = {"0 1 0.5", "0 2 1", "0 1 0.25", "0 4 1", "-1 1 0", "-60 12 0", "0 1", "",
+                                 "-150 24 0", "0 1000 10.5"};
+    for (const char *range : parm_ranges) {
+        for (const char *shape : {"0", "1", "2", "5"}) {
+            for (const char *param : {"3", "0:delta", "12", "9999"}) {
+                in.push_back(std::string("<PARMENV ") + param + " " + range + "\nACT 0 -1\nVIS 1 1 1\nDEFSHAPE " +
+                             shape + " -1 -1\n");
+            }
+        }
+    }
+    for (int i = 0; i < 2000; i++) {
+        double a = uniform(-100, 100), b = uniform(-100, 100), mid = uniform(-100, 100);
+        in.push_back("<PARMENV " + std::to_string(rng() % 64) + " " + num(a) + " " + num(b) + " " + num(mid) +
+                     "\nDEFSHAPE " + std::to_string(rng() % 3) + "\n");
+    }
+
+    // malformed headers
+    for (const char *bad : {"", "<", "VOLENV2\n", "<VOLENV2", "<PARMENV", "<PARMENV \n", "<PARMENV x y z w\n"})
+        in.push_back(bad);
+    return in;
+}
+
+std::vector<std::string> index_inputs(size_t random_count)
+{
+    std::vector<std::string> in = {"", "envelope", "envelope ", "0", "7", "envelope 0", "tcp.envelope.12",
+                                   "x99999", "123abc", "  42"};
+    for (int i = 0; i < 10000; i++)
+        in.push_back("arrange.envelope." + std::to_string(i));
+    while (in.size() < random_count) {
+        std::string s = rng() % 2 ? "envelope " : "tcp.";
+        for (int len = 1 + rng() % 9; len > 0; len--)
+            s += static_cast<char>('0' + rng() % 10);
+        in.push_back(s);
+    }
+    return in;
+}
+
+// ---- exactness ----
+
+template<bool increase, bool is_fine>
+void check_volume(const std::vector<double> &in)
+{
+    for (double v : in) {
+        const double got = core::adjust_volume<increase, is_fine>(v);
+        const double expected = reference::adjust_volume<increase, is_fine>(v);
+        if (!same_bits(got, expected))
+            report_mismatch("adjust_volume", num(v), got, expected);
+    }
+}
+
+template<bool increase, bool is_fine>
+void check_envpt(const std::vector<EnvInput> &in)
+{
+    for (const EnvInput &e : in) {
+        const EnvRange &r = e.range;
+        const double got =
+            core::adjust_envpt_value<increase, is_fine>(e.val, r.min_val, r.max_val, r.mid_val, r.adjust_type);
+        const double expected =
+            reference::adjust_envpt_value<increase, is_fine>(e.val, r.min_val, r.max_val, r.mid_val, r.adjust_type);
+        if (!same_bits(got, expected))
+            report_mismatch("adjust_envpt_value",
+                            num(e.val) + ", " + num(r.min_val) + ", " + num(r.max_val) + ", " + num(r.mid_val) +
+                                ", " + std::to_string(r.adjust_type),
+                            got, expected);
+    }
+}
+
+template<bool increase, bool is_fine>
+void check_velocity()
+{
+    for (int vel = -256; vel < 512; vel++) {
+        const int got = core::adjust_velocity<increase, is_fine>(vel);
+        const int expected = reference::adjust_velocity<increase, is_fine>(vel);
+        if (got != expected)
+            report_mismatch("adjust_velocity", std::to_string(vel), got, expected);
+    }
+}
+
+void check_db2factor()
+{
+    // beyond +-186 dB the 1 << int_part in the original overflows
+    std::vector<double> in;
+    for (int i = -180 * 64; i <= 180 * 64; i++)
+        push_neighbourhood(in, i / 64.0, 1);
+    for (int i = 0; i < 100000; i++)
+        in.push_back(uniform(-180, 180));
+    for (double db : in) {
+        const double got = core::db2factor(db), expected = reference::db2factor(db);
+        if (!same_bits(got, expected))
+            report_mismatch("db2factor", num(db), got, expected);
+    }
+}
+
+void check_almost_equal(size_t random_count)
+{
+    const double specials[] = {0.0, -0.0, 1.0, -1.0, HUGE_VAL, -HUGE_VAL, std::numeric_limits<double>::quiet_NaN(),
+                               std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::max()};
+    auto check = [](double a, double b) {
+        const bool got = core::almost_equal(a, b), expected = reference::almost_equal(a, b);
+        if (got != expected)
+            report_mismatch("almost_equal", num(a) + ", " + num(b), got, expected);
+    };
+    for (double a : specials)
+        for (double b : specials)
+            check(a, b);
+
+    for (size_t i = 0; i < random_count; i++) {
+        const double a = uniform(-1000, 1000);
+        uint64_t bits;
+        memcpy(&bits, &a, sizeof(bits));
+        bits += (rng() & ((uint64_t(1) << (rng() % 40)) - 1)) * (rng() % 2 ? 1 : -1);
+        if (rng() % 16 == 0)
+            bits ^= uint64_t(1) << 63;
+        double b;
+        memcpy(&b, &bits, sizeof(b));
+        check(a, b);
+    }
+}
+
+void check_grid(const std::vector<double> &in)
+{
+    for (double g : in) {
+        const double got = core::switch_gridsize(g), expected = reference::switch_gridsize(g);
+        if (!same_bits(got, expected))
+            report_mismatch("switch_gridsize", num(g), got, expected);
+    }
+}
+
+void check_extract_index(const std::vector<std::string> &in)
+{
+    for (const std::string &s : in) {
+        const int got = core::extract_index(s.c_str(), s.size());
+        const int expected = reference::extract_index(s.c_str(), s.size());
+        if (got != expected)
+            report_mismatch("extract_index", s, got, expected);
+    }
+}
+
+// parse_envelope_info replaced extract_envelope_info, this reproduces the old output parameters
+// from it: the type name, the range values as far as they were read, and adjust_type on success
+bool extract_envelope_info_via_parser(const std::string &s, char *env_type, double *values, int *adjust_type)
+{
+    core::EnvelopeInfo info;
+    const bool ok = core::parse_envelope_info(s, info);
+    if (!info.tag.empty())
+        core::format_envelope_type(info, env_type, 64);
+    for (int i = 0; i < info.value_count; i++)
+        values[i] = i == 0 ? info.min_val : i == 1 ? info.max_val : info.mid_val;
+    if (ok)
+        *adjust_type = info.adjust_type;
+    return ok;
+}
+
+void check_extract_envelope_info(const std::vector<std::string> &in)
+{
+    for (const std::string &s : in) {
+        char type_got[64] = {}, type_expected[64] = {};
+        double got[3] = {-1, -1, -1}, expected[3] = {-1, -1, -1};
+        int adjust_got = -1, adjust_expected = -1;
+
+        const bool ok_got = extract_envelope_info_via_parser(s, type_got, got, &adjust_got);
+        const bool ok_expected = reference::extract_envelope_info(s.c_str(), s.size(), type_expected, &expected[0],
+                                                                  &expected[1], &expected[2], &adjust_expected);
+
+        bool same = ok_got == ok_expected && adjust_got == adjust_expected && !strcmp(type_got, type_expected);
+        for (int i = 0; i < 3; i++)
+            same = same && same_bits(got[i], expected[i]);
+        if (!same)
+            report_mismatch("extract_envelope_info", s.substr(0, s.find('\n')), ok_got, ok_expected);
+    }
+
+    // every prefix of a well-formed chunk is a truncated one; the parser must stay inside it
+    const std::string chunk = "<PARMENV 12:delta -60 12 0\nACT 0 -1\nVIS 1 1 1\nDEFSHAPE 1 -1 -1\n";
+    for (size_t len = 0; len <= chunk.size(); len++) {
+        std::vector<char> exact(chunk.begin(), chunk.begin() + len); // no terminator for ASan to miss
+        core::EnvelopeInfo info;
+        core::parse_envelope_info({exact.data(), exact.size()}, info);
+        if (info.tag.size() > len || info.param.data() + info.param.size() > exact.data() + len)
+            report_mismatch("parse_envelope_info (truncated)", chunk.substr(0, len), 1, 0);
+    }
+}
+
+// point lists full of what the cleaner removes: time runs a few ulps apart, repeated values and
+// square shapes, with tails and heads repeating their neighbours
+std::vector<reference::EnvPoint> envelope_point_list()
+{
+    const double values[] = {0, 0.25, 0.5, 1, 716.2178, -0.0};
+    std::vector<reference::EnvPoint> points(rng() % 40);
+    double time = uniform(0, 10);
+    for (reference::EnvPoint &point : points) {
+        switch (rng() % 4) {
+        case 0: break; // same time
+        case 1: time = std::nextafter(time, HUGE_VAL); break;
+        case 2: time += 1e-6 * (rng() % 4); break;
+        default: time += uniform(0, 1); break;
+        }
+        point.time = time;
+        point.value = rng() % 4 ? values[rng() % 3] : values[rng() % 6] + (rng() % 2 ? 0 : uniform(0, 1));
+        point.shape = rng() % 3 == 0;
+    }
+    return points;
+}
+
+void check_clean_envelope_points(size_t envelope_count)
+{
+    for (size_t e = 0; e < envelope_count; e++) {
+        reference::TrackEnvelope env;
+        env.lists.resize(1 + rng() % 3); // the underlying envelope and up to two automation items
+        for (auto &list : env.lists)
+            list = envelope_point_list();
+        const reference::TrackEnvelope input = env;
+
+        size_t removed = 0;
+        std::vector<std::vector<reference::EnvPoint>> got = env.lists;
+        for (auto &list : got)
+            removed += core::clean_envelope_points(list);
+        const int expected_removed = reference::handle_envelope(&env);
+
+        bool same = removed == static_cast<size_t>(expected_removed);
+        for (size_t i = 0; same && i < got.size(); i++) {
+            same = got[i].size() == env.lists[i].size();
+            for (size_t j = 0; same && j < got[i].size(); j++) {
+                same = same_bits(got[i][j].time, env.lists[i][j].time) &&
+                       same_bits(got[i][j].value, env.lists[i][j].value) && got[i][j].shape == env.lists[i][j].shape;
+            }
+        }
+        if (!same) {
+            std::string points;
+            for (const reference::EnvPoint &p : input.lists[0])
+                points += num(p.time) + "/" + num(p.value) + "/" + std::to_string(p.shape) + " ";
+            report_mismatch("clean_envelope_points", points, static_cast<double>(removed), expected_removed);
+        }
+    }
+}
+
+// a 997 Hz sine at -20 dBFS reads -20.0 LUFS on two channels and -23.0 LUFS on one (BS.1770-4
+// calibration, 0.01 LU rounding either way)
+void check_loudness_calibration()
+{
+    constexpr double PI = 3.14159265358979323846;
+    const double rate = 48000, amplitude = 0.1;
+    for (int channels = 1; channels <= 2; channels++) {
+        std::vector<double> samples(static_cast<size_t>(rate) * 10 * channels);
+        for (size_t i = 0; i < samples.size(); i++)
+            samples[i] = amplitude * std::sin(2 * PI * 997 * static_cast<double>(i / channels) / rate);
+
+        core::LoudnessMeter meter {rate, channels};
+        meter.process(samples.data(), samples.size() / channels);
+        const double expected = channels == 2 ? -20.0 : -23.0;
+        if (std::fabs(meter.integrated_lufs() - expected) > 0.02)
+            report_mismatch("LoudnessMeter::integrated_lufs", "997 Hz -20 dBFS x" + std::to_string(channels),
+                            meter.integrated_lufs(), expected);
+    }
+}
+
+// the SSE2 path has to give what the scalar loop gives, for every channel count and however the
+// audio is split into calls
+void check_loudness_vectorized(size_t sample_count)
+{
+    for (int channels = 1; channels <= core::LoudnessMeter::MAX_CHANNELS; channels++) {
+        const double rate = channels % 2 ? 44100 : 48000;
+        std::vector<double> samples(sample_count / channels * channels);
+        for (double &x : samples)
+            x = uniform(-1, 1) * (rng() % 8 ? 0.05 : 1);
+
+        core::LoudnessMeter vectorized {rate, channels}, scalar {rate, channels, false};
+        for (size_t frame = 0, frames = samples.size() / channels; frame < frames;) {
+            const size_t n = std::min<size_t>(frames - frame, 1 + rng() % 9000);
+            vectorized.process(samples.data() + frame * channels, n);
+            scalar.process(samples.data() + frame * channels, n);
+            frame += n;
+        }
+
+        const std::string input = std::to_string(channels) + " channels";
+        if (!same_bits(vectorized.peak(), scalar.peak()))
+            report_mismatch("LoudnessMeter::peak", input, vectorized.peak(), scalar.peak());
+        if (!same_bits(vectorized.rms(), scalar.rms()))
+            report_mismatch("LoudnessMeter::rms", input, vectorized.rms(), scalar.rms());
+        if (!same_bits(vectorized.integrated_lufs(), scalar.integrated_lufs()))
+            report_mismatch("LoudnessMeter::integrated_lufs", input, vectorized.integrated_lufs(),
+                            scalar.integrated_lufs());
+    }
+}
+
+// ---- throughput ----
+
+double min_time_ms = 200;
+
+// best time per input over repeated passes until min_time_ms has elapsed
+template<typename Fn>
+double ns_per_op(size_t count, Fn &&pass)
+{
+    using clock = std::chrono::steady_clock;
+    double best = HUGE_VAL, elapsed_ms = 0;
+    volatile double sink = 0;
+    int passes = 0;
+    while (passes < 3 || elapsed_ms < min_time_ms) {
+        const auto start = clock::now();
+        sink = sink + pass();
+        const double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        best = std::min(best, ms);
+        elapsed_ms += ms;
+        passes++;
+    }
+    return best * 1e6 / count;
+}
+
+struct Timing
+{
+    const char *name;
+    double core_ns, reference_ns;
+};
+
+template<typename Input, typename Kernel>
+double sum_over(const std::vector<Input> &in, Kernel &&kernel)
+{
+    double acc = 0;
+    for (const Input &x : in)
+        acc += kernel(x);
+    return acc;
+}
+
+#define ETHLT_TIME_KERNEL(label, inputs, expr)                                                                  \
+    timings.push_back({label,                                                                                   \
+                       ns_per_op(inputs.size(),                                                                 \
+                                 [&] {                                                                          \
+                                     using namespace core;                                                      \
+                                     return sum_over(inputs, [](const auto &x) { return double(expr); });       \
+                                 }),                                                                            \
+                       ns_per_op(inputs.size(), [&] {                                                           \
+                           using namespace reference;                                                           \
+                           return sum_over(inputs, [](const auto &x) { return double(expr); });                 \
+                       })})
+
+std::vector<Timing> run_timings(size_t count)
+{
+    std::vector<Timing> timings;
+
+    std::vector<double> vols(count), db(count), grids(count);
+    std::vector<int> vels(count);
+    std::vector<EnvInput> envpts = envpt_inputs(count);
+    std::vector<std::pair<double, double>> pairs(count);
+    std::vector<std::string> indices = index_inputs(count);
+    std::vector<std::string> chunks;
+    for (size_t i = 0; i < count; i++) {
+        vols[i] = std::exp2(uniform(-10, 2));
+        db[i] = uniform(-60, 12);
+        grids[i] = 1.0 / (1 + rng() % 64);
+        vels[i] = static_cast<int>(rng() % 128);
+        pairs[i].first = uniform(0, 600);
+        pairs[i].second = rng() % 2 ? pairs[i].first : std::nextafter(pairs[i].first, HUGE_VAL);
+    }
+    const std::vector<std::string> corpus = envelope_chunks();
+    for (size_t i = 0; i < std::min<size_t>(count, 100000); i++)
+        chunks.push_back(corpus[i % corpus.size()]);
+
+    ETHLT_TIME_KERNEL("adjust_volume<true, false>", vols, (adjust_volume<true, false>(x)));
+    ETHLT_TIME_KERNEL("adjust_volume<false, true>", vols, (adjust_volume<false, true>(x)));
+    ETHLT_TIME_KERNEL("adjust_envpt_value<true, false>", envpts,
+                      (adjust_envpt_value<true, false>(x.val, x.range.min_val, x.range.max_val, x.range.mid_val,
+                                                       x.range.adjust_type)));
+    ETHLT_TIME_KERNEL("db2factor", db, db2factor(x));
+    ETHLT_TIME_KERNEL("adjust_velocity<true, false>", vels, (adjust_velocity<true, false>(x)));
+    ETHLT_TIME_KERNEL("almost_equal", pairs, almost_equal(x.first, x.second));
+    ETHLT_TIME_KERNEL("switch_gridsize", grids, switch_gridsize(x));
+    ETHLT_TIME_KERNEL("extract_index", indices, extract_index(x.c_str(), x.size()));
+    timings.push_back({"extract_envelope_info",
+                       ns_per_op(chunks.size(),
+                                 [&] {
+                                     return sum_over(chunks, [](const std::string &s) {
+                                         core::EnvelopeInfo info;
+                                         return double(core::parse_envelope_info(s, info)) + info.value_count;
+                                     });
+                                 }),
+                       ns_per_op(chunks.size(), [&] {
+                           return sum_over(chunks, [](const std::string &s) {
+                               char type[64];
+                               double lo, hi, mid;
+                               int adjust = 0;
+                               return double(reference::extract_envelope_info(s.c_str(), s.size(), type, &lo, &hi,
+                                                                             &mid, &adjust) +
+                                             adjust);
+                           });
+                       })});
+    return timings;
+}
+
+#undef ETHLT_TIME_KERNEL
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    size_t count = 1000000;
+    bool check_only = false;
+    const char *output = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--inputs") && i + 1 < argc) {
+            count = std::max(1L, atol(argv[++i]));
+        } else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) {
+            min_time_ms = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--check-only")) {
+            check_only = true;
+        } else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--inputs N] [--min-time MS] [--check-only] [--output FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const std::vector<double> vols = volume_inputs(count);
+    check_volume<true, false>(vols);
+    check_volume<true, true>(vols);
+    check_volume<false, false>(vols);
+    check_volume<false, true>(vols);
+
+    const std::vector<EnvInput> envpts = envpt_inputs(count);
+    check_envpt<true, false>(envpts);
+    check_envpt<true, true>(envpts);
+    check_envpt<false, false>(envpts);
+    check_envpt<false, true>(envpts);
+
+    check_velocity<true, false>();
+    check_velocity<true, true>();
+    check_velocity<false, false>();
+    check_velocity<false, true>();
+
+    check_db2factor();
+    check_almost_equal(count);
+    check_grid(grid_inputs(count));
+    check_extract_index(index_inputs(count / 10));
+    check_extract_envelope_info(envelope_chunks());
+    check_clean_envelope_points(count / 10);
+    check_loudness_calibration();
+    check_loudness_vectorized(count);
+
+    fprintf(stderr, "exactness: %s (%d mismatches)\n", mismatches ? "FAILED" : "ok", mismatches);
+    if (check_only)
+        return mismatches ? 1 : 0;
+
+    const std::vector<Timing> timings = run_timings(count);
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot open %s\n", output);
+        return 1;
+    }
+    fprintf(out, "{\n  \"inputs\": %zu,\n  \"mismatches\": %d,\n  \"kernels\": [", count, mismatches);
+    for (size_t i = 0; i < timings.size(); i++) {
+        const Timing &t = timings[i];
+        // ns per input == ms per million inputs
+        fprintf(stderr, "%-34s %8.2f ms per million  (reference %8.2f)\n", t.name, t.core_ns, t.reference_ns);
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"ms_per_million\": %.3f, \"reference_ms_per_million\": %.3f}",
+                i ? "," : "", t.name, t.core_ns, t.reference_ns);
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout)
+        fclose(out);
+
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,643 @@
+#include "host_checks.h"
+#include "mock_reaper.h"
+#include "analysis_cache.h"
+#include "batch_api.h"
+#include "envelope_index.h"
+#include "refresh.h"
+#include "routing_matrix.h"
+#include "rpp_cleaner.h"
+#include "scheduler.h"
+#include "track_meter.h"
+#include "actions/append_duplicate.h"
+#include "actions/clean_recorded_automation.h"
+#include "actions/clean_envelope_points.h"
+#include "actions/setup_global_midisend.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace PROJECT_NAME;
+
+namespace
+{
+
+int failures = 0;
+
+void expect(bool ok, const char *check, const std::string &detail = {})
+{
+    if (!ok && failures++ < 20)
+        fprintf(stderr, "FAILED %s%s%s\n", check, detail.empty() ? "" : ": ", detail.c_str());
+}
+
+// a scheduler on a simulated clock: tasks advance the time themselves, ticks are called directly
+void check_scheduler()
+{
+    double now = 0;
+    Scheduler scheduler {[&now] { return now; }, 10};
+    std::string order;
+
+    // priority order within a tick that has budget to spare
+    scheduler.schedule([&](TaskContext &) { order += 'b'; return TaskStatus::Done; }, {0});
+    scheduler.schedule([&](TaskContext &) { order += 'a'; return TaskStatus::Done; }, {1});
+    scheduler.schedule([&](TaskContext &) { order += 'c'; return TaskStatus::Done; }, {0});
+    scheduler.tick();
+    expect(order == "abc", "scheduler priority order", order);
+    expect(scheduler.size() == 0, "scheduler drops finished tasks");
+
+    // a high priority task that overruns the tick budget on every slice must not starve the rest
+    int slow_runs = 0, fast_runs[2] = {0, 0};
+    const TaskId slow = scheduler.schedule(
+        [&](TaskContext &) {
+            slow_runs++;
+            now += 0.012;
+            return TaskStatus::Continue;
+        },
+        {1});
+    for (int &runs : fast_runs)
+        scheduler.schedule([&runs](TaskContext &) { runs++; return TaskStatus::Continue; }, {0});
+    for (int i = 0; i < 10; i++)
+        scheduler.tick();
+    expect(slow_runs >= 5, "scheduler runs the overrunning task", std::to_string(slow_runs));
+    for (int runs : fast_runs)
+        expect(runs >= 4, "scheduler resumes after the task that spent the budget", std::to_string(runs));
+    scheduler.cancel_all();
+
+    // the minimum interval between slices, with ticks every 30 ms for one second
+    int interval_runs = 0;
+    scheduler.schedule([&](TaskContext &) { interval_runs++; return TaskStatus::Continue; }, {0, 2, 100});
+    const double start = now;
+    for (int i = 0; i <= 33; i++, now += 0.030)
+        scheduler.tick();
+    expect(interval_runs >= 8 && interval_runs <= 11, "scheduler interval",
+           std::to_string(interval_runs) + " slices in " + std::to_string(now - start) + " s");
+
+    // cancelling itself from inside a slice
+    const TaskId self = scheduler.schedule([&](TaskContext &) { scheduler.cancel_all(); return TaskStatus::Continue; });
+    scheduler.tick();
+    expect(!scheduler.is_scheduled(self) && scheduler.size() == 0, "scheduler cancel from inside a task");
+    expect(!scheduler.is_scheduled(slow), "scheduler cancel_all");
+}
+
+// an envelope freed and another created in its place keeps the track's counts, the inventory must
+// still drop the freed one; a take envelope added to a track is picked up as well
+void check_envelope_inventory()
+{
+    mock::reset();
+    mock::Track *track = mock::add_track();
+    mock::add_envelope(track, "VOLENV2")->points = {{0, 1, 0, 0, false}};
+    mock::add_envelope(track, "PARMENV 1 0 1 0.5")->points = {{0, 0.5, 0, 0, false}};
+    mock::Take *take = mock::add_take(mock::add_item(track, 0, 1));
+    mock::add_envelope(take, "VOLENV")->points = {{0, 1, 0, 0, false}};
+    envelope_inventory();
+
+    // kept alive so the new envelopes cannot reuse the freed addresses
+    std::vector<std::unique_ptr<mock::Envelope>> freed;
+    freed.push_back(std::move(track->envelopes[1]));
+    track->envelopes.erase(track->envelopes.begin() + 1);
+    mock::add_envelope(track, "PARMENV 2 0 1 0.5")->points = {{0, 0.5, 0, 0, false}, {1, 0.7, 0, 0, false}};
+    mock::add_envelope(take, "PANENV")->points = {{0, 0, 0, 0, false}, {1, 0.3, 0, 0, false}};
+    mock::project().state_change_count++;
+
+    const std::vector<EnvelopeRecord> &inventory = envelope_inventory();
+    expect(inventory.size() == 4, "envelope inventory size", std::to_string(inventory.size()));
+    for (const EnvelopeRecord &record : inventory) {
+        const auto *env = mock::handle<mock::Envelope>(record.envelope);
+        for (const auto &gone : freed)
+            expect(env != gone.get(), "envelope inventory drops replaced envelopes", env->type);
+    }
+    expect(!inventory.empty() && mock::handle<mock::Envelope>(inventory.back().envelope)->type == "PANENV",
+           "envelope inventory picks up new take envelopes");
+    mock::reset();
+}
+
+std::mt19937 rng {0x72707063};
+
+// sorted points with the runs of equal times and values the cleaner removes
+std::vector<mock::EnvPoint> random_points()
+{
+    const double values[] = {0, 0.25, 0.5, 1};
+    std::vector<mock::EnvPoint> points(rng() % 30);
+    double time = 0;
+    for (mock::EnvPoint &point : points) {
+        const unsigned step = rng() % 4;
+        time = step == 0 ? time : step == 1 ? std::nextafter(time, HUGE_VAL) : time + (rng() % 100) / 64.0;
+        point = {time, values[rng() % 4], static_cast<int>(rng() % 3 == 0), 0, false};
+    }
+    return points;
+}
+
+void write_rpp_points(std::string &out, const std::vector<mock::EnvPoint> &points, const char *indent)
+{
+    char line[128];
+    for (const mock::EnvPoint &point : points) {
+        snprintf(line, sizeof(line), "%sPT %.17g %.17g %d\n", indent, point.time, point.value, point.shape);
+        out += line;
+    }
+}
+
+// the envelope blocks of an .RPP file with the project's envelopes, one pool per automation item
+std::string project_to_rpp()
+{
+    std::string out = "<REAPER_PROJECT 0.1 \"7.0\" 0\n";
+    for (const auto &track : mock::project().tracks) {
+        for (const auto &env : track->envelopes) {
+            for (const mock::AutomationItem &ai : env->automation_items) {
+                out += "  <POOLEDENV\n    ID " + std::to_string(ai.pool_id) + "\n    NAME \"\"\n";
+                write_rpp_points(out, ai.points, "    ");
+                out += "  >\n";
+            }
+        }
+    }
+    for (const auto &track : mock::project().tracks) {
+        out += "  <TRACK\n";
+        for (const auto &env : track->envelopes) {
+            out += "    <" + env->type + "\n";
+            write_rpp_points(out, env->points, "      ");
+            for (const mock::AutomationItem &ai : env->automation_items)
+                out += "      POOLEDENVINST " + std::to_string(ai.pool_id) + " 0 1 1 0 0 0 0 0 0 0\n";
+            out += "    >\n";
+        }
+        for (const auto &item : track->items) {
+            out += "    <ITEM\n";
+            for (const auto &take : item->takes) {
+                for (const auto &env : take->envelopes) {
+                    out += "      <" + env->type + "\n";
+                    write_rpp_points(out, env->points, "        ");
+                    out += "      >\n";
+                }
+            }
+            out += "    >\n";
+        }
+        out += "  >\n";
+    }
+    return out + ">\n";
+}
+
+struct RppEnvelopes
+{
+    std::vector<std::vector<rpp::RppPoint>> envelopes; // in file order
+    std::map<int, std::vector<rpp::RppPoint>> pools;
+};
+
+RppEnvelopes read_rpp(std::string_view data)
+{
+    RppEnvelopes result;
+    std::vector<rpp::RppPoint> *points = nullptr;
+    size_t block_depth = 0;
+    rpp::walk_blocks(
+        data,
+        [&](std::string_view tag, size_t depth, bool in_track) {
+            if (block_depth)
+                return;
+            if (in_track && rpp::is_envelope_tag(tag)) {
+                result.envelopes.emplace_back();
+                points = &result.envelopes.back();
+                block_depth = depth;
+            } else if (tag == "POOLEDENV") {
+                points = nullptr; // until its ID line
+                block_depth = depth;
+            }
+        },
+        [&](size_t depth) {
+            if (depth == block_depth)
+                block_depth = 0;
+        },
+        [&](const rpp::Line &line, size_t depth) {
+            if (!block_depth || depth != block_depth)
+                return;
+            std::string_view rest = line.text;
+            int pool_id;
+            rpp::RppPoint point;
+            if (!points && rpp::next_field(rest) == "ID" && core::parse_int(rpp::next_field(rest), pool_id))
+                points = &result.pools[pool_id];
+            else if (points && rpp::parse_point(line, point))
+                points->push_back(point);
+        });
+    return result;
+}
+
+bool same_points(const std::vector<mock::EnvPoint> &action, const std::vector<rpp::RppPoint> &file)
+{
+    if (action.size() != file.size())
+        return false;
+    for (size_t i = 0; i < action.size(); i++) {
+        if (action[i].time != file[i].time || action[i].value != file[i].value || action[i].shape != file[i].shape)
+            return false;
+    }
+    return true;
+}
+
+// the offline .RPP cleaner has to leave the same points as Clean Envelope Points in REAPER
+void check_rpp_clean_matches_action()
+{
+    mock::reset();
+    for (int t = 0; t < 8; t++) {
+        mock::Track *track = mock::add_track();
+        for (int e = 0; e < 3; e++) {
+            mock::Envelope *env = mock::add_envelope(track, e == 0 ? "VOLENV2" : "PARMENV " + std::to_string(e));
+            env->points = random_points();
+            for (int a = rng() % 3; a > 0; a--)
+                env->automation_items.push_back({mock::project().next_pool_id++, 0, 1, random_points()});
+        }
+        for (int i = 0; i < 2; i++) {
+            mock::Take *take = mock::add_take(mock::add_item(track, i, 1));
+            mock::add_envelope(take, "VOLENV")->points = random_points();
+        }
+    }
+
+    const std::string input = project_to_rpp();
+    FILE *out = tmpfile();
+    rpp::CleanStats stats;
+    const bool written = out && rpp::clean_project(input, out, stats);
+    std::string cleaned;
+    if (written) {
+        cleaned.resize(static_cast<size_t>(ftell(out)));
+        rewind(out);
+        cleaned.resize(fread(&cleaned[0], 1, cleaned.size(), out));
+    }
+    if (out)
+        fclose(out);
+    expect(written, "rpp clean writes the project");
+
+    clean_envelope_points();
+    const RppEnvelopes file = read_rpp(cleaned);
+
+    size_t index = 0;
+    auto compare = [&](const mock::Envelope &env) {
+        const std::string name = env.type + " #" + std::to_string(index);
+        expect(index < file.envelopes.size() && same_points(env.points, file.envelopes[index]),
+               "rpp clean matches the action", name);
+        index++;
+        for (const mock::AutomationItem &ai : env.automation_items) {
+            auto pool = file.pools.find(ai.pool_id);
+            expect(pool != file.pools.end() && same_points(ai.points, pool->second),
+                   "rpp clean matches the action on automation items", name);
+        }
+    };
+    for (const auto &track : mock::project().tracks) {
+        for (const auto &env : track->envelopes)
+            compare(*env);
+        for (const auto &item : track->items) {
+            for (const auto &take : item->takes) {
+                for (const auto &env : take->envelopes)
+                    compare(*env);
+            }
+        }
+    }
+    expect(index == file.envelopes.size() && stats.removed > 0, "rpp clean envelope count",
+           std::to_string(file.envelopes.size()) + " envelopes, " + std::to_string(stats.removed) + " removed");
+    mock::reset();
+}
+
+// copies laid back to back on the tracks of their originals, only the last ones selected, with
+// GUIDs of their own down to the take envelopes
+void check_append_duplicate_items()
+{
+    mock::reset();
+    mock::Track *tracks[2] = {mock::add_track(), mock::add_track()};
+    mock::Item *first = mock::add_item(tracks[0], 1, 1);
+    mock::Take *first_take = mock::add_take(first);
+    first_take->notes = {{false, false, 0, 960, 0, 60, 100}};
+    mock::add_envelope(first_take, "VOLENV");
+    mock::add_envelope(first_take, "PANENV");
+    mock::add_item(tracks[1], 1.5, 1.5)->selected = true;
+    first->selected = true;
+    SetExtState("ethlt_reaper_toolkit", "append_duplicate_times", "3", false);
+    append_duplicate_times_main();
+
+    for (int t = 0; t < 2; t++) {
+        const auto &items = tracks[t]->items;
+        expect(items.size() == 4, "append duplicate item count", std::to_string(items.size()));
+        for (size_t k = 0; k < items.size(); k++) {
+            const mock::Item &item = *items[k];
+            expect(item.position == (t ? 1.5 : 1) + 2 * k && item.length == items[0]->length,
+                   "append duplicate positions", std::to_string(item.position));
+            expect(item.selected == (k == 3), "append duplicate selects the last copy", std::to_string(k));
+            expect(item.takes.size() == items[0]->takes.size() &&
+                       (item.takes.empty() || item.takes[0]->notes.size() == 1),
+                   "append duplicate copies the takes");
+            expect(item.takes.empty() || k == 0 || memcmp(&item.takes[0]->guid, &items[0]->takes[0]->guid, sizeof(GUID)),
+                   "append duplicate gives copies their own take GUIDs");
+        }
+    }
+    std::set<std::string> envelope_guids;
+    size_t envelope_count = 0;
+    for (const auto &item : tracks[0]->items) {
+        for (const auto &take : item->takes) {
+            for (const auto &env : take->envelopes) {
+                envelope_guids.emplace(reinterpret_cast<const char *>(&env->guid), sizeof(GUID));
+                envelope_count++;
+            }
+        }
+    }
+    expect(envelope_count == 8 && envelope_guids.size() == envelope_count,
+           "append duplicate gives copies their own envelope GUIDs",
+           std::to_string(envelope_guids.size()) + " GUIDs for " + std::to_string(envelope_count) +
+               " envelopes");
+    expect(mock::project().undo_points == 1, "append duplicate undo points",
+           std::to_string(mock::project().undo_points));
+    mock::reset();
+}
+
+// a full cache file of old results: looked-up and new results push out the least recently used
+void check_analysis_cache()
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const fs::path dir = fs::temp_directory_path(ec) / "ethlt_host_checks";
+    fs::create_directories(dir, ec);
+    const fs::path path = dir / "ethlt_analysis_cache.bin";
+    mock::set_resource_path(dir.string());
+
+    // the file layout of analysis_cache.cpp, filled to its 100000 entry limit; key i last used at i
+    constexpr uint64_t ENTRIES = 100000, NEW = 50, LOOKED_UP = 10;
+    struct Record
+    {
+        uint64_t key;
+        int64_t last_used;
+        double peak, rms, lufs;
+    };
+    FILE *out = fopen(path.string().c_str(), "wb");
+    if (!out) {
+        expect(false, "analysis cache file", path.string());
+        return;
+    }
+    const char magic[8] = {'E', 'T', 'H', 'L', 'T', 'A', 'C', '1'};
+    const uint32_t layout[2] = {sizeof(Record), 0};
+    fwrite(magic, sizeof(magic), 1, out);
+    fwrite(layout, sizeof(layout), 1, out);
+    fwrite(&ENTRIES, sizeof(ENTRIES), 1, out);
+    for (uint64_t i = 0; i < ENTRIES; i++) {
+        const Record record {i * 2, static_cast<int64_t>(1000 + i), 0.5, 0.25, -20.0 - i};
+        fwrite(&record, sizeof(record), 1, out);
+    }
+    fclose(out);
+
+    AnalysisResult result;
+    for (uint64_t i = 0; i < LOOKED_UP; i++)
+        expect(find_analysis(i * 2, result) && result.lufs == -20.0 - i, "analysis cache reads the file",
+               std::to_string(i));
+    for (uint64_t i = 0; i < NEW; i++)
+        store_analysis(i * 2 + 1, {1.0 / (i + 1), 0.1, -14.0 - i / 3.0});
+    save_analysis_cache();
+
+    expect(fs::file_size(path, ec) == 24 + ENTRIES * sizeof(Record), "analysis cache size limit",
+           std::to_string(fs::file_size(path, ec)));
+    for (uint64_t i = 0; i < NEW; i++) {
+        expect(find_analysis(i * 2 + 1, result) && result.peak == 1.0 / (i + 1) && result.rms == 0.1 &&
+                   result.lufs == -14.0 - i / 3.0,
+               "analysis cache round trip", std::to_string(i));
+    }
+    for (uint64_t i = 0; i < LOOKED_UP; i++)
+        expect(find_analysis(i * 2, result), "analysis cache keeps looked-up results", std::to_string(i));
+    for (uint64_t i = LOOKED_UP; i < LOOKED_UP + NEW; i++)
+        expect(!find_analysis(i * 2, result), "analysis cache evicts the least recently used", std::to_string(i));
+    expect(find_analysis((LOOKED_UP + NEW) * 2, result), "analysis cache keeps the rest");
+
+    fs::remove_all(dir, ec);
+    mock::set_resource_path(".");
+}
+
+// the project times of the notes on every track but the first, the kick track, sorted
+std::vector<double> trigger_note_times()
+{
+    std::vector<double> times;
+    for (int t = 1; t < CountTracks(nullptr); t++) {
+        MediaTrack *track = GetTrack(nullptr, t);
+        for (int i = 0; i < CountTrackMediaItems(track); i++) {
+            MediaItem_Take *take = GetActiveTake(GetTrackMediaItem(track, i));
+            int note_count = 0;
+            MIDI_CountEvts(take, &note_count, nullptr, nullptr);
+            for (int j = 0; j < note_count; j++) {
+                double start = 0;
+                MIDI_GetNote(take, j, nullptr, nullptr, &start, nullptr, nullptr, nullptr, nullptr);
+                times.push_back(MIDI_GetProjTimeFromPPQPos(take, start));
+            }
+        }
+    }
+    std::sort(times.begin(), times.end());
+    return times;
+}
+
+// detecting the hits of a time selection again replaces the triggers in it and keeps the others
+void check_redetect_kick_triggers()
+{
+    mock::reset();
+    mock::Track *kick = mock::add_track("Kick");
+    kick->selected = true;
+    kick->kick_interval = 0.5;
+    kick->audio_length = 20;
+    detect_kick_triggers();
+    flush_refresh();
+    const std::vector<double> before = trigger_note_times();
+    expect(before.size() == 40, "kick trigger count", std::to_string(before.size()));
+    expect(mock::project().track_layout_updates == 1, "new trigger track updates the track layout");
+
+    mock::project().time_selection_start = 4;
+    mock::project().time_selection_end = 6;
+    detect_kick_triggers();
+    flush_refresh();
+    expect(mock::project().track_layout_updates == 1, "existing trigger track keeps the track layout");
+    const std::vector<double> after = trigger_note_times();
+    expect(after.size() == before.size(), "kick triggers kept around a re-detected range",
+           std::to_string(before.size()) + " before, " + std::to_string(after.size()) + " after");
+    for (size_t i = 0; i < before.size() && i < after.size(); i++)
+        expect(std::fabs(after[i] - before[i]) < 1e-3, "kick trigger times after re-detection", std::to_string(i));
+    mock::reset();
+}
+
+// rendering the pump again replaces the automation items of the earlier render instead of adding to them
+void check_rerender_pump_envelope()
+{
+    mock::reset();
+    mock::Track *kick = mock::add_track("Kick");
+    kick->selected = true;
+    kick->kick_interval = 0.5;
+    kick->audio_length = 20;
+    // hits from 4.5 s on, so the first rendered bar starts before the first hit
+    mock::project().time_selection_start = 4.25;
+    mock::project().time_selection_end = 12.25;
+    detect_kick_triggers();
+
+    auto pump_items = [] {
+        size_t count = 0;
+        for (const auto &track : mock::project().tracks)
+            for (const mock::Fx &fx : track->fx)
+                for (const auto &env : fx.param_envelopes)
+                    count += env ? env->automation_items.size() : 0; // indexed by parameter
+        return count;
+    };
+    render_pump_envelope();
+    const size_t first = pump_items();
+    expect(first > 0, "pump envelope automation items");
+    for (int i = 0; i < 2; i++) {
+        render_pump_envelope();
+        expect(pump_items() == first, "pump envelope re-render keeps the item count",
+               std::to_string(first) + " first, " + std::to_string(pump_items()) + " now");
+    }
+    mock::reset();
+}
+
+// deleting a metered track or closing its project detaches it before the audio thread runs again,
+// with no scheduler tick in between
+void check_track_meter_detach()
+{
+    mock::reset();
+    std::vector<MediaTrack *> tracks;
+    for (int i = 0; i < 3; i++) {
+        mock::add_track()->meter_peak = 0.5;
+        tracks.push_back(GetTrack(nullptr, i));
+    }
+    const int stale_before = mock::stale_track_reads();
+    start_track_metering(tracks);
+    mock::run_audio(0.5);
+
+    DeleteTrack(tracks[1]);
+    mock::run_audio(1);
+    TrackLevel level;
+    expect(mock::stale_track_reads() == stale_before, "track meter reads a deleted track");
+    expect(is_track_metering() && get_track_level(tracks[0], level) && get_track_level(tracks[2], level),
+           "track meter keeps metering the other tracks");
+
+    mock::reset();
+    mock::run_audio(0.5);
+    expect(mock::stale_track_reads() == stale_before, "track meter reads the tracks of a closed project");
+    expect(!is_track_metering(), "track meter stops with its project");
+    stop_track_metering();
+}
+
+// one playback pass over 1 to 3 s: a Write track's points replaced one for one, a point added by
+// hand on a Read track; only the Write track is cleaned, and with a Read override neither is
+void check_clean_recorded_automation()
+{
+    auto play = [](int state, double position) {
+        mock::project().play_state = state;
+        mock::project().play_position = position;
+        std::this_thread::sleep_for(std::chrono::milliseconds(120)); // the poll interval
+        main_scheduler().tick();
+    };
+    auto flat = [](double value) {
+        std::vector<mock::EnvPoint> points;
+        for (int i = 0; i <= 40; i++)
+            points.push_back({i * 0.1, value, 0, 0, false});
+        return points;
+    };
+
+    for (int override_mode : {-1, 1}) {
+        mock::reset();
+        mock::project().automation_override = override_mode;
+        mock::Track *writing = mock::add_track(), *reading = mock::add_track();
+        writing->automation_mode = 3;
+        reading->automation_mode = 1;
+        mock::Envelope *written = mock::add_envelope(writing, "VOLENV2");
+        mock::Envelope *edited = mock::add_envelope(reading, "VOLENV2");
+        written->points = edited->points = flat(0.5);
+
+        toggle_clean_recorded_automation();
+        play(1, 1);
+        written->points = flat(0.7);
+        edited->points.insert(edited->points.begin() + 21, {2.05, 0.5, 0, 0, false});
+        play(1, 3);
+        play(0, 3);
+        toggle_clean_recorded_automation();
+
+        const bool cleans = override_mode < 0;
+        expect((written->points.size() < 41) == cleans, "recorded automation clean of a Write track",
+               std::to_string(written->points.size()) + " points left, override " +
+                   std::to_string(override_mode));
+        expect(edited->points.size() == 42, "recorded automation leaves a Read track alone",
+               std::to_string(edited->points.size()) + " points left, override " +
+                   std::to_string(override_mode));
+    }
+    mock::reset();
+}
+
+// a routing spec leaves the user's own sends to its destinations alone, and prunes only by fully
+// pinned channels
+void check_routing_spec()
+{
+    mock::reset();
+    mock::Track *tracks[3] = {mock::add_track(), mock::add_track(), mock::add_track()};
+    MediaTrack *src = GetTrack(nullptr, 0), *dest = GetTrack(nullptr, 1), *other = GetTrack(nullptr, 2);
+    CreateTrackSend(src, dest); // the user's audio send
+    auto param = [&](int idx, const char *parm) { return GetTrackSendInfo_Value(src, 0, idx, parm); };
+
+    RoutingSpec midi {};
+    midi.source = {TrackSelector::Kind::Track, src};
+    midi.destination = {TrackSelector::Kind::Track, dest};
+    midi.mapping.src_chan = -1;
+    midi.mapping.midi_flags = 0x84;
+    RoutingDiff diff = apply_routing_spec(nullptr, midi, "Routing Check");
+    expect(diff.created == 1 && diff.updated == 0 && tracks[0]->sends.size() == 2,
+           "routing spec adds its own send next to the user's");
+    expect(param(0, "I_SRCCHAN") == 0 && param(0, "I_MIDIFLAGS") == 0,
+           "routing spec keeps the user's audio send");
+    expect(param(1, "I_SRCCHAN") == -1 && param(1, "I_MIDIFLAGS") == 0x84, "routing spec send channels");
+    expect(apply_routing_spec(nullptr, midi, "Routing Check").empty(), "routing spec applied twice");
+
+    // a volume-only mapping cannot tell its sends from the user's, so prune is ignored
+    CreateTrackSend(src, other);
+    RoutingSpec volume {};
+    volume.source = midi.source;
+    volume.destination = midi.destination;
+    volume.mapping.volume = 0.5;
+    volume.prune = true;
+    diff = apply_routing_spec(nullptr, volume, "Routing Check");
+    expect(diff.removed == 0 && tracks[0]->sends.size() == 3, "routing spec prune needs pinned channels");
+
+    // with every channel field pinned, only the matching send to a deselected track goes
+    midi.mapping.dst_chan = 0;
+    SetTrackSendInfo_Value(src, 0, 2, "I_SRCCHAN", -1);
+    SetTrackSendInfo_Value(src, 0, 2, "I_MIDIFLAGS", 0x84);
+    CreateTrackSend(src, other); // audio, stays
+    midi.prune = true;
+    diff = apply_routing_spec(nullptr, midi, "Routing Check");
+    expect(diff.removed == 1 && tracks[0]->sends.size() == 3 && tracks[0]->sends.back().dest == tracks[2],
+           "routing spec prunes its own sends only");
+    mock::reset();
+}
+
+// an index listed twice in the packed input steps its track once
+void check_batch_adjust_duplicates()
+{
+    mock::reset();
+    mock::Track *tracks[3] = {mock::add_track(), mock::add_track(), mock::add_track()};
+    const int modified = AdjustTracksVolume("1 0 1", true, false);
+    expect(modified == 2, "batch adjust modified count", std::to_string(modified));
+    expect(tracks[1]->vol == tracks[0]->vol && tracks[0]->vol > 1 && tracks[2]->vol == 1,
+           "batch adjust steps a duplicated index once", std::to_string(tracks[1]->vol));
+    expect(mock::project().undo_points == 1, "batch adjust undo points",
+           std::to_string(mock::project().undo_points));
+    mock::reset();
+}
+
+} // anonymous namespace
+
+int run_host_checks()
+{
+    failures = 0;
+    check_scheduler();
+    check_envelope_inventory();
+    check_rpp_clean_matches_action();
+    check_append_duplicate_items();
+    check_analysis_cache();
+    check_redetect_kick_triggers();
+    check_rerender_pump_envelope();
+    check_track_meter_detach();
+    check_clean_recorded_automation();
+    check_routing_spec();
+    check_batch_adjust_duplicates();
+
+    fprintf(stderr, "host checks: %s (%d failures)\n", failures ? "FAILED" : "ok", failures);
+    return failures;
+}
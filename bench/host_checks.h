@@ -0,0 +1,5 @@
+#pragma once
+
+// Behaviour checks of the toolkit's subsystems against the mock REAPER host, run by
+// ethlt_bench --check-only. Returns the number of failed checks.
+int run_host_checks();
@@ -0,0 +1,1538 @@
+#define REAPERAPI_IMPLEMENT
+#include "mock_reaper.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <thread>
+
+namespace mock
+{
+
+namespace
+{
+
+std::unique_ptr<Project> current_project;
+std::vector<audio_hook_register_t *> audio_hooks; // outlive projects, like REAPER's
+std::vector<IReaperControlSurface *> surfaces;    // likewise
+std::atomic<int> stale_reads {0};
+std::string resource_path = ".";
+
+inline Track *track_of(MediaTrack *track) { return reinterpret_cast<Track *>(track); }
+inline Item *item_of(MediaItem *item) { return reinterpret_cast<Item *>(item); }
+inline Take *take_of(MediaItem_Take *take) { return reinterpret_cast<Take *>(take); }
+inline Envelope *env_of(TrackEnvelope *env) { return reinterpret_cast<Envelope *>(env); }
+
+inline MediaTrack *handle_of(Track *track) { return reinterpret_cast<MediaTrack *>(track); }
+inline MediaItem *handle_of(Item *item) { return reinterpret_cast<MediaItem *>(item); }
+inline MediaItem_Take *handle_of(Take *take) { return reinterpret_cast<MediaItem_Take *>(take); }
+inline TrackEnvelope *handle_of(Envelope *env) { return reinterpret_cast<TrackEnvelope *>(env); }
+
+// -1 addresses the underlying envelope, like REAPER's autoitem_idx
+std::vector<EnvPoint> *points_of(TrackEnvelope *env, int autoitem_idx)
+{
+    Envelope *e = env_of(env);
+    autoitem_idx &= ~0x10000000; // loop-point flag, the mock has no looped automation items
+    if (autoitem_idx == 0xFFFFFFF || autoitem_idx < 0)
+        return &e->points;
+    if (autoitem_idx >= static_cast<int>(e->automation_items.size()))
+        return nullptr;
+    return &e->automation_items[autoitem_idx].points;
+}
+
+void sort_points(std::vector<EnvPoint> &points)
+{
+    std::stable_sort(points.begin(), points.end(),
+                     [](const EnvPoint &a, const EnvPoint &b) { return a.time < b.time; });
+}
+
+double *item_param(Item *item, const char *parm)
+{
+    if (!strcmp(parm, "D_VOL"))
+        return &item->vol;
+    if (!strcmp(parm, "D_POSITION"))
+        return &item->position;
+    if (!strcmp(parm, "D_LENGTH"))
+        return &item->length;
+    return nullptr;
+}
+
+// REAPER API implementations
+
+void ShowConsoleMsg_(const char *) { current_project->console_messages++; }
+// control surfaces only, the rest is accepted and ignored
+int plugin_register_(const char *name, void *info)
+{
+    auto *surface = static_cast<IReaperControlSurface *>(info);
+    if (!strcmp(name, "csurf_inst"))
+        surfaces.push_back(surface);
+    else if (!strcmp(name, "-csurf_inst"))
+        surfaces.erase(std::remove(surfaces.begin(), surfaces.end(), surface), surfaces.end());
+    return 0;
+}
+
+// REAPER tells the surfaces while the removed tracks are still allocated
+void track_list_changed()
+{
+    const std::vector<IReaperControlSurface *> notified = surfaces; // they may unregister themselves
+    for (IReaperControlSurface *surface : notified)
+        surface->SetTrackListChange();
+}
+void PreventUIRefresh_(int) { }
+void UpdateArrange_() { current_project->ui_refreshes++; }
+void UpdateTimeline_() { current_project->ui_refreshes++; }
+void TrackList_AdjustWindows_(bool isMinor)
+{
+    current_project->ui_refreshes++;
+    current_project->track_layout_updates += !isMinor;
+}
+
+// like REAPER, nested blocks and state changes inside a block fold into the outermost block
+void Undo_OnStateChange_(const char *)
+{
+    current_project->undo_points += current_project->undo_block_depth == 0;
+    current_project->state_change_count++;
+}
+
+void Undo_BeginBlock2_(ReaProject *) { current_project->undo_block_depth++; }
+
+void Undo_EndBlock2_(ReaProject *, const char *, int)
+{
+    current_project->undo_points += --current_project->undo_block_depth == 0;
+    current_project->state_change_count++;
+}
+
+int GetProjectStateChangeCount_(ReaProject *) { return current_project->state_change_count; }
+
+// one open project: the current one (-1) is also the first tab (0)
+ReaProject *EnumProjects_(int idx, char *fn, int fn_sz)
+{
+    if (fn && fn_sz > 0)
+        fn[0] = '\0';
+    return idx <= 0 ? reinterpret_cast<ReaProject *>(current_project.get()) : nullptr;
+}
+
+bool ValidatePtr2_(ReaProject *, void *pointer, const char *type)
+{
+    if (!strcmp(type, "MediaTrack*")) {
+        for (auto &track : current_project->tracks)
+            if (track.get() == pointer)
+                return true;
+        return false;
+    }
+    // other handles are only checked for null, the benchmark never passes stale ones
+    return pointer != nullptr;
+}
+
+// callers in the mock are native, so NeedBig buffers can't be grown
+bool realloc_cmd_ptr_(char **, int *, int) { return false; }
+
+const char *GetResourcePath_() { return resource_path.c_str(); }
+void GetProjectPath_(char *buf, int buf_sz) { snprintf(buf, buf_sz, "."); }
+
+int GetProjExtState_(ReaProject *, const char *section, const char *key, char *out, int out_sz)
+{
+    auto it = current_project->ext_state.find(std::string(section) + "/" + key);
+    if (it == current_project->ext_state.end()) {
+        if (out_sz > 0)
+            out[0] = '\0';
+        return 0;
+    }
+    snprintf(out, out_sz, "%s", it->second.c_str());
+    return static_cast<int>(it->second.size());
+}
+
+int SetProjExtState_(ReaProject *, const char *section, const char *key, const char *value)
+{
+    current_project->ext_state[std::string(section) + "/" + key] = value ? value : "";
+    return 1;
+}
+
+// global ext state outlives the project, as it does in REAPER
+std::map<std::string, std::string> global_ext_state;
+
+const char *GetExtState_(const char *section, const char *key)
+{
+    auto it = global_ext_state.find(std::string(section) + "/" + key);
+    return it == global_ext_state.end() ? "" : it->second.c_str();
+}
+
+void SetExtState_(const char *section, const char *key, const char *value, bool)
+{
+    global_ext_state[std::string(section) + "/" + key] = value ? value : "";
+}
+
+// dialogs are confirmed with whatever the caller filled in
+bool GetUserInputs_(const char *, int, const char *, char *, int) { return true; }
+int ShowMessageBox_(const char *, const char *, int) { return 1; }
+
+void genGuid_(GUID *g) { *g = make_guid(); }
+
+void guidToString_(const GUID *g, char *dest)
+{
+    const auto *b = reinterpret_cast<const unsigned char *>(g);
+    char *p = dest;
+    *p++ = '{';
+    for (size_t i = 0; i < sizeof(GUID); i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10)
+            *p++ = '-';
+        p += snprintf(p, 3, "%02X", b[i]);
+    }
+    *p++ = '}';
+    *p = '\0';
+}
+
+void stringToGuid_(const char *str, GUID *g)
+{
+    auto *b = reinterpret_cast<unsigned char *>(g);
+    memset(g, 0, sizeof(GUID));
+    size_t i = 0;
+    for (const char *p = str; *p && i < sizeof(GUID) * 2; p++) {
+        int nibble = isdigit(static_cast<unsigned char>(*p)) ? *p - '0'
+                     : isxdigit(static_cast<unsigned char>(*p))
+                         ? toupper(static_cast<unsigned char>(*p)) - 'A' + 10
+                         : -1;
+        if (nibble < 0)
+            continue;
+        b[i / 2] |= static_cast<unsigned char>(i % 2 ? nibble : nibble << 4);
+        i++;
+    }
+}
+
+// tracks
+
+int CountTracks_(ReaProject *) { return static_cast<int>(current_project->tracks.size()); }
+
+MediaTrack *GetTrack_(ReaProject *, int idx)
+{
+    if (idx < 0 || idx >= static_cast<int>(current_project->tracks.size()))
+        return nullptr;
+    return handle_of(current_project->tracks[idx].get());
+}
+
+void InsertTrackInProject_(ReaProject *, int idx, int)
+{
+    auto track = std::make_unique<Track>();
+    track->guid = make_guid();
+    idx = std::clamp(idx, 0, static_cast<int>(current_project->tracks.size()));
+    current_project->tracks.insert(current_project->tracks.begin() + idx, std::move(track));
+    current_project->item_index_dirty = true;
+    track_list_changed();
+}
+
+void DeleteTrack_(MediaTrack *track)
+{
+    auto &tracks = current_project->tracks;
+    auto it = std::find_if(tracks.begin(), tracks.end(), [&](const auto &t) { return t.get() == track_of(track); });
+    if (it == tracks.end())
+        return;
+    const std::unique_ptr<Track> removed = std::move(*it);
+    tracks.erase(it);
+    current_project->item_index_dirty = true;
+    track_list_changed();
+}
+
+bool IsTrackSelected_(MediaTrack *track) { return track_of(track)->selected; }
+
+// audio
+
+int Audio_RegHardwareHook_(bool add, audio_hook_register_t *reg)
+{
+    audio_hooks.erase(std::remove(audio_hooks.begin(), audio_hooks.end(), reg), audio_hooks.end());
+    if (add)
+        audio_hooks.push_back(reg);
+    return 1;
+}
+
+// reading a track that is gone counts as a stale read instead of touching freed memory; the main
+// thread waits for run_audio, so the track list holds still meanwhile
+double Track_GetPeakInfo_(MediaTrack *track, int)
+{
+    const auto &tracks = current_project->tracks;
+    if (std::none_of(tracks.begin(), tracks.end(), [&](const auto &t) { return t.get() == track_of(track); })) {
+        stale_reads.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    return track_of(track)->meter_peak * track_of(track)->vol;
+}
+
+int CountSelectedTracks_(ReaProject *)
+{
+    int count = 0;
+    for (auto &track : current_project->tracks)
+        count += track->selected;
+    return count;
+}
+
+MediaTrack *GetSelectedTrack_(ReaProject *, int idx)
+{
+    for (auto &track : current_project->tracks) {
+        if (track->selected && idx-- == 0)
+            return handle_of(track.get());
+    }
+    return nullptr;
+}
+void SetTrackSelected_(MediaTrack *track, bool selected) { track_of(track)->selected = selected; }
+
+void SetOnlyTrackSelected_(MediaTrack *track)
+{
+    for (auto &t : current_project->tracks)
+        t->selected = t.get() == track_of(track);
+}
+
+double GetMediaTrackInfo_Value_(MediaTrack *track, const char *parm)
+{
+    return !strcmp(parm, "D_VOL") ? track_of(track)->vol : 0;
+}
+
+bool SetMediaTrackInfo_Value_(MediaTrack *track, const char *parm, double value)
+{
+    if (strcmp(parm, "D_VOL"))
+        return false;
+    track_of(track)->vol = value;
+    return true;
+}
+
+bool GetSetMediaTrackInfo_String_(MediaTrack *track, const char *parm, char *buf, bool set)
+{
+    Track *t = track_of(track);
+    std::string *value = nullptr;
+    if (!strcmp(parm, "P_NAME"))
+        value = &t->name;
+    else if (!strncmp(parm, "P_EXT:", 6))
+        value = &t->ext[parm + 6];
+    if (!value)
+        return false;
+
+    if (set) {
+        *value = buf;
+        return true;
+    }
+    if (value->empty() && strncmp(parm, "P_EXT:", 6) == 0)
+        return false;
+    // REAPER doesn't pass the buffer size here, callers size their buffers for the expected value
+    strcpy(buf, value->c_str());
+    return true;
+}
+
+bool GetTrackName_(MediaTrack *track, char *buf, int buf_sz)
+{
+    snprintf(buf, buf_sz, "%s", track_of(track)->name.c_str());
+    return true;
+}
+
+GUID *GetTrackGUID_(MediaTrack *track) { return &track_of(track)->guid; }
+
+// FX
+
+int TrackFX_AddByName_(MediaTrack *track, const char *name, bool, int instantiate)
+{
+    Track *t = track_of(track);
+    for (size_t i = 0; i < t->fx.size(); i++)
+        if (t->fx[i].name == name)
+            return static_cast<int>(i);
+    if (instantiate == 0)
+        return -1;
+    t->fx.push_back({name, make_guid(), {}});
+    return static_cast<int>(t->fx.size() - 1);
+}
+
+int TrackFX_GetCount_(MediaTrack *track) { return static_cast<int>(track_of(track)->fx.size()); }
+
+GUID *TrackFX_GetFXGUID_(MediaTrack *track, int fx)
+{
+    Track *t = track_of(track);
+    if (fx < 0 || fx >= static_cast<int>(t->fx.size()))
+        return nullptr;
+    return &t->fx[fx].guid;
+}
+
+bool TrackFX_SetPreset_(MediaTrack *, int, const char *) { return true; }
+
+double TrackFX_GetParam_(MediaTrack *, int, int, double *min_val, double *max_val)
+{
+    if (min_val)
+        *min_val = 0;
+    if (max_val)
+        *max_val = 1;
+    return 0;
+}
+
+TrackEnvelope *GetFXEnvelope_(MediaTrack *track, int fx, int param, bool create)
+{
+    Track *t = track_of(track);
+    if (fx < 0 || fx >= static_cast<int>(t->fx.size()))
+        return nullptr;
+    auto &envs = t->fx[fx].param_envelopes;
+    if (static_cast<int>(envs.size()) <= param) {
+        if (!create)
+            return nullptr;
+        envs.resize(param + 1);
+    }
+    if (!envs[param]) {
+        if (!create)
+            return nullptr;
+        envs[param] = std::make_unique<Envelope>();
+        envs[param]->type = "PARMENV " + std::to_string(param) + " 0 1 0.5";
+    }
+    return handle_of(envs[param].get());
+}
+
+// sends
+
+int GetTrackNumSends_(MediaTrack *track, int category)
+{
+    Track *t = track_of(track);
+    if (category == 0)
+        return static_cast<int>(t->sends.size());
+    if (category < 0) {
+        int n = 0;
+        for (auto &src : current_project->tracks)
+            for (const Send &send : src->sends)
+                n += send.dest == t;
+        return n;
+    }
+    return 0;
+}
+
+Send *find_send(MediaTrack *track, int category, int idx)
+{
+    Track *t = track_of(track);
+    if (category == 0)
+        return idx >= 0 && idx < static_cast<int>(t->sends.size()) ? &t->sends[idx] : nullptr;
+    return nullptr;
+}
+
+double GetTrackSendInfo_Value_(MediaTrack *track, int category, int idx, const char *parm)
+{
+    if (category < 0 && !strcmp(parm, "P_SRCTRACK")) {
+        for (auto &src : current_project->tracks)
+            for (const Send &send : src->sends)
+                if (send.dest == track_of(track) && idx-- == 0)
+                    return static_cast<double>(reinterpret_cast<uintptr_t>(src.get()));
+        return 0;
+    }
+    Send *send = find_send(track, category, idx);
+    if (!send)
+        return 0;
+    auto it = send->params.find(parm);
+    return it == send->params.end() ? 0 : it->second;
+}
+
+bool SetTrackSendInfo_Value_(MediaTrack *track, int category, int idx, const char *parm, double value)
+{
+    Send *send = find_send(track, category, idx);
+    if (!send)
+        return false;
+    send->params[parm] = value;
+    return true;
+}
+
+void *GetSetTrackSendInfo_(MediaTrack *track, int category, int idx, const char *parm, void *)
+{
+    Send *send = find_send(track, category, idx);
+    if (!send || strcmp(parm, "P_DESTTRACK"))
+        return nullptr;
+    return handle_of(send->dest);
+}
+
+int CreateTrackSend_(MediaTrack *track, MediaTrack *dest)
+{
+    Track *t = track_of(track);
+    t->sends.push_back({track_of(dest), {{"D_VOL", 1}, {"I_SRCCHAN", 0}, {"I_DSTCHAN", 0}}});
+    return static_cast<int>(t->sends.size() - 1);
+}
+
+bool RemoveTrackSend_(MediaTrack *track, int category, int idx)
+{
+    Track *t = track_of(track);
+    if (category != 0 || idx < 0 || idx >= static_cast<int>(t->sends.size()))
+        return false;
+    t->sends.erase(t->sends.begin() + idx);
+    return true;
+}
+
+// items and takes
+
+const std::vector<Item *> &item_index()
+{
+    Project &p = *current_project;
+    if (p.item_index_dirty) {
+        p.item_index.clear();
+        for (auto &track : p.tracks)
+            for (auto &item : track->items)
+                p.item_index.push_back(item.get());
+        p.item_index_dirty = false;
+    }
+    return p.item_index;
+}
+
+int CountMediaItems_(ReaProject *) { return static_cast<int>(item_index().size()); }
+
+MediaItem *GetMediaItem_(ReaProject *, int idx)
+{
+    const std::vector<Item *> &items = item_index();
+    return idx >= 0 && idx < static_cast<int>(items.size()) ? handle_of(items[idx]) : nullptr;
+}
+
+int CountTrackMediaItems_(MediaTrack *track) { return static_cast<int>(track_of(track)->items.size()); }
+
+MediaItem *GetTrackMediaItem_(MediaTrack *track, int idx)
+{
+    Track *t = track_of(track);
+    return idx >= 0 && idx < static_cast<int>(t->items.size()) ? handle_of(t->items[idx].get()) : nullptr;
+}
+
+bool IsMediaItemSelected_(MediaItem *item) { return item_of(item)->selected; }
+void SetMediaItemSelected_(MediaItem *item, bool selected) { item_of(item)->selected = selected; }
+MediaTrack *GetMediaItem_Track_(MediaItem *item) { return handle_of(item_of(item)->track); }
+
+double GetMediaItemInfo_Value_(MediaItem *item, const char *parm)
+{
+    double *value = item_param(item_of(item), parm);
+    return value ? *value : 0;
+}
+
+bool SetMediaItemInfo_Value_(MediaItem *item, const char *parm, double value)
+{
+    double *slot = item_param(item_of(item), parm);
+    if (!slot)
+        return false;
+    *slot = value;
+    return true;
+}
+
+int CountTakes_(MediaItem *item) { return static_cast<int>(item_of(item)->takes.size()); }
+
+MediaItem_Take *GetMediaItemTake_(MediaItem *item, int idx)
+{
+    Item *i = item_of(item);
+    return idx >= 0 && idx < static_cast<int>(i->takes.size()) ? handle_of(i->takes[idx].get()) : nullptr;
+}
+
+int CountSelectedMediaItems_(ReaProject *)
+{
+    int count = 0;
+    for (Item *item : item_index())
+        count += item->selected;
+    return count;
+}
+
+MediaItem *GetSelectedMediaItem_(ReaProject *, int idx)
+{
+    for (Item *item : item_index()) {
+        if (item->selected && idx-- == 0)
+            return handle_of(item);
+    }
+    return nullptr;
+}
+
+MediaItem_Take *GetActiveTake_(MediaItem *item)
+{
+    Item *i = item_of(item);
+    return i->takes.empty() ? nullptr : handle_of(i->takes.front().get());
+}
+
+// audio: a take stands in for its own source
+
+struct Accessor
+{
+    const Take *take;   // or
+    const Track *track;
+};
+
+// one period of a sine, 100 frames long
+const double *sine_table()
+{
+    static const std::vector<double> table = [] {
+        std::vector<double> t(100);
+        for (size_t i = 0; i < t.size(); i++)
+            t[i] = std::sin(2 * 3.14159265358979323846 * static_cast<double>(i) / t.size());
+        return t;
+    }();
+    return table.data();
+}
+
+bool TakeIsMIDI_(MediaItem_Take *take) { return take_of(take)->sample_rate == 0; }
+PCM_source *GetMediaItemTake_Source_(MediaItem_Take *take) { return handle<PCM_source>(take); }
+int TakeFX_GetCount_(MediaItem_Take *) { return 0; }
+
+void GetMediaSourceFileName_(PCM_source *source, char *buf, int buf_sz)
+{
+    snprintf(buf, buf_sz, "%s", handle<Take>(source)->file.c_str());
+}
+
+bool GetSetMediaItemTakeInfo_String_(MediaItem_Take *take, const char *parm, char *buf, bool set)
+{
+    Take *t = take_of(take);
+    std::string *value = nullptr;
+    if (!strcmp(parm, "GUID")) {
+        if (set)
+            stringToGuid_(buf, &t->guid);
+        else
+            guidToString_(&t->guid, buf);
+        return true;
+    }
+    if (!strcmp(parm, "P_NAME"))
+        value = &t->name;
+    else if (!strncmp(parm, "P_EXT:", 6))
+        value = &t->ext[parm + 6];
+    if (!value)
+        return false;
+
+    if (set) {
+        *value = buf;
+        return true;
+    }
+    if (value->empty() && strncmp(parm, "P_EXT:", 6) == 0)
+        return false;
+    strcpy(buf, value->c_str());
+    return true;
+}
+
+MediaItem *CreateNewMIDIItemInProj_(MediaTrack *track, double start, double end, const bool *)
+{
+    Item *item = add_item(track_of(track), start, end - start);
+    add_take(item);
+    return handle_of(item);
+}
+
+MediaItem *AddMediaItemToTrack_(MediaTrack *track) { return handle_of(add_item(track_of(track), 0, 0)); }
+
+// the chunk carries the position, length, selection and take envelope GUIDs; takes are referred to
+// by address, so SetItemStateChunk copies them from the item the chunk was read from
+bool GetItemStateChunk_(MediaItem *item, char *buf, int size, bool)
+{
+    const Item *i = item_of(item);
+    std::string chunk;
+    char line[128];
+    snprintf(line, sizeof(line), "<ITEM\nPOSITION %.17g\nLENGTH %.17g\nSEL %d\nVOLPAN %.17g 0 1 -1\n",
+             i->position, i->length, i->selected ? 1 : 0, i->vol);
+    chunk += line;
+    for (const auto &take : i->takes) {
+        char guid[64];
+        guidToString_(&take->guid, guid);
+        snprintf(line, sizeof(line), "TAKE\nGUID %s\n<SOURCE MOCK\nMOCKTAKE %p\n>\n", guid,
+                 static_cast<const void *>(take.get()));
+        chunk += line;
+        for (const auto &env : take->envelopes) {
+            guidToString_(&env->guid, guid);
+            chunk += "<" + env->type + "\nEGUID " + guid + "\n>\n";
+        }
+    }
+    chunk += ">\n";
+    if (size <= 0)
+        return false;
+    snprintf(buf, size, "%s", chunk.c_str());
+    return static_cast<int>(chunk.size()) < size;
+}
+
+// reads what guidToString_ writes
+GUID parse_guid(const char *str)
+{
+    GUID guid {};
+    auto *b = reinterpret_cast<unsigned char *>(&guid);
+    for (size_t i = 0; i < sizeof(GUID) && *str; str++) {
+        unsigned int byte;
+        if (isxdigit(static_cast<unsigned char>(*str)) && sscanf(str, "%2x", &byte) == 1) {
+            b[i++] = static_cast<unsigned char>(byte);
+            str++;
+        }
+    }
+    return guid;
+}
+
+bool SetItemStateChunk_(MediaItem *item, const char *str, bool)
+{
+    Item *i = item_of(item);
+    i->takes.clear();
+    GUID take_guid = make_guid();
+    size_t env_index = 0; // of the last take's envelopes, in chunk order
+    for (const char *line = str; line && *line;) {
+        while (*line == ' ')
+            line++;
+        int selected;
+        void *source;
+        // each only matches its own line
+        sscanf(line, "POSITION %lf", &i->position);
+        sscanf(line, "LENGTH %lf", &i->length);
+        sscanf(line, "VOLPAN %lf", &i->vol);
+        if (sscanf(line, "SEL %d", &selected) == 1)
+            i->selected = selected != 0;
+        if (!strncmp(line, "GUID ", 5))
+            take_guid = parse_guid(line + 5);
+        if (!strncmp(line, "EGUID ", 6) && !i->takes.empty() && env_index < i->takes.back()->envelopes.size())
+            i->takes.back()->envelopes[env_index++]->guid = parse_guid(line + 6);
+        if (sscanf(line, "MOCKTAKE %p", &source) == 1) {
+            const Take *take = static_cast<const Take *>(source);
+            auto copy = std::make_unique<Take>(Take {i, take->name, take->vol, take->notes, take->sample_rate,
+                                                     take->channels, take->amplitude, take->file, take->ext, {},
+                                                     take_guid});
+            for (const auto &env : take->envelopes)
+                copy->envelopes.push_back(std::make_unique<Envelope>(*env));
+            i->takes.push_back(std::move(copy));
+            env_index = 0;
+        }
+        line = strchr(line, '\n');
+        line = line ? line + 1 : nullptr;
+    }
+    current_project->item_index_dirty = true;
+    return true;
+}
+
+bool DeleteTrackMediaItem_(MediaTrack *track, MediaItem *item)
+{
+    auto &items = track_of(track)->items;
+    auto it = std::find_if(items.begin(), items.end(), [&](auto &i) { return i.get() == item_of(item); });
+    if (it == items.end())
+        return false;
+    items.erase(it);
+    current_project->item_index_dirty = true;
+    return true;
+}
+
+double GetMediaItemTakeInfo_Value_(MediaItem_Take *take, const char *parm)
+{
+    if (!strcmp(parm, "D_VOL"))
+        return take_of(take)->vol;
+    if (!strcmp(parm, "D_PLAYRATE"))
+        return 1;
+    return 0;
+}
+int GetMediaSourceSampleRate_(PCM_source *source) { return handle<Take>(source)->sample_rate; }
+int GetMediaSourceNumChannels_(PCM_source *source) { return handle<Take>(source)->channels; }
+
+AudioAccessor *CreateTakeAudioAccessor_(MediaItem_Take *take)
+{
+    return handle<AudioAccessor>(new Accessor {take_of(take), nullptr});
+}
+
+AudioAccessor *CreateTrackAudioAccessor_(MediaTrack *track)
+{
+    return handle<AudioAccessor>(new Accessor {nullptr, track_of(track)});
+}
+
+void DestroyAudioAccessor_(AudioAccessor *accessor) { delete handle<Accessor>(accessor); }
+double GetAudioAccessorStartTime_(AudioAccessor *) { return 0; }
+
+double GetAudioAccessorEndTime_(AudioAccessor *accessor)
+{
+    const Accessor *a = handle<Accessor>(accessor);
+    return a->track ? a->track->audio_length : a->take->item->length;
+}
+
+int track_samples(const Track *track, int rate, int channels, double time, int frames, double *buf)
+{
+    constexpr double PI = 3.14159265358979323846;
+    for (int i = 0; i < frames; i++) {
+        const double t = time + static_cast<double>(i) / rate;
+        double sample = 0;
+        if (track->kick_interval > 0 && t >= 0 && t < track->audio_length) {
+            const double since_kick = std::fmod(t, track->kick_interval);
+            sample = 0.01 * std::sin(2 * PI * 3000 * t);
+            if (since_kick < 0.3)
+                sample += 0.8 * std::sin(2 * PI * 55 * since_kick) * std::exp(-since_kick * 20);
+        }
+        for (int c = 0; c < channels; c++)
+            *buf++ = sample;
+    }
+    return 1;
+}
+
+// reads only the take or track itself, so it is safe from worker threads like the real one
+int GetAudioAccessorSamples_(AudioAccessor *accessor, int rate, int channels, double time, int frames,
+                             double *buf)
+{
+    if (const Track *track = handle<Accessor>(accessor)->track)
+        return track_samples(track, rate, channels, time, frames, buf);
+
+    const Take *take = handle<Accessor>(accessor)->take;
+    const double *sine = sine_table();
+    const long long first = std::llround(time * rate);
+    for (int i = 0; i < frames; i++) {
+        const double sample = take->amplitude * sine[(first + i) % 100];
+        for (int c = 0; c < channels; c++)
+            *buf++ = sample;
+    }
+    return 1;
+}
+
+// envelopes
+
+int CountTrackEnvelopes_(MediaTrack *track) { return static_cast<int>(track_of(track)->envelopes.size()); }
+
+TrackEnvelope *GetTrackEnvelope_(MediaTrack *track, int idx)
+{
+    Track *t = track_of(track);
+    return idx >= 0 && idx < static_cast<int>(t->envelopes.size()) ? handle_of(t->envelopes[idx].get())
+                                                                     : nullptr;
+}
+
+int CountTakeEnvelopes_(MediaItem_Take *take) { return static_cast<int>(take_of(take)->envelopes.size()); }
+
+TrackEnvelope *GetTakeEnvelope_(MediaItem_Take *take, int idx)
+{
+    Take *t = take_of(take);
+    return idx >= 0 && idx < static_cast<int>(t->envelopes.size()) ? handle_of(t->envelopes[idx].get())
+                                                                     : nullptr;
+}
+
+TrackEnvelope *GetSelectedEnvelope_(ReaProject *) { return handle_of(current_project->selected_envelope); }
+
+bool GetEnvelopeStateChunk_(TrackEnvelope *env, char *buf, int buf_sz, bool)
+{
+    std::string chunk = "<" + env_of(env)->type + "\nACT 1 -1\nVIS 1 1 1\nARM 0\nDEFSHAPE 0 -1 -1\n";
+    for (const EnvPoint &pt : env_of(env)->points)
+        chunk += "PT " + std::to_string(pt.time) + " " + std::to_string(pt.value) + " " +
+                 std::to_string(pt.shape) + "\n";
+    for (const AutomationItem &ai : env_of(env)->automation_items)
+        chunk += "POOLEDENVINST " + std::to_string(ai.pool_id) + " " + std::to_string(ai.position) + " " +
+                 std::to_string(ai.length) + " 0 1 0 0 0 0 0\n";
+    chunk += ">\n";
+    snprintf(buf, buf_sz, "%s", chunk.c_str());
+    return true;
+}
+
+// only automation items can go away here: those whose POOLEDENVINST line is missing
+bool SetEnvelopeStateChunk_(TrackEnvelope *env, const char *chunk, bool)
+{
+    std::vector<AutomationItem> kept;
+    for (const char *line = chunk; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : nullptr) {
+        int pool_id;
+        double position;
+        if (sscanf(line, "POOLEDENVINST %d %lf", &pool_id, &position) != 2)
+            continue;
+        for (AutomationItem &ai : env_of(env)->automation_items) {
+            if (ai.pool_id == pool_id && std::fabs(ai.position - position) < 1e-5) {
+                kept.push_back(std::move(ai));
+                ai.pool_id = -1; // matched once
+                break;
+            }
+        }
+    }
+    env_of(env)->automation_items = std::move(kept);
+    return true;
+}
+
+// a pooled instance copies the points of an existing one, shifted to its position
+int InsertAutomationItem_(TrackEnvelope *env, int pool_id, double position, double length)
+{
+    auto &items = env_of(env)->automation_items;
+    AutomationItem ai {pool_id, position, length, {}};
+    if (pool_id < 0) {
+        ai.pool_id = current_project->next_pool_id++;
+    } else {
+        for (const AutomationItem &other : items) {
+            if (other.pool_id == pool_id) {
+                ai.points = other.points;
+                for (EnvPoint &pt : ai.points)
+                    pt.time += position - other.position;
+                break;
+            }
+        }
+    }
+    items.push_back(std::move(ai));
+    return static_cast<int>(items.size()) - 1;
+}
+
+double GetSetAutomationItemInfo_(TrackEnvelope *env, int idx, const char *parm, double value, bool set)
+{
+    auto &items = env_of(env)->automation_items;
+    if (idx < 0 || idx >= static_cast<int>(items.size()))
+        return 0;
+    AutomationItem &ai = items[idx];
+    double *slot = !strcmp(parm, "D_POSITION") ? &ai.position : !strcmp(parm, "D_LENGTH") ? &ai.length : nullptr;
+    if (!strcmp(parm, "D_POOL_ID"))
+        return ai.pool_id;
+    if (!slot)
+        return 0;
+    if (set)
+        *slot = value;
+    return *slot;
+}
+
+// the chunk tag stands in for REAPER's display name
+bool GetEnvelopeName_(TrackEnvelope *env, char *buf, int buf_sz)
+{
+    const std::string &type = env_of(env)->type;
+    snprintf(buf, buf_sz, "%s", type.substr(0, type.find(' ')).c_str());
+    return true;
+}
+
+int GetEnvelopeScalingMode_(TrackEnvelope *env) { return env_of(env)->scaling_mode; }
+double ScaleFromEnvelopeMode_(int, double value) { return value; }
+double ScaleToEnvelopeMode_(int, double value) { return value; }
+
+int CountAutomationItems_(TrackEnvelope *env) { return static_cast<int>(env_of(env)->automation_items.size()); }
+
+int CountEnvelopePointsEx_(TrackEnvelope *env, int autoitem_idx)
+{
+    std::vector<EnvPoint> *points = points_of(env, autoitem_idx);
+    return points ? static_cast<int>(points->size()) : 0;
+}
+
+bool GetEnvelopePointEx_(TrackEnvelope *env, int autoitem_idx, int idx, double *time, double *value,
+                         int *shape, double *tension, bool *selected)
+{
+    std::vector<EnvPoint> *points = points_of(env, autoitem_idx);
+    if (!points || idx < 0 || idx >= static_cast<int>(points->size()))
+        return false;
+    const EnvPoint &pt = (*points)[idx];
+    if (time)
+        *time = pt.time;
+    if (value)
+        *value = pt.value;
+    if (shape)
+        *shape = pt.shape;
+    if (tension)
+        *tension = pt.tension;
+    if (selected)
+        *selected = pt.selected;
+    return true;
+}
+
+bool SetEnvelopePointEx_(TrackEnvelope *env, int autoitem_idx, int idx, double *time, double *value,
+                         int *shape, double *tension, bool *selected, bool *nosort)
+{
+    std::vector<EnvPoint> *points = points_of(env, autoitem_idx);
+    if (!points || idx < 0 || idx >= static_cast<int>(points->size()))
+        return false;
+    EnvPoint &pt = (*points)[idx];
+    if (time)
+        pt.time = *time;
+    if (value)
+        pt.value = *value;
+    if (shape)
+        pt.shape = *shape;
+    if (tension)
+        pt.tension = *tension;
+    if (selected)
+        pt.selected = *selected;
+    if (!nosort || !*nosort)
+        sort_points(*points);
+    return true;
+}
+
+bool InsertEnvelopePointEx_(TrackEnvelope *env, int autoitem_idx, double time, double value, int shape,
+                            double tension, bool selected, bool *nosort)
+{
+    std::vector<EnvPoint> *points = points_of(env, autoitem_idx);
+    if (!points)
+        return false;
+    points->push_back({time, value, shape, tension, selected});
+    if (!nosort || !*nosort)
+        sort_points(*points);
+    return true;
+}
+
+bool DeleteEnvelopePointEx_(TrackEnvelope *env, int autoitem_idx, int idx)
+{
+    std::vector<EnvPoint> *points = points_of(env, autoitem_idx);
+    if (!points || idx < 0 || idx >= static_cast<int>(points->size()))
+        return false;
+    points->erase(points->begin() + idx);
+    return true;
+}
+
+int GetEnvelopePointByTimeEx_(TrackEnvelope *env, int autoitem_idx, double time)
+{
+    std::vector<EnvPoint> *points = points_of(env, autoitem_idx);
+    if (!points)
+        return -1;
+    auto after = std::upper_bound(points->begin(), points->end(), time,
+                                  [](double t, const EnvPoint &pt) { return t < pt.time; });
+    return static_cast<int>(after - points->begin()) - 1;
+}
+
+bool DeleteEnvelopePointRangeEx_(TrackEnvelope *env, int autoitem_idx, double start, double end)
+{
+    std::vector<EnvPoint> *points = points_of(env, autoitem_idx);
+    if (!points)
+        return false;
+    points->erase(std::remove_if(points->begin(), points->end(),
+                                 [=](const EnvPoint &pt) { return pt.time >= start && pt.time < end; }),
+                  points->end());
+    return true;
+}
+
+bool Envelope_SortPoints_(TrackEnvelope *env)
+{
+    sort_points(env_of(env)->points);
+    return true;
+}
+
+bool Envelope_SortPointsEx_(TrackEnvelope *env, int autoitem_idx)
+{
+    std::vector<EnvPoint> *points = points_of(env, autoitem_idx);
+    if (!points)
+        return false;
+    sort_points(*points);
+    return true;
+}
+
+// MIDI
+
+HWND MIDIEditor_GetActive_()
+{
+    return current_project->midi_editor_take ? reinterpret_cast<HWND>(current_project.get()) : nullptr;
+}
+
+MediaItem_Take *MIDIEditor_GetTake_(HWND) { return handle_of(current_project->midi_editor_take); }
+
+int MIDI_CountEvts_(MediaItem_Take *take, int *notecnt, int *cccnt, int *textcnt)
+{
+    int n = static_cast<int>(take_of(take)->notes.size());
+    if (notecnt)
+        *notecnt = n;
+    if (cccnt)
+        *cccnt = 0;
+    if (textcnt)
+        *textcnt = 0;
+    return n;
+}
+
+bool MIDI_GetNote_(MediaItem_Take *take, int idx, bool *selected, bool *muted, double *start, double *end,
+                   int *chan, int *pitch, int *vel)
+{
+    auto &notes = take_of(take)->notes;
+    if (idx < 0 || idx >= static_cast<int>(notes.size()))
+        return false;
+    const Note &n = notes[idx];
+    if (selected)
+        *selected = n.selected;
+    if (muted)
+        *muted = n.muted;
+    if (start)
+        *start = n.start_ppq;
+    if (end)
+        *end = n.end_ppq;
+    if (chan)
+        *chan = n.chan;
+    if (pitch)
+        *pitch = n.pitch;
+    if (vel)
+        *vel = n.vel;
+    return true;
+}
+
+void sort_notes(std::vector<Note> &notes)
+{
+    std::stable_sort(notes.begin(), notes.end(),
+                     [](const Note &a, const Note &b) { return a.start_ppq < b.start_ppq; });
+}
+
+bool MIDI_SetNote_(MediaItem_Take *take, int idx, const bool *selected, const bool *muted, const double *start,
+                   const double *end, const int *chan, const int *pitch, const int *vel, const bool *nosort)
+{
+    auto &notes = take_of(take)->notes;
+    if (idx < 0 || idx >= static_cast<int>(notes.size()))
+        return false;
+    Note &n = notes[idx];
+    if (selected)
+        n.selected = *selected;
+    if (muted)
+        n.muted = *muted;
+    if (start)
+        n.start_ppq = *start;
+    if (end)
+        n.end_ppq = *end;
+    if (chan)
+        n.chan = *chan;
+    if (pitch)
+        n.pitch = *pitch;
+    if (vel)
+        n.vel = *vel;
+    if (!nosort || !*nosort)
+        sort_notes(notes);
+    return true;
+}
+
+bool MIDI_InsertNote_(MediaItem_Take *take, bool selected, bool muted, double start, double end, int chan,
+                      int pitch, int vel, const bool *nosort)
+{
+    auto &notes = take_of(take)->notes;
+    notes.push_back({selected, muted, start, end, chan, pitch, vel});
+    if (!nosort || !*nosort)
+        sort_notes(notes);
+    return true;
+}
+
+bool MIDI_DeleteNote_(MediaItem_Take *take, int idx)
+{
+    auto &notes = take_of(take)->notes;
+    if (idx < 0 || idx >= static_cast<int>(notes.size()))
+        return false;
+    notes.erase(notes.begin() + idx);
+    return true;
+}
+
+void MIDI_Sort_(MediaItem_Take *take) { sort_notes(take_of(take)->notes); }
+
+// notes only; note-offs pair with the latest open note of the same channel and pitch
+bool MIDI_SetAllEvts_(MediaItem_Take *take, const char *buf, int buf_sz)
+{
+    std::vector<Note> &notes = take_of(take)->notes;
+    notes.clear();
+    long long ppq = 0;
+    for (int pos = 0; pos + 9 <= buf_sz;) {
+        int32_t offset, length;
+        memcpy(&offset, buf + pos, 4);
+        const unsigned char flags = static_cast<unsigned char>(buf[pos + 4]);
+        memcpy(&length, buf + pos + 5, 4);
+        pos += 9;
+        if (length < 0 || pos + length > buf_sz)
+            return false;
+        const unsigned char *msg = reinterpret_cast<const unsigned char *>(buf + pos);
+        pos += length;
+        ppq += offset;
+        if (length < 3)
+            continue;
+
+        const int type = msg[0] & 0xF0, chan = msg[0] & 0x0F;
+        if (type == 0x90 && msg[2] > 0) {
+            notes.push_back({(flags & 1) != 0, (flags & 2) != 0, static_cast<double>(ppq),
+                             static_cast<double>(ppq), chan, msg[1], msg[2]});
+        } else if (type == 0x80 || type == 0x90) {
+            for (auto it = notes.rbegin(); it != notes.rend(); ++it) {
+                if (it->chan == chan && it->pitch == msg[1] && it->end_ppq == it->start_ppq) {
+                    it->end_ppq = static_cast<double>(ppq);
+                    break;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+double MIDI_GetGrid_(MediaItem_Take *, double *swing, double *note_len)
+{
+    if (swing)
+        *swing = 0;
+    if (note_len)
+        *note_len = 0;
+    return current_project->midi_grid_division * 4; // in quarter notes
+}
+
+void SetMIDIEditorGrid_(ReaProject *, double division) { current_project->midi_grid_division = division; }
+
+// fixed 120 BPM and 960 PPQ, counted from the start of the item
+constexpr double PPQ_PER_SECOND = 960 * 2;
+
+double MIDI_GetPPQPosFromProjTime_(MediaItem_Take *take, double time)
+{
+    const Take *t = take_of(take);
+    return (time - (t->item ? t->item->position : 0)) * PPQ_PER_SECOND;
+}
+
+double TimeMap2_timeToBeats_(ReaProject *, double time, int *measures, int *cml, double *full_beats, int *cdenom)
+{
+    const double bar = current_project->bar_length;
+    const int measure = static_cast<int>(std::floor(time / bar));
+    if (measures)
+        *measures = measure;
+    if (cml)
+        *cml = 4;
+    if (full_beats)
+        *full_beats = time / bar * 4;
+    if (cdenom)
+        *cdenom = 4;
+    return (time - measure * bar) / bar * 4;
+}
+
+double TimeMap2_beatsToTime_(ReaProject *, double beats, const int *measures)
+{
+    const double bar = current_project->bar_length;
+    return (measures ? *measures : 0) * bar + beats * bar / 4;
+}
+
+double MIDI_GetProjTimeFromPPQPos_(MediaItem_Take *take, double ppq)
+{
+    const Take *t = take_of(take);
+    return ppq / PPQ_PER_SECOND + (t->item ? t->item->position : 0);
+}
+
+// UI state
+
+int GetCursorContext2_(bool) { return current_project->cursor_context; }
+
+void GetMousePosition_(int *x, int *y)
+{
+    *x = 0;
+    *y = 0;
+}
+
+MediaItem *GetItemFromPoint_(int, int, bool, MediaItem_Take **take)
+{
+    Item *item = current_project->item_under_mouse;
+    if (take)
+        *take = item && !item->takes.empty() ? handle_of(item->takes[0].get()) : nullptr;
+    return handle_of(item);
+}
+
+MediaTrack *GetThingFromPoint_(int, int, char *info, int info_sz)
+{
+    snprintf(info, info_sz, "%s", current_project->track_under_mouse ? "tcp" : "arrange");
+    return handle_of(current_project->track_under_mouse);
+}
+
+double GetCursorPosition_() { return current_project->edit_cursor; }
+int GetPlayState_() { return current_project->play_state; }
+double GetPlayPosition2_() { return current_project->play_position; }
+int GetTrackAutomationMode_(MediaTrack *track) { return track_of(track)->automation_mode; }
+int GetGlobalAutomationOverride_() { return current_project->automation_override; }
+void SetEditCurPos_(double time, bool, bool) { current_project->edit_cursor = time; }
+
+void GetSet_LoopTimeRange2_(ReaProject *, bool set, bool, double *start, double *end, bool)
+{
+    if (set) {
+        current_project->time_selection_start = *start;
+        current_project->time_selection_end = *end;
+    } else {
+        *start = current_project->time_selection_start;
+        *end = current_project->time_selection_end;
+    }
+}
+
+int GetSetProjectGrid_(ReaProject *, bool set, double *division, int *swingmode, double *swingamt)
+{
+    if (set && division)
+        current_project->grid_division = *division;
+    else if (division)
+        *division = current_project->grid_division;
+    if (swingmode && !set)
+        *swingmode = 0;
+    if (swingamt && !set)
+        *swingamt = 0;
+    return 0;
+}
+
+void SetProjectGrid_(ReaProject *, double division) { current_project->grid_division = division; }
+
+// the two commands append_duplicate_main relies on: copy selected items, paste at the edit cursor
+// onto the selected track keeping the copied items' relative track offsets
+void Main_OnCommand_(int command, int)
+{
+    Project &p = *current_project;
+    if (command == 40057) {
+        p.clipboard.clear();
+        for (auto &track : p.tracks)
+            for (auto &item : track->items)
+                if (item->selected)
+                    p.clipboard.push_back(item.get());
+    } else if (command == 42398 && !p.clipboard.empty()) {
+        auto track_index = [&](Track *track) {
+            for (size_t i = 0; i < p.tracks.size(); i++)
+                if (p.tracks[i].get() == track)
+                    return static_cast<int>(i);
+            return -1;
+        };
+
+        int dest = -1;
+        for (size_t i = 0; i < p.tracks.size() && dest < 0; i++)
+            if (p.tracks[i]->selected)
+                dest = static_cast<int>(i);
+        if (dest < 0)
+            return;
+
+        int min_track = INT_MAX;
+        double min_pos = HUGE_VAL, max_end = -HUGE_VAL;
+        for (Item *item : p.clipboard) {
+            min_track = std::min(min_track, track_index(item->track));
+            min_pos = std::min(min_pos, item->position);
+            max_end = std::max(max_end, item->position + item->length);
+        }
+
+        std::vector<std::pair<Track *, std::unique_ptr<Item>>> pasted;
+        for (Item *item : p.clipboard) {
+            int target = dest + track_index(item->track) - min_track;
+            if (target >= static_cast<int>(p.tracks.size()))
+                continue;
+            auto copy = std::make_unique<Item>();
+            copy->track = p.tracks[target].get();
+            copy->position = p.edit_cursor + item->position - min_pos;
+            copy->length = item->length;
+            copy->vol = item->vol;
+            copy->selected = true;
+            for (auto &take : item->takes) {
+                auto take_copy = std::make_unique<Take>();
+                take_copy->item = copy.get();
+                take_copy->name = take->name;
+                take_copy->vol = take->vol;
+                take_copy->notes = take->notes;
+                take_copy->sample_rate = take->sample_rate;
+                take_copy->channels = take->channels;
+                take_copy->amplitude = take->amplitude;
+                take_copy->file = take->file;
+                take_copy->ext = take->ext;
+                copy->takes.push_back(std::move(take_copy));
+            }
+            pasted.emplace_back(copy->track, std::move(copy));
+        }
+
+        for (auto &track : p.tracks)
+            for (auto &item : track->items)
+                item->selected = false;
+        for (auto &[track, item] : pasted)
+            track->items.push_back(std::move(item));
+        p.item_index_dirty = true;
+        p.edit_cursor += max_end - min_pos;
+    }
+}
+
+} // anonymous namespace
+
+Project &project()
+{
+    return *current_project;
+}
+
+void reset()
+{
+    // the state change count carries over, so caches keyed on it never mistake the new project for
+    // the old one
+    const int state_change_count = current_project ? current_project->state_change_count + 1 : 0;
+    const std::unique_ptr<Project> closed = std::move(current_project);
+    current_project = std::make_unique<Project>();
+    current_project->state_change_count = state_change_count;
+    track_list_changed(); // as for a closed project tab
+}
+
+int stale_track_reads()
+{
+    return stale_reads.load();
+}
+
+void run_audio(double seconds, int block_frames, double rate)
+{
+    std::thread audio_thread([=] {
+        const long long blocks = static_cast<long long>(seconds * rate / block_frames);
+        for (long long i = 0; i < blocks; i++) {
+            for (audio_hook_register_t *reg : audio_hooks)
+                reg->OnAudioBuffer(false, block_frames, rate, reg);
+            for (audio_hook_register_t *reg : audio_hooks)
+                reg->OnAudioBuffer(true, block_frames, rate, reg);
+        }
+    });
+    audio_thread.join();
+}
+
+void set_resource_path(const std::string &path)
+{
+    resource_path = path;
+}
+
+GUID make_guid()
+{
+    static uint64_t counter = 0;
+    GUID guid;
+    uint64_t parts[2] = {0x6574686c74ULL, ++counter};
+    static_assert(sizeof(parts) == sizeof(GUID), "GUID is expected to be 16 bytes");
+    memcpy(&guid, parts, sizeof(GUID));
+    return guid;
+}
+
+Track *add_track(const std::string &name)
+{
+    auto track = std::make_unique<Track>();
+    track->name = name;
+    track->guid = make_guid();
+    current_project->tracks.push_back(std::move(track));
+    return current_project->tracks.back().get();
+}
+
+Item *add_item(Track *track, double position, double length)
+{
+    auto item = std::make_unique<Item>();
+    item->track = track;
+    item->position = position;
+    item->length = length;
+    track->items.push_back(std::move(item));
+    current_project->item_index_dirty = true;
+    return track->items.back().get();
+}
+
+Take *add_take(Item *item)
+{
+    item->takes.push_back(std::make_unique<Take>());
+    item->takes.back()->item = item;
+    item->takes.back()->guid = make_guid();
+    return item->takes.back().get();
+}
+
+Envelope *add_envelope(Track *track, const std::string &type)
+{
+    track->envelopes.push_back(std::make_unique<Envelope>());
+    track->envelopes.back()->type = type;
+    track->envelopes.back()->guid = make_guid();
+    return track->envelopes.back().get();
+}
+
+Envelope *add_envelope(Take *take, const std::string &type)
+{
+    take->envelopes.push_back(std::make_unique<Envelope>());
+    take->envelopes.back()->type = type;
+    take->envelopes.back()->guid = make_guid();
+    return take->envelopes.back().get();
+}
+
+#define MOCK_BIND(fn) fn = &fn##_
+
+void install()
+{
+    if (!current_project)
+        reset();
+
+    MOCK_BIND(ShowConsoleMsg);
+    MOCK_BIND(plugin_register);
+    MOCK_BIND(PreventUIRefresh);
+    MOCK_BIND(UpdateArrange);
+    MOCK_BIND(UpdateTimeline);
+    MOCK_BIND(TrackList_AdjustWindows);
+    MOCK_BIND(Undo_OnStateChange);
+    MOCK_BIND(Undo_BeginBlock2);
+    MOCK_BIND(Undo_EndBlock2);
+    MOCK_BIND(GetProjectStateChangeCount);
+    MOCK_BIND(EnumProjects);
+    MOCK_BIND(ValidatePtr2);
+    MOCK_BIND(Audio_RegHardwareHook);
+    MOCK_BIND(Track_GetPeakInfo);
+    MOCK_BIND(GetResourcePath);
+    MOCK_BIND(GetProjectPath);
+    MOCK_BIND(GetProjExtState);
+    MOCK_BIND(SetProjExtState);
+    MOCK_BIND(GetExtState);
+    MOCK_BIND(SetExtState);
+    MOCK_BIND(GetUserInputs);
+    MOCK_BIND(ShowMessageBox);
+    MOCK_BIND(realloc_cmd_ptr);
+    MOCK_BIND(guidToString);
+    MOCK_BIND(genGuid);
+    MOCK_BIND(stringToGuid);
+
+    MOCK_BIND(CountTracks);
+    MOCK_BIND(GetTrack);
+    MOCK_BIND(DeleteTrack);
+    MOCK_BIND(InsertTrackInProject);
+    MOCK_BIND(IsTrackSelected);
+    MOCK_BIND(CountSelectedTracks);
+    MOCK_BIND(GetSelectedTrack);
+    MOCK_BIND(SetTrackSelected);
+    MOCK_BIND(SetOnlyTrackSelected);
+    MOCK_BIND(GetMediaTrackInfo_Value);
+    MOCK_BIND(SetMediaTrackInfo_Value);
+    MOCK_BIND(GetSetMediaTrackInfo_String);
+    MOCK_BIND(GetTrackName);
+    MOCK_BIND(GetTrackGUID);
+
+    MOCK_BIND(TrackFX_AddByName);
+    MOCK_BIND(TrackFX_GetCount);
+    MOCK_BIND(TrackFX_GetFXGUID);
+    MOCK_BIND(TrackFX_SetPreset);
+    MOCK_BIND(TrackFX_GetParam);
+    MOCK_BIND(GetFXEnvelope);
+
+    MOCK_BIND(GetTrackNumSends);
+    MOCK_BIND(GetTrackSendInfo_Value);
+    MOCK_BIND(SetTrackSendInfo_Value);
+    MOCK_BIND(GetSetTrackSendInfo);
+    MOCK_BIND(CreateTrackSend);
+    MOCK_BIND(RemoveTrackSend);
+
+    MOCK_BIND(CountMediaItems);
+    MOCK_BIND(GetMediaItem);
+    MOCK_BIND(CountTrackMediaItems);
+    MOCK_BIND(GetTrackMediaItem);
+    MOCK_BIND(IsMediaItemSelected);
+    MOCK_BIND(GetMediaItemInfo_Value);
+    MOCK_BIND(SetMediaItemInfo_Value);
+    MOCK_BIND(CountTakes);
+    MOCK_BIND(GetMediaItemTake);
+    MOCK_BIND(CountSelectedMediaItems);
+    MOCK_BIND(GetSelectedMediaItem);
+    MOCK_BIND(GetActiveTake);
+
+    MOCK_BIND(TakeIsMIDI);
+    MOCK_BIND(GetMediaItemTake_Source);
+    MOCK_BIND(GetMediaItemTakeInfo_Value);
+    MOCK_BIND(GetSetMediaItemTakeInfo_String);
+    MOCK_BIND(CreateNewMIDIItemInProj);
+    MOCK_BIND(AddMediaItemToTrack);
+    MOCK_BIND(GetItemStateChunk);
+    MOCK_BIND(SetItemStateChunk);
+    MOCK_BIND(SetMediaItemSelected);
+    MOCK_BIND(GetMediaItem_Track);
+    MOCK_BIND(DeleteTrackMediaItem);
+    MOCK_BIND(TakeFX_GetCount);
+    MOCK_BIND(GetMediaSourceFileName);
+    MOCK_BIND(GetMediaSourceSampleRate);
+    MOCK_BIND(GetMediaSourceNumChannels);
+    MOCK_BIND(CreateTakeAudioAccessor);
+    MOCK_BIND(CreateTrackAudioAccessor);
+    MOCK_BIND(DestroyAudioAccessor);
+    MOCK_BIND(GetAudioAccessorStartTime);
+    MOCK_BIND(GetAudioAccessorEndTime);
+    MOCK_BIND(GetAudioAccessorSamples);
+
+    MOCK_BIND(CountTrackEnvelopes);
+    MOCK_BIND(GetTrackEnvelope);
+    MOCK_BIND(CountTakeEnvelopes);
+    MOCK_BIND(GetTakeEnvelope);
+    MOCK_BIND(GetSelectedEnvelope);
+    MOCK_BIND(GetEnvelopeStateChunk);
+    MOCK_BIND(SetEnvelopeStateChunk);
+    MOCK_BIND(InsertAutomationItem);
+    MOCK_BIND(GetSetAutomationItemInfo);
+    MOCK_BIND(GetEnvelopeName);
+    MOCK_BIND(GetEnvelopeScalingMode);
+    MOCK_BIND(ScaleFromEnvelopeMode);
+    MOCK_BIND(ScaleToEnvelopeMode);
+    MOCK_BIND(CountAutomationItems);
+    MOCK_BIND(CountEnvelopePointsEx);
+    MOCK_BIND(GetEnvelopePointEx);
+    MOCK_BIND(SetEnvelopePointEx);
+    MOCK_BIND(InsertEnvelopePointEx);
+    MOCK_BIND(DeleteEnvelopePointEx);
+    MOCK_BIND(GetEnvelopePointByTimeEx);
+    MOCK_BIND(DeleteEnvelopePointRangeEx);
+    MOCK_BIND(Envelope_SortPoints);
+    MOCK_BIND(Envelope_SortPointsEx);
+
+    MOCK_BIND(MIDIEditor_GetActive);
+    MOCK_BIND(MIDIEditor_GetTake);
+    MOCK_BIND(MIDI_CountEvts);
+    MOCK_BIND(MIDI_GetNote);
+    MOCK_BIND(MIDI_SetNote);
+    MOCK_BIND(MIDI_InsertNote);
+    MOCK_BIND(MIDI_DeleteNote);
+    MOCK_BIND(MIDI_Sort);
+    MOCK_BIND(MIDI_SetAllEvts);
+    MOCK_BIND(MIDI_GetGrid);
+    MOCK_BIND(SetMIDIEditorGrid);
+    MOCK_BIND(MIDI_GetPPQPosFromProjTime);
+    MOCK_BIND(MIDI_GetProjTimeFromPPQPos);
+    MOCK_BIND(TimeMap2_timeToBeats);
+    MOCK_BIND(TimeMap2_beatsToTime);
+
+    MOCK_BIND(GetCursorContext2);
+    MOCK_BIND(GetMousePosition);
+    MOCK_BIND(GetItemFromPoint);
+    MOCK_BIND(GetThingFromPoint);
+    MOCK_BIND(GetCursorPosition);
+    MOCK_BIND(GetPlayState);
+    MOCK_BIND(GetPlayPosition2);
+    MOCK_BIND(GetTrackAutomationMode);
+    MOCK_BIND(GetGlobalAutomationOverride);
+    MOCK_BIND(SetEditCurPos);
+    MOCK_BIND(GetSet_LoopTimeRange2);
+    MOCK_BIND(GetSetProjectGrid);
+    MOCK_BIND(SetProjectGrid);
+    MOCK_BIND(Main_OnCommand);
+}
+
+#undef MOCK_BIND
+
+} // namespace mock
@@ -0,0 +1,178 @@
+#pragma once
+#include "config.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+#include <reaper_plugin_functions.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// In-memory stand-in for the part of the REAPER API the toolkit's actions call: tracks, items,
+// takes, envelopes with automation items, MIDI notes, sends, FX GUIDs, undo and selection.
+// install() binds the REAPERAPI function pointers to it, so the action sources can be linked into
+// a plain executable and run without REAPER or a display.
+namespace mock
+{
+
+struct EnvPoint
+{
+    double time, value;
+    int shape;
+    double tension;
+    bool selected;
+};
+
+struct AutomationItem
+{
+    int pool_id;
+    double position, length;
+    std::vector<EnvPoint> points;
+};
+
+struct Envelope
+{
+    std::string type; // state chunk tag, e.g. "VOLENV2" or "PARMENV 3 0 1 0.5"
+    int scaling_mode = 0;
+    GUID guid {}; // EGUID
+    std::vector<EnvPoint> points;
+    std::vector<AutomationItem> automation_items;
+};
+
+struct Note
+{
+    bool selected, muted;
+    double start_ppq, end_ppq;
+    int chan, pitch, vel;
+};
+
+struct Track;
+
+struct Item;
+
+struct Take
+{
+    Item *item = nullptr;
+    std::string name;
+    double vol = 1;
+    std::vector<Note> notes;
+
+    // an audio take when sample_rate is set: a sine of the given amplitude on every channel,
+    // readable through an audio accessor; otherwise a MIDI take
+    int sample_rate = 0, channels = 0;
+    double amplitude = 0;
+    std::string file; // source file name, takes sharing it must share the audio settings too
+    std::map<std::string, std::string> ext;
+    std::vector<std::unique_ptr<Envelope>> envelopes;
+    GUID guid;
+};
+
+struct Item
+{
+    Track *track = nullptr;
+    double position = 0, length = 1, vol = 1;
+    bool selected = false;
+    std::vector<std::unique_ptr<Take>> takes;
+};
+
+struct Send
+{
+    Track *dest;
+    std::map<std::string, double> params;
+};
+
+struct Fx
+{
+    std::string name;
+    GUID guid;
+    std::vector<std::unique_ptr<Envelope>> param_envelopes;
+};
+
+struct Track
+{
+    std::string name;
+    GUID guid;
+    double vol = 1;
+    bool selected = false;
+    int automation_mode = 0; // trim/read
+    std::vector<std::unique_ptr<Item>> items;
+    std::vector<std::unique_ptr<Envelope>> envelopes;
+    std::vector<Send> sends;
+    std::vector<Fx> fx;
+    std::map<std::string, std::string> ext;
+
+    // what a track audio accessor reads: a decaying 55 Hz kick every kick_interval seconds over a
+    // quiet 3 kHz tone, up to audio_length; silence when kick_interval is 0
+    double kick_interval = 0, audio_length = 0;
+
+    // what the track meter shows before the fader, linear; Track_GetPeakInfo applies vol
+    double meter_peak = 0;
+};
+
+struct Project
+{
+    std::vector<std::unique_ptr<Track>> tracks;
+    std::map<std::string, std::string> ext_state; // "section/key" -> value
+
+    // UI state the actions query
+    int cursor_context = 1;
+    double edit_cursor = 0;
+    double grid_division = 0.25, midi_grid_division = 0.25;
+    double time_selection_start = 0, time_selection_end = 0;
+    int play_state = 0; // stopped
+    double play_position = 0;
+    int automation_override = -1; // none
+    double bar_length = 2; // seconds, a constant 120 bpm in 4/4
+    int next_pool_id = 1;
+    Envelope *selected_envelope = nullptr;
+    Item *item_under_mouse = nullptr;
+    Track *track_under_mouse = nullptr;
+    Take *midi_editor_take = nullptr;
+
+    // side effects the benchmark reports
+    int undo_points = 0;
+    int undo_block_depth = 0;
+    int state_change_count = 0;
+    int ui_refreshes = 0;
+    int track_layout_updates = 0; // TrackList_AdjustWindows calls that were not minor
+    int console_messages = 0;
+
+    std::vector<Item *> clipboard;
+
+    // project-wide item order for GetMediaItem, rebuilt lazily after items are added
+    std::vector<Item *> item_index;
+    bool item_index_dirty = true;
+};
+
+Project &project();
+
+// drops the current project and starts an empty one
+void reset();
+
+// binds the REAPERAPI function pointers to the mock implementations
+void install();
+
+GUID make_guid();
+
+// what GetResourcePath returns, "." unless changed
+void set_resource_path(const std::string &path);
+
+// plays back for the given time from a separate thread, calling the registered audio hooks once
+// per block as REAPER's audio thread does, and waits for it to finish
+void run_audio(double seconds, int block_frames = 512, double rate = 48000);
+
+// Track_GetPeakInfo calls the audio hooks made for tracks no longer in the project
+int stale_track_reads();
+
+Track *add_track(const std::string &name = {});
+Item *add_item(Track *track, double position, double length);
+Take *add_take(Item *item);
+Envelope *add_envelope(Track *track, const std::string &type);
+Envelope *add_envelope(Take *take, const std::string &type);
+
+template<typename T>
+T *handle(const void *object)
+{
+    return reinterpret_cast<T *>(const_cast<void *>(object));
+}
+
+} // namespace mock
@@ -0,0 +1,482 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <stack>
+#include <vector>
+
+// Verbatim copies of the numeric kernels as they were before they moved to src/core/. bench_kernels
+// checks the core versions against these, so an optimised kernel has to stay bit-identical to the
+// behaviour users already rely on. Do not edit these.
+namespace reference
+{
+
+// clang-format off
+constexpr inline int ipow(int base, int exp) noexcept {
+    int result = 1;
+    while (exp > 0) {
+        if (exp & 1) result *= base;
+        base *= base;
+        exp >>= 1;
+    }
+    return result;
+}
+
+constexpr double db2factor(double db) noexcept {
+    double exp = db / 6;
+    int int_part = static_cast<int>(exp);
+    double frac_part = exp - int_part;
+    
+    // calculate 2^int_part using bit shifting
+    double result = 1;
+    if (int_part > 0)
+        result *= static_cast<double>(1 << int_part);
+    else if (int_part < 0)
+        result /= static_cast<double>(1 << -int_part);
+    
+    // for fractional part, use a simple approximation
+    if (frac_part != 0) {
+        double x = frac_part;
+        result *= 1.0 + 0.6931471805599453 * x 
+                      + 0.24022650695910072 * x*x
+                      + 0.05550410866482158 * x*x*x
+                      + 0.009618129107628477 * x*x*x*x
+                      + 0.0013333558146428443 * x*x*x*x*x;
+    }
+    
+    return result;
+}
+
+constexpr int MIN_VOL_DB = -48;
+constexpr double MIN_VOL_FACTOR = db2factor(MIN_VOL_DB);
+#define STEP_OFFSET (increase ? 1.4 : -0.4)
+
+constexpr inline int extract_index(const char* str, const size_t len) noexcept
+{
+    int n = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = str[len - i - 1];
+        if (isdigit(c))
+            n += (c - '0') * ipow(10, i);
+        else break;
+    }
+    return n;
+}
+
+// adjust_type: 0: normal
+//              1: volume
+//              2: mute {0, 1}
+constexpr inline bool extract_envelope_info(
+    const char *str,
+    const size_t len,
+    char *env_type,
+    double *min_val,
+    double *max_val,
+    double *mid_val,
+    int *adjust_type)
+{
+    if (len < 1 || str[0] != '<')
+        return false;
+
+    // find first space
+    const char *end = str;
+    while (*end && !isspace(*end)) end++;
+    if (!*end) return false;
+
+    // assign env_type
+    size_t env_type_len = end - str - 1;
+    strncpy(env_type, str + 1, env_type_len);
+    env_type[env_type_len] = '\0';
+
+    if (strcmp(env_type, "PARMENV") == 0) {
+        char param_name[32] = {};
+        int parsed = sscanf(end + 1, "%s %lf %lf %lf", param_name, min_val, max_val, mid_val);
+
+        if (parsed >= 1) {
+            sprintf(env_type, "PARMENV %s", param_name);
+
+            // try to find "DEFSHAPE" in str
+            double defshape = 0;
+            const char* defshape_ptr = strstr(end + 1, "DEFSHAPE");
+    
+            if (defshape_ptr &&
+                sscanf(defshape_ptr + 8, "%lf", &defshape) == 1 &&
+                defshape == 1
+            ) {
+                *adjust_type = 2; return true;
+            }
+        }
+
+        if (parsed < 4) return false;
+        
+        // for factorial volume parameters in build-in plugins
+        if ((*min_val == 0 && *max_val == 2 && *mid_val == 1) ||
+            (*min_val == 0 && *max_val == 1 && *mid_val == 0.25) ||
+            (*min_val == 0 && *max_val == 4 && *mid_val == 1))
+            *adjust_type = 1;
+        else
+            *adjust_type = 0;
+        
+        return true;
+    
+    } else if (strcmp(env_type, "VOLENV") == 0 ||
+               strcmp(env_type, "VOLENV2") == 0 ||
+               strcmp(env_type, "AUXVOLENV") == 0) {
+
+        *min_val = 0.0; *max_val = 2.0; *mid_val = 1.0; *adjust_type = 1; return true;
+
+    } else if (strcmp(env_type, "PANENV") == 0 ||
+               strcmp(env_type, "PANENV2") == 0 ||
+               strcmp(env_type, "AUXPANENV") == 0 ||
+               strcmp(env_type, "WIDTHENV") == 0 ||
+               strcmp(env_type, "WIDTHENV2") == 0) {
+
+        *min_val = -1.0; *max_val = 1.0; *mid_val = 0.0; *adjust_type = 0; return true;
+
+    } else if (strcmp(env_type, "MUTEENV") == 0 ||
+               strcmp(env_type, "AUXMUTEENV") == 0) {
+
+        *min_val = 0.0; *max_val = 1.0; *mid_val = 0.5; *adjust_type = 2; return true;
+
+    } else if (strcmp(env_type, "VOLENV3") == 0) {
+
+        *min_val = 0.0; *max_val = 1.0; *mid_val = 0.5; *adjust_type = 1; return true;
+    }
+
+    return false;
+}
+
+template<bool increase, bool is_fine>
+double adjust_volume(const double vol) noexcept
+{
+    if (vol <= 0)
+        return increase ? MIN_VOL_FACTOR : 0;
+
+    if (!increase && vol < MIN_VOL_FACTOR)
+        return 0;
+    
+    const double new_vol = exp2(
+        is_fine ? floor(log2(vol) * 12 + STEP_OFFSET) / 12 :
+                  floor(log2(vol) *  2 + STEP_OFFSET) /  2
+    );
+    
+    if (new_vol < MIN_VOL_FACTOR)
+        return increase ? MIN_VOL_FACTOR : 0;
+    
+    return new_vol;
+}
+
+template<bool increase, bool is_fine>
+double adjust_envpt_value(
+    const double val,
+    const double min_val,
+    const double max_val,
+    const double mid_val,
+    const int adjust_type = 0
+) noexcept
+{
+    static constexpr int STEP_NUM = is_fine ? 32 : 8;
+
+    // common case
+    if (adjust_type == 0 && min_val == 0 && max_val == 1 && mid_val == 0.5)
+        return std::clamp(
+            floor(STEP_NUM * val + STEP_OFFSET) / STEP_NUM,
+            0.0, 1.0
+        );
+    
+    if (adjust_type == 1 && min_val == 0)
+        return std::min(max_val / mid_val, adjust_volume<increase, is_fine>(val / mid_val)) * mid_val;
+    
+    if (adjust_type == 2)
+        return increase;
+    
+    // volume smoother
+    if (min_val == -60 && max_val == 12 && mid_val == 0)
+        return std::clamp(
+            is_fine ? floor(val * 2 + STEP_OFFSET) / 2 :
+                      floor(val / 3 + STEP_OFFSET) * 3,
+            -60.0, 12.0
+        );
+    
+    // normalize
+    double factor = val < min_val ? 0 :
+                    val < mid_val ? (val - min_val) / (mid_val - min_val) / 2 :
+                    val < max_val ? (val - mid_val) / (max_val - mid_val) / 2 + 0.5 : 1;
+    
+    factor = floor(STEP_NUM * factor + STEP_OFFSET) / STEP_NUM;
+    factor = std::clamp(factor, 0.0, 1.0);
+
+    // scale back
+    return factor < 0.5 ? min_val + (mid_val - min_val) * factor * 2 :
+                          mid_val + (max_val - mid_val) * (factor - 0.5) * 2;
+}
+
+template<bool increase, bool is_fine>
+inline int adjust_velocity(int vel) noexcept
+{
+    if (is_fine)
+        return increase ? std::min(0x7F, (((vel + 1) >> 2) + 1) << 2)
+                        : std::max(1, (((vel + 3) >> 2) - 1) << 2);
+    else
+        return increase ? std::min(0x7F, (((vel + 7) >> 4) + 1) << 4)
+                        : std::max(1, (((vel + 9) >> 4) - 1) << 4);
+}
+
+union reinterpretable_double
+{
+    double d;
+    uint64_t i;
+
+    struct
+    {
+        uint64_t value : 63;
+        uint64_t sign : 1;
+    } bitfield;
+
+    constexpr reinterpretable_double(double value) noexcept : d(value) { }
+
+    // constexpr reinterpretable_double(uint64_t value) noexcept : i(value) { }
+};
+
+constexpr int IGNORE_LAST_N_BITS = 34;
+
+constexpr inline bool almost_equal(reinterpretable_double a, reinterpretable_double b) noexcept
+{
+    if (a.d == b.d)
+        return true;
+
+    if (std::isfinite(a.d) && std::isfinite(b.d)) {
+        const uint64_t diff = (a.bitfield.sign == b.bitfield.sign)
+                                  ? (a.bitfield.value > b.bitfield.value)
+                                        ? (a.bitfield.value - b.bitfield.value)
+                                        : (b.bitfield.value - a.bitfield.value)
+                                  : (a.bitfield.value + b.bitfield.value);
+
+        return !(diff >> IGNORE_LAST_N_BITS);
+    }
+
+    return false;
+}
+
+static constexpr double switch_gridsize(const double gridsize) noexcept
+{
+    unsigned int denominator = (unsigned int)(1 / gridsize + 0.5);
+
+    if (denominator % 3) // not dividable by 3
+        if (denominator % 2)
+            return gridsize;
+        else
+            return 1. / (denominator / 2 * 3);
+    else
+        return 1. / (denominator / 3 * 2);
+}
+
+// handle_envelope from the Clean Envelope Points action, with the few envelope API calls it makes
+// answered from plain point lists: lists[0] is the underlying envelope, lists[i + 1] automation item i
+struct EnvPoint
+{
+    double time, value;
+    int shape;
+};
+
+struct TrackEnvelope
+{
+    std::vector<std::vector<EnvPoint>> lists;
+};
+
+inline int CountAutomationItems(TrackEnvelope *env) { return static_cast<int>(env->lists.size()) - 1; }
+inline int CountEnvelopePointsEx(TrackEnvelope *env, int i) { return static_cast<int>(env->lists[i + 1].size()); }
+
+inline bool GetEnvelopePointEx(TrackEnvelope *env, int i, int j, double *time, double *value, int *shape, double *,
+                               bool *)
+{
+    const EnvPoint &point = env->lists[i + 1][j];
+    *time = point.time;
+    *value = point.value;
+    *shape = point.shape;
+    return true;
+}
+
+inline bool DeleteEnvelopePointEx(TrackEnvelope *env, int i, int j)
+{
+    env->lists[i + 1].erase(env->lists[i + 1].begin() + j);
+    return true;
+}
+
+inline void Envelope_SortPoints(TrackEnvelope *) { }
+
+// GCC cannot see that the std::optional points are only read once set
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+static int handle_envelope(TrackEnvelope *env)
+{
+    int point_count, del_point_count = 0;
+    std::stack<int> del_point_indices;
+    std::optional<EnvPoint> last_point, second_last_point;
+
+    int autoitem_count = CountAutomationItems(env);
+    for (int i = -1; i < autoitem_count; i++) { // -1 is for underlying envelope
+
+        // delete consecutive points with the same time
+        point_count = CountEnvelopePointsEx(env, i);
+        for (int j = 0; j < point_count; j++) {
+            EnvPoint point;
+            if (!GetEnvelopePointEx(env, i, j, &point.time, &point.value, &point.shape, nullptr,
+                                    nullptr))
+                continue;
+
+            // ShowConsoleMsg((std::to_string(j) + ":\n" +
+            //     "    second_last_point: " + (second_last_point.has_value() ? floatToString(second_last_point->time) : "NaN") + "\n"
+            //     "    last_point:        " + (last_point.has_value() ? floatToString(last_point->time) : "NaN") + "\n" +
+            //     "    point:             " + floatToString(point.time) + "\n" +
+            //     (last_point.has_value() && second_last_point.has_value() ? (
+            //         std::string("    last_time == time: ") + (almost_equal(last_point->time, point.time) ? "true" : "false") + "\n" +
+            //         "    second_time == time: " + (almost_equal(second_last_point->time, last_point->time) ? "true" : "false") + "\n" ) : ""
+            //     ) + "\n"
+            // ).c_str());
+
+            if (last_point.has_value() && second_last_point.has_value() &&
+                almost_equal(last_point->time, point.time) &&
+                almost_equal(second_last_point->time, last_point->time))
+                del_point_indices.push(j - 1);
+
+            second_last_point = last_point;
+            last_point = point;
+        }
+
+        del_point_count += static_cast<int>(del_point_indices.size());
+
+        while (!del_point_indices.empty()) {
+            DeleteEnvelopePointEx(env, i, del_point_indices.top());
+            del_point_indices.pop();
+        }
+
+        last_point = std::nullopt;
+        second_last_point = std::nullopt;
+
+        // delete overlapping points
+        point_count = CountEnvelopePointsEx(env, i);
+        for (int j = 0; j < point_count; j++) {
+            EnvPoint point;
+            if (!GetEnvelopePointEx(env, i, j, &point.time, &point.value, &point.shape, nullptr,
+                                    nullptr))
+                continue;
+
+            if (last_point.has_value() && almost_equal(last_point->time, point.time) &&
+                last_point->value == point.value)
+                del_point_indices.push(j - 1);
+
+            last_point = point;
+        }
+
+        del_point_count += static_cast<int>(del_point_indices.size());
+
+        while (!del_point_indices.empty()) {
+            DeleteEnvelopePointEx(env, i, del_point_indices.top());
+            del_point_indices.pop();
+        }
+
+        last_point = std::nullopt;
+        second_last_point = std::nullopt;
+
+        // delete consecutive points with the same value
+        point_count = CountEnvelopePointsEx(env, i);
+        for (int j = 0; j < point_count; j++) {
+            EnvPoint point;
+            if (!GetEnvelopePointEx(env, i, j, &point.time, &point.value, &point.shape, nullptr,
+                                    nullptr))
+                continue;
+
+            if (last_point.has_value() && second_last_point.has_value() &&
+                last_point->value == point.value && second_last_point->value == last_point->value)
+                del_point_indices.push(j - 1);
+
+            second_last_point = last_point;
+            last_point = point;
+        }
+
+        del_point_count += static_cast<int>(del_point_indices.size());
+
+        while (!del_point_indices.empty()) {
+            DeleteEnvelopePointEx(env, i, del_point_indices.top());
+            del_point_indices.pop();
+        }
+
+        last_point = std::nullopt;
+        second_last_point = std::nullopt;
+
+        // delete unnecessary square points
+        point_count = CountEnvelopePointsEx(env, i);
+        for (int j = 0; j < point_count; j++) {
+            EnvPoint point;
+            if (!GetEnvelopePointEx(env, i, j, &point.time, &point.value, &point.shape, nullptr,
+                                    nullptr))
+                continue;
+
+            if (last_point.has_value() && last_point->shape == 1 && point.shape == 1 &&
+                last_point->value == point.value)
+                del_point_indices.push(j);
+
+            last_point = point;
+        }
+
+        del_point_count += static_cast<int>(del_point_indices.size());
+
+        while (!del_point_indices.empty()) {
+            DeleteEnvelopePointEx(env, i, del_point_indices.top());
+            del_point_indices.pop();
+        }
+
+        last_point = std::nullopt;
+        second_last_point = std::nullopt;
+
+        // check if the tail point is necessary
+        point_count = CountEnvelopePointsEx(env, i);
+        if (point_count >= 2) {
+            EnvPoint point, tail_point;
+            if (GetEnvelopePointEx(env, i, point_count - 2, &point.time, &point.value, &point.shape,
+                                   nullptr, nullptr) &&
+                GetEnvelopePointEx(env, i, point_count - 1, &tail_point.time, &tail_point.value,
+                                   &tail_point.shape, nullptr, nullptr) &&
+                point.value == tail_point.value)
+            {
+                DeleteEnvelopePointEx(env, i, point_count - 1);
+                del_point_count++;
+            }
+        }
+
+        // check if the head point is necessary
+        point_count = CountEnvelopePointsEx(env, i);
+        if (point_count >= 2) {
+            EnvPoint head_point, point;
+            if (GetEnvelopePointEx(env, i, 0, &head_point.time, &head_point.value, &head_point.shape,
+                                   nullptr, nullptr) &&
+                GetEnvelopePointEx(env, i, 1, &point.time, &point.value, &point.shape, nullptr,
+                                   nullptr) &&
+                head_point.value == point.value)
+            {
+                DeleteEnvelopePointEx(env, i, 0);
+                del_point_count++;
+            }
+        }
+    }
+
+    if (del_point_count)
+        Envelope_SortPoints(env);
+
+    return del_point_count;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+// clang-format on
+
+} // namespace reference
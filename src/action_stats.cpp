@@ -0,0 +1,100 @@
+#include "action_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+std::vector<ActionStats> action_stats;
+int current_action_index {-1};
+
+inline int latency_bucket(double us) noexcept
+{
+    if (us < 2)
+        return 0;
+    int exp;
+    std::frexp(us, &exp); // us = m * 2^exp, 0.5 <= m < 1
+    return std::min(exp - 1, LATENCY_BUCKET_COUNT - 1);
+}
+
+} // anonymous namespace
+
+void init_action_stats(int action_count)
+{
+    action_stats.assign(action_count, ActionStats {});
+}
+
+void reset_action_stats()
+{
+    std::fill(action_stats.begin(), action_stats.end(), ActionStats {});
+}
+
+const ActionStats *get_action_stats(int action_index)
+{
+    if (action_index < 0 || action_index >= static_cast<int>(action_stats.size()))
+        return nullptr;
+    return &action_stats[action_index];
+}
+
+double latency_quantile_us(const ActionStats &stats, double quantile)
+{
+    if (!stats.count)
+        return 0;
+
+    const double target = quantile * stats.count;
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKET_COUNT - 1; i++) {
+        seen += stats.buckets[i];
+        if (seen >= target)
+            return std::min(std::ldexp(1.0, i + 1), stats.max_us);
+    }
+    return stats.max_us;
+}
+
+int running_action_index() noexcept
+{
+    return current_action_index;
+}
+
+void record_objects_touched(int count) noexcept
+{
+    if (current_action_index >= 0 && count > 0)
+        action_stats[current_action_index].objects_touched += count;
+}
+
+void record_arena_high_water(size_t bytes) noexcept
+{
+    if (current_action_index >= 0) {
+        uint64_t &high_water = action_stats[current_action_index].arena_high_water;
+        high_water = std::max<uint64_t>(high_water, bytes);
+    }
+}
+
+ScopedActionTimer::ScopedActionTimer(int action_index) noexcept
+    : action_index_(action_index), outer_action_index_(current_action_index),
+      start_(std::chrono::steady_clock::now())
+{
+    if (action_index_ >= static_cast<int>(action_stats.size()))
+        action_index_ = -1;
+    current_action_index = action_index_;
+}
+
+ScopedActionTimer::~ScopedActionTimer()
+{
+    current_action_index = outer_action_index_;
+    if (action_index_ < 0)
+        return;
+
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_).count();
+    ActionStats &stats = action_stats[action_index_];
+    stats.count++;
+    stats.total_us += us;
+    stats.max_us = std::max(stats.max_us, us);
+    stats.buckets[latency_bucket(us)]++;
+}
+
+} // namespace PROJECT_NAME
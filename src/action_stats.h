@@ -0,0 +1,57 @@
+#pragma once
+#include "config.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace PROJECT_NAME
+{
+
+// bucket i holds durations in [2^i, 2^(i+1)) microseconds; the first bucket also takes anything
+// shorter and the last one is open-ended
+constexpr int LATENCY_BUCKET_COUNT = 24;
+
+struct ActionStats
+{
+    uint64_t count;
+    uint64_t objects_touched;
+    uint64_t arena_high_water; // most bytes of the action arena one invocation used
+    double total_us, max_us;
+    uint64_t buckets[LATENCY_BUCKET_COUNT];
+};
+
+// sizes the per-action tables once, before any action runs
+void init_action_stats(int action_count);
+void reset_action_stats();
+
+const ActionStats *get_action_stats(int action_index);
+
+// upper edge of the bucket containing the given quantile (0-1), in microseconds
+double latency_quantile_us(const ActionStats &stats, double quantile);
+
+// index of the action currently being timed, -1 outside of one
+int running_action_index() noexcept;
+
+// lets an action report how many tracks, items, points or notes it touched;
+// attributed to the action currently being timed, ignored outside of one
+void record_objects_touched(int count) noexcept;
+
+// the same for the bytes an invocation took from the action arena, keeping the largest
+void record_arena_high_water(size_t bytes) noexcept;
+
+// times one action invocation into its histogram, no allocation involved
+class ScopedActionTimer
+{
+public:
+    explicit ScopedActionTimer(int action_index) noexcept;
+    ~ScopedActionTimer();
+
+    ScopedActionTimer(const ScopedActionTimer &) = delete;
+    ScopedActionTimer &operator=(const ScopedActionTimer &) = delete;
+
+private:
+    int action_index_, outer_action_index_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace PROJECT_NAME
@@ -1,7 +1,15 @@
 #include "append_duplicate.h"
-#include <climits>
+#include "../action_stats.h"
+#include "../arena.h"
+#include "../log.h"
+#include "../refresh.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -11,14 +19,44 @@ namespace PROJECT_NAME
 namespace
 {
 
+constexpr const char *EXTSTATE_SECTION = "ethlt_reaper_toolkit";
+constexpr const char *EXTSTATE_APPEND_TIMES = "append_duplicate_times";
+constexpr int MAX_APPEND_TIMES = 1024;
+
+// how many copies to append: a fixed number, or as many as fit before the time selection end
+struct CopyCount
+{
+    int times;
+    bool until_time_selection;
+};
+
 struct MIDINote
 {
     bool selected, muted;
     double start_ppq, end_ppq;
     int channel, pitch, velocity;
+    int index;
 };
 
-static int handle_midi_editor()
+// copies of [start, end) laid back to back that end before limit, with some tolerance for
+// positions that went through a PPQ or beat conversion
+static int copies_until(double start, double end, double limit)
+{
+    const double interval = end - start;
+    if (!(interval > 0) || limit < end)
+        return 0;
+    return std::min(MAX_APPEND_TIMES, static_cast<int>(std::floor((limit - end) / interval + 1e-9)));
+}
+
+// end of the time selection, or nothing if there is none
+static bool time_selection_end(double *end)
+{
+    double start;
+    GetSet_LoopTimeRange2(nullptr, false, false, &start, end, false);
+    return *end > start;
+}
+
+static int handle_midi_editor(CopyCount count)
 {
     HWND midi_editor = MIDIEditor_GetActive();
     if (!midi_editor)
@@ -28,8 +66,16 @@ static int handle_midi_editor()
     if (!take)
         return 0;
 
+    double limit_ppq = 0;
+    if (count.until_time_selection) {
+        double limit;
+        if (!time_selection_end(&limit))
+            return 0;
+        limit_ppq = MIDI_GetPPQPosFromProjTime(take, limit);
+    }
+
     int note_count;
-    std::vector<MIDINote> selected_notes;
+    auto selected_notes = make_action_vector<MIDINote>();
     double start_ppq = HUGE_VAL, end_ppq = -HUGE_VAL;
     MIDI_CountEvts(take, &note_count, nullptr, nullptr);
     static constexpr bool SELECTED_FALSE = false;
@@ -45,36 +91,50 @@ static int handle_midi_editor()
         if (!note.selected)
             continue;
 
+        note.index = i;
         selected_notes.push_back(note);
         start_ppq = std::min(start_ppq, note.start_ppq);
         end_ppq = std::max(end_ppq, note.end_ppq);
-
-        // deselect note
-        MIDI_SetNote(take, i, &SELECTED_FALSE, &note.muted, &note.start_ppq, &note.end_ppq,
-                     &note.channel, &note.pitch, &note.velocity, &NOSORT_TRUE);
     }
 
     if (selected_notes.empty())
         return 0;
 
-    double interval = end_ppq - start_ppq;
+    const int copies = count.until_time_selection ? copies_until(start_ppq, end_ppq, limit_ppq) : count.times;
+    if (copies <= 0)
+        return 0;
 
+    // deselect the originals, only the last copy stays selected as after appending one at a time
     for (const MIDINote &note : selected_notes) {
-        MIDI_InsertNote(take, note.selected, note.muted, note.start_ppq + interval,
-                        note.end_ppq + interval, note.channel, note.pitch, note.velocity, &NOSORT_TRUE);
+        MIDI_SetNote(take, note.index, &SELECTED_FALSE, &note.muted, &note.start_ppq, &note.end_ppq,
+                     &note.channel, &note.pitch, &note.velocity, &NOSORT_TRUE);
+    }
+
+    double interval = end_ppq - start_ppq;
+
+    for (int k = 1; k <= copies; k++) {
+        const double offset = interval * k;
+        for (const MIDINote &note : selected_notes) {
+            MIDI_InsertNote(take, k == copies, note.muted, note.start_ppq + offset, note.end_ppq + offset,
+                            note.channel, note.pitch, note.velocity, &NOSORT_TRUE);
+        }
     }
 
     MIDI_Sort(take);
 
-    return static_cast<int>(selected_notes.size());
+    return static_cast<int>(selected_notes.size()) * copies;
 }
 
-static int handle_arrange_view()
+// extent of the selected items in the arrange view
+struct ItemSelection
+{
+    double start_pos, end_pos;
+    int item_count;
+};
+
+static ItemSelection find_selected_items(ArenaVector<MediaItem *> &items)
 {
-    double end_pos = -HUGE_VAL;
-    int min_track_id = INT_MAX;
-    int selected_item_count = 0;
-    double cur_pos = GetCursorPosition();
+    ItemSelection selection {HUGE_VAL, -HUGE_VAL, 0};
 
     int track_count = CountTracks(nullptr);
     for (int i = 0; i < track_count; i++) {
@@ -91,62 +151,186 @@ static int handle_arrange_view()
             if (IsMediaItemSelected(item)) {
                 double pos = GetMediaItemInfo_Value(item, "D_POSITION");
                 double len = GetMediaItemInfo_Value(item, "D_LENGTH");
-                end_pos = std::max(end_pos, pos + len);
-                min_track_id = std::min(min_track_id, i);
-                selected_item_count++;
+                selection.start_pos = std::min(selection.start_pos, pos);
+                selection.end_pos = std::max(selection.end_pos, pos + len);
+                selection.item_count++;
+                items.push_back(item);
             }
         }
     }
 
-    if (selected_item_count == 0)
-        return 0;
+    return selection;
+}
 
-    // deselect all tracks
-    std::vector<MediaTrack *> selected_tracks;
-    for (int i = 0; i < track_count; i++) {
-        MediaTrack *track = GetTrack(nullptr, i);
-        if (IsTrackSelected(track))
-            selected_tracks.push_back(track);
-        SetTrackSelected(track, false);
+static bool get_item_chunk(MediaItem *item, std::vector<char> &buf)
+{
+    for (;;) {
+        if (!GetItemStateChunk(item, buf.data(), static_cast<int>(buf.size()), false))
+            return false;
+        if (strlen(buf.data()) + 1 < buf.size())
+            return true;
+        buf.resize(buf.size() * 4); // possibly cut off, try again with room to spare
+    }
+}
+
+// gives the item, its takes, their envelopes, their FX and their MIDI pools new GUIDs, as pasting
+// does, so a copy shares no identity with the item it came from
+static void renew_guids(std::string &chunk)
+{
+    char guid_str[64];
+    for (size_t pos = 0; pos < chunk.size();) {
+        size_t eol = chunk.find('\n', pos);
+        if (eol == std::string::npos)
+            eol = chunk.size();
+
+        size_t begin = chunk.find_first_not_of(" \t", pos);
+        const size_t space = chunk.find(' ', begin);
+        if (begin < eol && space < eol) {
+            const std::string_view key(chunk.data() + begin, space - begin);
+            const size_t open = chunk.find('{', space);
+            if ((key == "IGUID" || key == "GUID" || key == "EGUID" || key == "FXID" || key == "POOLEDEVTS") &&
+                open < eol) {
+                const size_t close = chunk.find('}', open);
+                if (close < eol) {
+                    GUID guid;
+                    genGuid(&guid);
+                    guidToString(&guid, guid_str);
+                    chunk.replace(open, close + 1 - open, guid_str);
+                    eol = chunk.find('\n', open);
+                    if (eol == std::string::npos)
+                        eol = chunk.size();
+                }
+            }
+        }
+        pos = eol + 1;
     }
+}
 
-    Main_OnCommand(40057, 0); // Item: Copy items/tracks
-    SetEditCurPos(end_pos, false, false);
-    MediaTrack *track = GetTrack(nullptr, min_track_id);
-    SetOnlyTrackSelected(track);
-    Main_OnCommand(42398, 0); // Item: Paste items/tracks
-    SetTrackSelected(track, false);
+// creates the copies straight from each item's state chunk, read once, instead of going through
+// the clipboard with one paste per copy; the last copy ends up selected as after appending one at
+// a time
+static void add_copies(const ItemSelection &selection, const ArenaVector<MediaItem *> &items, int copies)
+{
+    const double interval = selection.end_pos - selection.start_pos;
+    std::vector<char> buf(1 << 16);
+    std::string chunk;
 
-    // reposition cursor and reselect all tracks
-    SetEditCurPos(cur_pos, false, false);
-    for (MediaTrack *track : selected_tracks)
-        SetTrackSelected(track, true);
+    for (MediaItem *item : items) {
+        MediaTrack *track = GetMediaItem_Track(item);
+        const double position = GetMediaItemInfo_Value(item, "D_POSITION");
+        if (!track || !get_item_chunk(item, buf))
+            continue;
 
-    return selected_item_count;
+        SetMediaItemSelected(item, false);
+        for (int k = 1; k <= copies; k++) {
+            MediaItem *copy = AddMediaItemToTrack(track);
+            if (!copy)
+                break;
+            chunk.assign(buf.data());
+            renew_guids(chunk);
+            SetItemStateChunk(copy, chunk.c_str(), false);
+            SetMediaItemInfo_Value(copy, "D_POSITION", position + interval * k);
+            SetMediaItemSelected(copy, k == copies);
+        }
+    }
 }
 
-} // anonymous namespace
+// asks for the number of copies, remembering the last answer; 0 if cancelled
+static int prompt_append_times()
+{
+    char buf[32];
+    const char *last = GetExtState(EXTSTATE_SECTION, EXTSTATE_APPEND_TIMES);
+    snprintf(buf, sizeof(buf), "%s", last && *last ? last : "4");
+    if (!GetUserInputs("Append Duplicate", 1, "Number of copies:", buf, sizeof(buf)))
+        return 0;
 
-void append_duplicate_midi_editor()
+    const int times = atoi(buf);
+    if (times < 1 || times > MAX_APPEND_TIMES) {
+        ShowMessageBox(("Enter a number of copies from 1 to " + std::to_string(MAX_APPEND_TIMES) + ".").c_str(),
+                       "Append Duplicate", 0);
+        return 0;
+    }
+    SetExtState(EXTSTATE_SECTION, EXTSTATE_APPEND_TIMES, std::to_string(times).c_str(), true);
+    return times;
+}
+
+static void append_duplicate_midi_editor(CopyCount count)
 {
     PreventUIRefresh(1);
-    if (int n = handle_midi_editor())
-        Undo_OnStateChange(
-            ("Append Duplicate " + std::to_string(n) + " MIDI " + (n == 1 ? "Note" : "Notes")).c_str());
+    if (int n = handle_midi_editor(count)) {
+        record_objects_touched(n);
+        char desc[64];
+        snprintf(desc, sizeof(desc), "Append Duplicate %d MIDI %s", n, n == 1 ? "Note" : "Notes");
+        Undo_OnStateChange(desc);
+        request_refresh(REFRESH_ARRANGE);
+    }
     PreventUIRefresh(-1);
-    UpdateArrange();
 }
 
-void append_duplicate_main()
+// the item edits of all copies fold into one undo point through the block
+static void append_duplicate_main(CopyCount count)
 {
+    double limit = 0;
+    if (count.until_time_selection && !time_selection_end(&limit))
+        return;
+
+    auto items = make_action_vector<MediaItem *>();
+    const ItemSelection selection = find_selected_items(items);
+    if (!selection.item_count)
+        return;
+
+    const int copies = count.until_time_selection
+                           ? copies_until(selection.start_pos, selection.end_pos, limit)
+                           : count.times;
+    if (copies <= 0)
+        return;
+
     PreventUIRefresh(1);
-    if (int n = handle_arrange_view()) {
-        Undo_OnStateChange(
-            ("Append Duplicate " + std::to_string(n) + (n == 1 ? " Item" : " Items")).c_str());
-        ShowConsoleMsg(("Append Duplicate " + std::to_string(n) + (n == 1 ? "Item" : "Items")).c_str());
-    }
+    Undo_BeginBlock2(nullptr);
+    add_copies(selection, items, copies);
+
+    const int n = selection.item_count * copies;
+    record_objects_touched(n);
+    ETHLT_LOG(Debug, "Append Duplicate %d %s", n, n == 1 ? "Item" : "Items");
+    char desc[64];
+    snprintf(desc, sizeof(desc), "Append Duplicate %d %s", n, n == 1 ? "Item" : "Items");
+    Undo_EndBlock2(nullptr, desc, UNDO_STATE_ITEMS);
     PreventUIRefresh(-1);
-    UpdateArrange();
+    request_refresh(REFRESH_ARRANGE);
+}
+
+} // anonymous namespace
+
+void append_duplicate_midi_editor()
+{
+    append_duplicate_midi_editor({1, false});
+}
+
+void append_duplicate_main()
+{
+    append_duplicate_main({1, false});
+}
+
+void append_duplicate_times_midi_editor()
+{
+    if (int times = prompt_append_times())
+        append_duplicate_midi_editor({times, false});
+}
+
+void append_duplicate_times_main()
+{
+    if (int times = prompt_append_times())
+        append_duplicate_main({times, false});
+}
+
+void append_duplicate_to_time_selection_midi_editor()
+{
+    append_duplicate_midi_editor({0, true});
+}
+
+void append_duplicate_to_time_selection_main()
+{
+    append_duplicate_main({0, true});
 }
 
 } // namespace PROJECT_NAME
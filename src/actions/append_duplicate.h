@@ -9,4 +9,11 @@ namespace PROJECT_NAME
 void append_duplicate_midi_editor();
 void append_duplicate_main();
 
+// append several copies at once, as one undo point: a number asked for, or as many as fit before
+// the end of the time selection
+void append_duplicate_times_midi_editor();
+void append_duplicate_times_main();
+void append_duplicate_to_time_selection_midi_editor();
+void append_duplicate_to_time_selection_main();
+
 } // namespace PROJECT_NAME
@@ -0,0 +1,379 @@
+#include "automation_file.h"
+#include "../action_stats.h"
+#include "../arena.h"
+#include "../envelope_index.h"
+#include "../log.h"
+#include "../mapped_file.h"
+#include "../refresh.h"
+#include "../trace.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+constexpr const char *EXTSTATE_SECTION = "ethlt_reaper_toolkit";
+constexpr const char *EXTSTATE_PATH = "automation_file_path";
+
+constexpr char FILE_MAGIC[8] = {'E', 'T', 'H', 'L', 'T', 'A', 'U', '1'};
+constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;
+constexpr uint64_t BYTES_PER_POINT = 3 * sizeof(double) + sizeof(int32_t) + sizeof(uint8_t);
+
+constexpr uint32_t OWNER_TRACK = 0;
+constexpr uint32_t OWNER_TAKE = 1;
+
+// on-disk layout, see automation_file.h
+struct FileHeader
+{
+    char magic[8];
+    uint32_t envelope_size;
+    uint32_t reserved;
+    uint64_t envelope_count;
+};
+
+struct EnvelopeHeader
+{
+    char owner_guid[40];
+    char name[64];
+    uint32_t owner;
+    int32_t index;
+    uint64_t point_count;
+    uint64_t offset;
+};
+
+static_assert(sizeof(FileHeader) == 24 && sizeof(EnvelopeHeader) == 128,
+              "automation file layout must not have padding");
+
+// one envelope's points, column by column, refilled for each envelope of an export
+struct Columns
+{
+    ArenaVector<double> times = make_action_vector<double>();
+    ArenaVector<double> values = make_action_vector<double>();
+    ArenaVector<double> tensions = make_action_vector<double>();
+    ArenaVector<int32_t> shapes = make_action_vector<int32_t>();
+    ArenaVector<uint8_t> selected = make_action_vector<uint8_t>();
+};
+
+inline uint64_t padded(uint64_t size) noexcept
+{
+    return (size + 7) & ~uint64_t {7};
+}
+
+template<typename T>
+T load(const char *column, uint64_t i)
+{
+    T value;
+    memcpy(&value, column + i * sizeof(T), sizeof(T));
+    return value;
+}
+
+// asks for the file, offering the last one; false if cancelled
+bool prompt_path(const char *title, char *path, int path_size)
+{
+    const char *last = GetExtState(EXTSTATE_SECTION, EXTSTATE_PATH);
+    if (last && *last) {
+        snprintf(path, path_size, "%s", last);
+    } else {
+        char project_path[2048];
+        GetProjectPath(project_path, sizeof(project_path));
+        snprintf(path, path_size, "%s/automation.ethltau", project_path);
+    }
+
+    if (!GetUserInputs(title, 1, "File:,extrawidth=300", path, path_size) || !*path)
+        return false;
+    SetExtState(EXTSTATE_SECTION, EXTSTATE_PATH, path, true);
+    return true;
+}
+
+TrackEnvelope *owner_envelope(MediaTrack *track, MediaItem_Take *take, int i)
+{
+    return take ? GetTakeEnvelope(take, i) : GetTrackEnvelope(track, i);
+}
+
+int owner_envelope_count(MediaTrack *track, MediaItem_Take *take)
+{
+    return take ? CountTakeEnvelopes(take) : CountTrackEnvelopes(track);
+}
+
+// the envelope's index among its owner's, tried at the hint first since the inventory lists them
+// in that order
+int envelope_index(const EnvelopeRecord &record, int hint)
+{
+    if (owner_envelope(record.track, record.take, hint) == record.envelope)
+        return hint;
+    const int count = owner_envelope_count(record.track, record.take);
+    for (int i = 0; i < count; i++) {
+        if (owner_envelope(record.track, record.take, i) == record.envelope)
+            return i;
+    }
+    return -1;
+}
+
+EnvelopeHeader make_header(const EnvelopeRecord &record, int index_hint)
+{
+    EnvelopeHeader header {};
+    char guid[64] = "";
+    if (record.take)
+        GetSetMediaItemTakeInfo_String(record.take, "GUID", guid, false);
+    else
+        guidToString(GetTrackGUID(record.track), guid);
+    snprintf(header.owner_guid, sizeof(header.owner_guid), "%s", guid);
+    GetEnvelopeName(record.envelope, header.name, sizeof(header.name));
+    header.owner = record.take ? OWNER_TAKE : OWNER_TRACK;
+    header.index = envelope_index(record, index_hint);
+    header.point_count = static_cast<uint64_t>(CountEnvelopePointsEx(record.envelope, -1));
+    return header;
+}
+
+bool write_columns(FILE *out, TrackEnvelope *env, uint64_t point_count, Columns &columns)
+{
+    const size_t n = static_cast<size_t>(point_count);
+    columns.times.assign(n, 0);
+    columns.values.assign(n, 0);
+    columns.tensions.assign(n, 0);
+    columns.shapes.assign(n, 0);
+    columns.selected.assign(n, 0);
+    for (size_t i = 0; i < n; i++) {
+        int shape = 0;
+        bool selected = false;
+        GetEnvelopePointEx(env, -1, static_cast<int>(i), &columns.times[i], &columns.values[i], &shape,
+                           &columns.tensions[i], &selected);
+        columns.shapes[i] = shape;
+        columns.selected[i] = selected;
+    }
+
+    static constexpr char zeros[8] = {};
+    const uint64_t size = point_count * BYTES_PER_POINT;
+    const size_t padding = static_cast<size_t>(padded(size) - size);
+    return fwrite(columns.times.data(), sizeof(double), n, out) == n &&
+           fwrite(columns.values.data(), sizeof(double), n, out) == n &&
+           fwrite(columns.tensions.data(), sizeof(double), n, out) == n &&
+           fwrite(columns.shapes.data(), sizeof(int32_t), n, out) == n &&
+           fwrite(columns.selected.data(), sizeof(uint8_t), n, out) == n &&
+           fwrite(zeros, 1, padding, out) == padding;
+}
+
+// owners by GUID string, the takes only when the file has take envelopes
+struct Owners
+{
+    std::unordered_map<std::string, MediaTrack *> tracks;
+    std::unordered_map<std::string, MediaItem_Take *> takes;
+};
+
+void index_owners(Owners &owners, bool with_takes)
+{
+    char guid[64];
+    const int track_count = CountTracks(nullptr);
+    for (int i = 0; i < track_count; i++) {
+        MediaTrack *track = GetTrack(nullptr, i);
+        guidToString(GetTrackGUID(track), guid);
+        owners.tracks.emplace(guid, track);
+    }
+    if (!with_takes)
+        return;
+    const int item_count = CountMediaItems(nullptr);
+    for (int i = 0; i < item_count; i++) {
+        MediaItem *item = GetMediaItem(nullptr, i);
+        const int take_count = CountTakes(item);
+        for (int j = 0; j < take_count; j++) {
+            MediaItem_Take *take = GetMediaItemTake(item, j);
+            if (take && GetSetMediaItemTakeInfo_String(take, "GUID", guid, false))
+                owners.takes.emplace(guid, take);
+        }
+    }
+}
+
+bool has_name(TrackEnvelope *env, std::string_view name)
+{
+    char buf[sizeof(EnvelopeHeader::name)];
+    return env && GetEnvelopeName(env, buf, sizeof(buf)) && name == buf;
+}
+
+// by owner GUID, then by name: at the stored index if the envelope there still has it, anywhere
+// among the owner's envelopes otherwise
+TrackEnvelope *find_envelope(const Owners &owners, const EnvelopeHeader &header)
+{
+    const std::string guid(header.owner_guid, strnlen(header.owner_guid, sizeof(header.owner_guid)));
+    const std::string_view name(header.name, strnlen(header.name, sizeof(header.name)));
+    MediaTrack *track = nullptr;
+    MediaItem_Take *take = nullptr;
+    if (header.owner == OWNER_TRACK) {
+        auto it = owners.tracks.find(guid);
+        if (it == owners.tracks.end())
+            return nullptr;
+        track = it->second;
+    } else {
+        auto it = owners.takes.find(guid);
+        if (it == owners.takes.end())
+            return nullptr;
+        take = it->second;
+    }
+
+    if (TrackEnvelope *env = owner_envelope(track, take, header.index); has_name(env, name))
+        return env;
+    const int count = owner_envelope_count(track, take);
+    for (int i = 0; i < count; i++) {
+        if (TrackEnvelope *env = owner_envelope(track, take, i); has_name(env, name))
+            return env;
+    }
+    return nullptr;
+}
+
+// replaces the envelope's underlying points with the n points of the columns
+void restore_points(TrackEnvelope *env, const char *columns, uint64_t n)
+{
+    ETHLT_TRACE_SCOPE("restore_points");
+    const int existing = CountEnvelopePointsEx(env, -1);
+    if (existing > 0) {
+        double first = 0, last = 0;
+        GetEnvelopePointEx(env, -1, 0, &first, nullptr, nullptr, nullptr, nullptr);
+        GetEnvelopePointEx(env, -1, existing - 1, &last, nullptr, nullptr, nullptr, nullptr);
+        DeleteEnvelopePointRangeEx(env, -1, first - 1, last + 1);
+    }
+
+    const char *times = columns;
+    const char *values = times + n * sizeof(double);
+    const char *tensions = values + n * sizeof(double);
+    const char *shapes = tensions + n * sizeof(double);
+    const char *selected = shapes + n * sizeof(int32_t);
+    bool nosort = true; // sorted once at the end
+    for (uint64_t i = 0; i < n; i++) {
+        InsertEnvelopePointEx(env, -1, load<double>(times, i), load<double>(values, i), load<int32_t>(shapes, i),
+                              load<double>(tensions, i), selected[i] != 0, &nosort);
+    }
+    Envelope_SortPointsEx(env, -1);
+}
+
+} // anonymous namespace
+
+void export_automation()
+{
+    char path[4096];
+    if (!prompt_path("Export Automation", path, sizeof(path)))
+        return;
+
+    // every offset is known up front, so the file is written front to back in one pass
+    const std::vector<EnvelopeRecord> &records = envelope_inventory();
+    auto headers = make_action_vector<EnvelopeHeader>();
+    headers.reserve(records.size());
+    uint64_t offset = sizeof(FileHeader) + records.size() * sizeof(EnvelopeHeader);
+    uint64_t point_total = 0;
+    const void *last_owner = nullptr;
+    int next_index = 0;
+    for (const EnvelopeRecord &record : records) {
+        const void *owner = record.take ? static_cast<const void *>(record.take) : record.track;
+        if (owner != last_owner) {
+            last_owner = owner;
+            next_index = 0;
+        }
+        EnvelopeHeader &header = headers.emplace_back(make_header(record, next_index));
+        next_index = header.index + 1;
+        header.offset = offset;
+        offset += padded(header.point_count * BYTES_PER_POINT);
+        point_total += header.point_count;
+    }
+
+    FileHeader file_header {};
+    memcpy(file_header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    file_header.envelope_size = sizeof(EnvelopeHeader);
+    file_header.envelope_count = headers.size();
+
+    const fs::path file_path = fs::u8path(path);
+    FILE *out = open_file(file_path, "wb");
+    bool ok = out != nullptr;
+    if (ok) {
+        ETHLT_TRACE_SCOPE("write automation file");
+        setvbuf(out, nullptr, _IOFBF, WRITE_BUFFER_SIZE);
+        ok = fwrite(&file_header, sizeof(file_header), 1, out) == 1 &&
+             fwrite(headers.data(), sizeof(EnvelopeHeader), headers.size(), out) == headers.size();
+        Columns columns;
+        for (size_t i = 0; ok && i < headers.size(); i++)
+            ok = write_columns(out, records[i].envelope, headers[i].point_count, columns);
+        ok = fclose(out) == 0 && ok;
+    }
+    if (!ok) {
+        std::error_code ec;
+        fs::remove(file_path, ec);
+        ShowMessageBox("Could not write the automation file.", "Export Automation", 0);
+        return;
+    }
+
+    record_objects_touched(static_cast<int>(headers.size()));
+    ETHLT_LOG(Info, "Exported %zu envelopes with %llu points to %s", headers.size(),
+              static_cast<unsigned long long>(point_total), path);
+}
+
+void import_automation()
+{
+    char path[4096];
+    if (!prompt_path("Import Automation", path, sizeof(path)))
+        return;
+
+    const MappedFile file {fs::u8path(path)};
+    const std::string_view data = file.view();
+    FileHeader file_header {};
+    if (data.size() >= sizeof(file_header))
+        memcpy(&file_header, data.data(), sizeof(file_header));
+    if (memcmp(file_header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 ||
+        file_header.envelope_size != sizeof(EnvelopeHeader) ||
+        file_header.envelope_count > (data.size() - sizeof(FileHeader)) / sizeof(EnvelopeHeader)) {
+        ShowMessageBox("This is not a readable automation file.", "Import Automation", 0);
+        return;
+    }
+
+    const char *table = data.data() + sizeof(FileHeader);
+    const size_t envelope_count = static_cast<size_t>(file_header.envelope_count);
+    bool with_takes = false;
+    for (size_t i = 0; i < envelope_count; i++)
+        with_takes |= load<EnvelopeHeader>(table, i).owner == OWNER_TAKE;
+    Owners owners;
+    index_owners(owners, with_takes);
+
+    int restored = 0, missing = 0, damaged = 0;
+    uint64_t point_total = 0;
+    PreventUIRefresh(1);
+    Undo_BeginBlock2(nullptr);
+    for (size_t i = 0; i < envelope_count; i++) {
+        const EnvelopeHeader header = load<EnvelopeHeader>(table, i);
+        if (header.offset % 8 || header.offset > data.size() ||
+            header.point_count > (data.size() - header.offset) / BYTES_PER_POINT) {
+            damaged++;
+            continue;
+        }
+        TrackEnvelope *env = find_envelope(owners, header);
+        if (!env) {
+            missing++;
+            continue;
+        }
+        restore_points(env, data.data() + header.offset, header.point_count);
+        point_total += header.point_count;
+        restored++;
+    }
+
+    record_objects_touched(restored);
+    char desc[64];
+    snprintf(desc, sizeof(desc), "Import Automation Of %d %s", restored, restored == 1 ? "Envelope" : "Envelopes");
+    Undo_EndBlock2(nullptr, desc, UNDO_STATE_TRACKCFG | UNDO_STATE_FXENVELOPES | UNDO_STATE_ITEMS);
+    PreventUIRefresh(-1);
+    request_refresh(REFRESH_ARRANGE);
+
+    ETHLT_LOG(Info, "Imported %d envelopes with %llu points from %s", restored,
+              static_cast<unsigned long long>(point_total), path);
+    if (missing || damaged)
+        ETHLT_LOG(Warn, "Import Automation: %d envelopes are not in this project, %d are damaged in the file",
+                  missing, damaged);
+}
+
+} // namespace PROJECT_NAME
@@ -0,0 +1,27 @@
+#pragma once
+#include "config.h"
+#include "reaper_plugin_functions.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+
+// Automation files hold the underlying points of every track and take envelope of a project in a
+// columnar binary layout, for backups and for analysis outside of REAPER. Native byte order, which
+// is little-endian on every platform REAPER runs on:
+//   header      char magic[8] = "ETHLTAU1", u32 envelope header size (128), u32 0, u64 envelope count
+//   envelopes   per envelope: char owner_guid[40], char name[64] (both NUL-padded), u32 owner
+//               (0 track, 1 take), i32 index among its owner's envelopes, u64 point count n,
+//               u64 file offset of its columns (a multiple of 8)
+//   columns     per envelope: f64 time[n], f64 value[n], f64 tension[n], i32 shape[n],
+//               u8 selected[n], zero-padded to a multiple of 8
+// Values are raw envelope values, as GetEnvelopePointEx returns them. Automation items are not
+// included.
+namespace PROJECT_NAME
+{
+
+// asks for a file name and writes the project's automation to it
+void export_automation();
+
+// asks for a file name and replaces the points of each envelope in it that is found in the project,
+// by owner GUID and envelope name, as one undo point
+void import_automation();
+
+} // namespace PROJECT_NAME
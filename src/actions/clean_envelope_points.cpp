@@ -1,8 +1,13 @@
 #include "clean_envelope_points.h"
+#include "../action_stats.h"
+#include "../arena.h"
+#include "../envelope_index.h"
+#include "../refresh.h"
+#include "../trace.h"
+#include "../core/envelope_cleaner.h"
+#include <algorithm>
 #include <cmath>
-#include <optional>
-#include <stack>
-#include <string>
+#include <cstdio>
 
 namespace PROJECT_NAME
 {
@@ -10,266 +15,139 @@ namespace PROJECT_NAME
 namespace
 {
 
-union reinterpretable_double
+struct EnvPoint
 {
-    double d;
-    uint64_t i;
-
-    struct
-    {
-        uint64_t value : 63;
-        uint64_t sign : 1;
-    } bitfield;
-
-    constexpr reinterpretable_double(double value) noexcept : d(value) { }
-
-    // constexpr reinterpretable_double(uint64_t value) noexcept : i(value) { }
+    double time, value;
+    int shape;
+    int index; // in the envelope or automation item, before any deletion
 };
 
-constexpr int IGNORE_LAST_N_BITS = 34;
+using EnvPoints = ArenaVector<EnvPoint>;
 
-constexpr inline bool almost_equal(reinterpretable_double a, reinterpretable_double b) noexcept
+// deletes the points that did not survive, highest index first so the remaining indices stay valid;
+// points outside of [start, end] stay either way
+static int delete_envelope_points(TrackEnvelope *env, int autoitem_idx, const EnvPoints &read,
+                                  const EnvPoints &kept, double start = -HUGE_VAL, double end = HUGE_VAL)
 {
-    if (a.d == b.d)
-        return true;
-
-    if (std::isfinite(a.d) && std::isfinite(b.d)) {
-        const uint64_t diff = (a.bitfield.sign == b.bitfield.sign)
-                                  ? (a.bitfield.value > b.bitfield.value)
-                                        ? (a.bitfield.value - b.bitfield.value)
-                                        : (b.bitfield.value - a.bitfield.value)
-                                  : (a.bitfield.value + b.bitfield.value);
-
-        return !(diff >> IGNORE_LAST_N_BITS);
+    ETHLT_TRACE_SCOPE("DeleteEnvelopePointEx");
+    int count = 0;
+    auto survivor = kept.rbegin();
+    for (auto it = read.rbegin(); it != read.rend(); ++it) {
+        if (survivor != kept.rend() && survivor->index == it->index) {
+            ++survivor;
+            continue;
+        }
+        if (it->time < start || it->time > end)
+            continue;
+        DeleteEnvelopePointEx(env, autoitem_idx, it->index);
+        count++;
     }
-
-    return false;
+    return count;
 }
 
-struct EnvPoint
-{
-    double time, value;
-    int shape;
-};
-
-static int handle_envelope(TrackEnvelope *env)
+// read and kept are scratch lists shared by all envelopes, so they only grow to the largest one
+static int handle_envelope(TrackEnvelope *env, EnvPoints &read, EnvPoints &kept)
 {
-    int point_count, del_point_count = 0;
-    std::stack<int> del_point_indices;
-    std::optional<EnvPoint> last_point, second_last_point;
+    ETHLT_TRACE_SCOPE("handle_envelope");
+    int del_point_count = 0;
 
     int autoitem_count = CountAutomationItems(env);
     for (int i = -1; i < autoitem_count; i++) { // -1 is for underlying envelope
+        ETHLT_TRACE_SCOPE(i < 0 ? "clean underlying envelope" : "clean automation item");
 
-        // delete consecutive points with the same time
-        point_count = CountEnvelopePointsEx(env, i);
+        read.clear();
+        const int point_count = CountEnvelopePointsEx(env, i);
+        read.reserve(point_count);
         for (int j = 0; j < point_count; j++) {
-            EnvPoint point;
-            if (!GetEnvelopePointEx(env, i, j, &point.time, &point.value, &point.shape, nullptr,
-                                    nullptr))
-                continue;
-
-            // ShowConsoleMsg((std::to_string(j) + ":\n" +
-            //     "    second_last_point: " + (second_last_point.has_value() ? floatToString(second_last_point->time) : "NaN") + "\n"
-            //     "    last_point:        " + (last_point.has_value() ? floatToString(last_point->time) : "NaN") + "\n" +
-            //     "    point:             " + floatToString(point.time) + "\n" +
-            //     (last_point.has_value() && second_last_point.has_value() ? (
-            //         std::string("    last_time == time: ") + (almost_equal(last_point->time, point.time) ? "true" : "false") + "\n" +
-            //         "    second_time == time: " + (almost_equal(second_last_point->time, last_point->time) ? "true" : "false") + "\n" ) : ""
-            //     ) + "\n"
-            // ).c_str());
-
-            if (last_point.has_value() && second_last_point.has_value() &&
-                almost_equal(last_point->time, point.time) &&
-                almost_equal(second_last_point->time, last_point->time))
-                del_point_indices.push(j - 1);
-
-            second_last_point = last_point;
-            last_point = point;
-        }
-
-        del_point_count += static_cast<int>(del_point_indices.size());
-
-        while (!del_point_indices.empty()) {
-            DeleteEnvelopePointEx(env, i, del_point_indices.top());
-            del_point_indices.pop();
+            EnvPoint point {0, 0, 0, j};
+            if (GetEnvelopePointEx(env, i, j, &point.time, &point.value, &point.shape, nullptr, nullptr))
+                read.push_back(point);
         }
 
-        last_point = std::nullopt;
-        second_last_point = std::nullopt;
-
-        // delete overlapping points
-        point_count = CountEnvelopePointsEx(env, i);
-        for (int j = 0; j < point_count; j++) {
-            EnvPoint point;
-            if (!GetEnvelopePointEx(env, i, j, &point.time, &point.value, &point.shape, nullptr,
-                                    nullptr))
-                continue;
-
-            if (last_point.has_value() && almost_equal(last_point->time, point.time) &&
-                last_point->value == point.value)
-                del_point_indices.push(j - 1);
-
-            last_point = point;
-        }
-
-        del_point_count += static_cast<int>(del_point_indices.size());
-
-        while (!del_point_indices.empty()) {
-            DeleteEnvelopePointEx(env, i, del_point_indices.top());
-            del_point_indices.pop();
-        }
-
-        last_point = std::nullopt;
-        second_last_point = std::nullopt;
-
-        // delete consecutive points with the same value
-        point_count = CountEnvelopePointsEx(env, i);
-        for (int j = 0; j < point_count; j++) {
-            EnvPoint point;
-            if (!GetEnvelopePointEx(env, i, j, &point.time, &point.value, &point.shape, nullptr,
-                                    nullptr))
-                continue;
-
-            if (last_point.has_value() && second_last_point.has_value() &&
-                last_point->value == point.value && second_last_point->value == last_point->value)
-                del_point_indices.push(j - 1);
-
-            second_last_point = last_point;
-            last_point = point;
-        }
-
-        del_point_count += static_cast<int>(del_point_indices.size());
-
-        while (!del_point_indices.empty()) {
-            DeleteEnvelopePointEx(env, i, del_point_indices.top());
-            del_point_indices.pop();
-        }
-
-        last_point = std::nullopt;
-        second_last_point = std::nullopt;
-
-        // delete unnecessary square points
-        point_count = CountEnvelopePointsEx(env, i);
-        for (int j = 0; j < point_count; j++) {
-            EnvPoint point;
-            if (!GetEnvelopePointEx(env, i, j, &point.time, &point.value, &point.shape, nullptr,
-                                    nullptr))
-                continue;
-
-            if (last_point.has_value() && last_point->shape == 1 && point.shape == 1 &&
-                last_point->value == point.value)
-                del_point_indices.push(j);
-
-            last_point = point;
-        }
-
-        del_point_count += static_cast<int>(del_point_indices.size());
-
-        while (!del_point_indices.empty()) {
-            DeleteEnvelopePointEx(env, i, del_point_indices.top());
-            del_point_indices.pop();
-        }
-
-        last_point = std::nullopt;
-        second_last_point = std::nullopt;
-
-        // check if the tail point is necessary
-        point_count = CountEnvelopePointsEx(env, i);
-        if (point_count >= 2) {
-            EnvPoint point, tail_point;
-            if (GetEnvelopePointEx(env, i, point_count - 2, &point.time, &point.value, &point.shape,
-                                   nullptr, nullptr) &&
-                GetEnvelopePointEx(env, i, point_count - 1, &tail_point.time, &tail_point.value,
-                                   &tail_point.shape, nullptr, nullptr) &&
-                point.value == tail_point.value)
-            {
-                DeleteEnvelopePointEx(env, i, point_count - 1);
-                del_point_count++;
-            }
-        }
-
-        // check if the head point is necessary
-        point_count = CountEnvelopePointsEx(env, i);
-        if (point_count >= 2) {
-            EnvPoint head_point, point;
-            if (GetEnvelopePointEx(env, i, 0, &head_point.time, &head_point.value, &head_point.shape,
-                                   nullptr, nullptr) &&
-                GetEnvelopePointEx(env, i, 1, &point.time, &point.value, &point.shape, nullptr,
-                                   nullptr) &&
-                head_point.value == point.value)
-            {
-                DeleteEnvelopePointEx(env, i, 0);
-                del_point_count++;
-            }
-        }
+        kept = read;
+        if (core::clean_envelope_points(kept))
+            del_point_count += delete_envelope_points(env, i, read, kept);
     }
 
-    if (del_point_count)
+    if (del_point_count) {
+        ETHLT_TRACE_SCOPE("Envelope_SortPoints");
         Envelope_SortPoints(env);
+    }
 
     return del_point_count;
 }
 
-static int handle_all_track_envelopes()
+// The slice read around the range includes two points on either side, so the run rules see the
+// neighbours a full clean would. Those context points are never deleted themselves, e.g. when the
+// tail rule drops the slice's last point.
+static int handle_envelope_range(TrackEnvelope *env, double start, double end, EnvPoints &read,
+                                 EnvPoints &kept)
 {
-    int del_point_count = 0;
-
-    int track_count = CountTracks(nullptr);
-    for (int i = 0; i < track_count; i++) {
-        MediaTrack *track = GetTrack(nullptr, i);
-        if (!track)
-            continue;
+    ETHLT_TRACE_SCOPE("handle_envelope_range");
+    const int point_count = CountEnvelopePointsEx(env, -1);
+    const int first = std::max(0, GetEnvelopePointByTimeEx(env, -1, start) - 1);
+    const int last = std::min(point_count - 1, GetEnvelopePointByTimeEx(env, -1, end) + 2);
+    if (last <= first)
+        return 0;
+
+    read.clear();
+    read.reserve(last - first + 1);
+    for (int j = first; j <= last; j++) {
+        EnvPoint point {0, 0, 0, j};
+        if (GetEnvelopePointEx(env, -1, j, &point.time, &point.value, &point.shape, nullptr, nullptr))
+            read.push_back(point);
+    }
 
-        // handle track envelopes
-        int env_count = CountTrackEnvelopes(track);
-        for (int j = 0; j < env_count; j++) {
-            TrackEnvelope *env = GetTrackEnvelope(track, j);
-            if (!env)
-                continue;
-            del_point_count += handle_envelope(env);
-        }
+    kept = read;
+    if (!core::clean_envelope_points(kept))
+        return 0;
+    const int del_point_count = delete_envelope_points(env, -1, read, kept, start, end);
+    if (del_point_count) {
+        ETHLT_TRACE_SCOPE("Envelope_SortPoints");
+        Envelope_SortPoints(env);
+    }
+    return del_point_count;
+}
 
-        // handle take envelopes
-        int item_count = CountTrackMediaItems(track);
-        for (int j = 0; j < item_count; j++) {
-            MediaItem *item = GetTrackMediaItem(track, j);
-            if (!item)
-                continue;
+} // anonymous namespace
 
-            int take_count = CountTakes(item);
-            for (int k = 0; k < take_count; k++) {
-                MediaItem_Take *take = GetMediaItemTake(item, k);
-                if (!take)
-                    continue;
+int clean_envelope_point_range(TrackEnvelope *env, double start, double end)
+{
+    auto read = make_action_vector<EnvPoint>();
+    auto kept = make_action_vector<EnvPoint>();
+    return handle_envelope_range(env, start, end, read, kept);
+}
 
-                int take_env_count = CountTakeEnvelopes(take);
-                for (int l = 0; l < take_env_count; l++) {
-                    TrackEnvelope *env = GetTakeEnvelope(take, l);
-                    if (!env)
-                        continue;
+int clean_all_envelope_points()
+{
+    int del_point_count = 0;
+    auto read = make_action_vector<EnvPoint>();
+    auto kept = make_action_vector<EnvPoint>();
 
-                    del_point_count += handle_envelope(env);
-                }
-            }
-        }
+    for (const EnvelopeRecord &record : envelope_inventory()) {
+        // nothing to clean in a lone point, skip the per-envelope passes entirely; the inventory's
+        // counts can predate the last edit, so they are read fresh
+        if (CountEnvelopePointsEx(record.envelope, -1) < 2 && !CountAutomationItems(record.envelope))
+            continue;
+        del_point_count += handle_envelope(record.envelope, read, kept);
     }
 
     return del_point_count;
 }
 
-} // anonymous namespace
-
 void clean_envelope_points()
 {
     PreventUIRefresh(1);
 
-    if (int n = handle_all_track_envelopes())
-        Undo_OnStateChange(
-            ("Clean " + std::to_string(n) + (n == 1 ? " Envelope Point" : " Envelope Points")).c_str());
-
+    if (int n = clean_all_envelope_points()) {
+        record_objects_touched(n);
+        ETHLT_TRACE_SCOPE("Undo_OnStateChange");
+        char desc[64];
+        snprintf(desc, sizeof(desc), "Clean %d %s", n, n == 1 ? "Envelope Point" : "Envelope Points");
+        Undo_OnStateChange(desc);
+        request_refresh(REFRESH_ARRANGE);
+    }
     PreventUIRefresh(-1);
-    UpdateArrange();
 }
 
 } // namespace PROJECT_NAME
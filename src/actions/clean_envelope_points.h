@@ -8,4 +8,12 @@ namespace PROJECT_NAME
 
 void clean_envelope_points();
 
+// removes the redundant points of every envelope in the project, without an undo point or redraw;
+// returns how many went
+int clean_all_envelope_points();
+
+// the same for the underlying points of one envelope between start and end (seconds), judged with
+// the points around that range as context; returns how many went
+int clean_envelope_point_range(TrackEnvelope *env, double start, double end);
+
 }
@@ -0,0 +1,187 @@
+#include "clean_recorded_automation.h"
+#include "clean_envelope_points.h"
+#include "../arena.h"
+#include "../envelope_index.h"
+#include "../log.h"
+#include "../refresh.h"
+#include "../scheduler.h"
+#include "../trace.h"
+#include "../core/fnv.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+constexpr double POLL_INTERVAL_MS = 100;
+constexpr double RANGE_MARGIN = 0.25; // seconds, the first and last poll of a pass can be an interval off
+
+struct Fingerprint
+{
+    TrackEnvelope *envelope;
+    bool writing;  // its track wrote automation when the pass started
+    uint64_t hash; // point_fingerprint(), taken for writing tracks only
+};
+
+TaskId watch_task = INVALID_TASK_ID;
+
+// the playback pass being watched
+bool in_pass = false;
+ReaProject *pass_project = nullptr;
+double pass_origin = 0;                     // play position the pass started at
+double pass_start = 0, pass_end = 0;       // extent of the play positions seen, loops included
+std::vector<Fingerprint> fingerprints_before; // sorted by envelope
+
+bool by_envelope(const Fingerprint &a, const Fingerprint &b)
+{
+    return std::less<TrackEnvelope *>()(a.envelope, b.envelope);
+}
+
+// nullptr for envelopes that did not exist when the pass started
+const Fingerprint *fingerprint_before(TrackEnvelope *env)
+{
+    const Fingerprint key {env, false, 0};
+    auto it = std::lower_bound(fingerprints_before.begin(), fingerprints_before.end(), key, by_envelope);
+    return it != fingerprints_before.end() && it->envelope == env ? &*it : nullptr;
+}
+
+// Touch, Write or Latch, with the global override in place of the track's mode; Latch Preview and
+// a Bypass override write nothing
+bool writes_automation(MediaTrack *track)
+{
+    int mode = GetGlobalAutomationOverride();
+    if (mode < 0)
+        mode = GetTrackAutomationMode(track);
+    return mode == 2 || mode == 3 || mode == 4;
+}
+
+// the point count and the points around the pass's start: every pass that writes replaces the
+// points at the position it starts from, so a Write pass that swaps points one for one shows up
+// there as well, and only a binary search and a few points are read per envelope
+uint64_t point_fingerprint(TrackEnvelope *env)
+{
+    uint64_t hash = core::FNV_OFFSET_BASIS;
+    auto mix_double = [&](double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        core::fnv_mix(hash, bits);
+    };
+
+    const int count = CountEnvelopePointsEx(env, -1);
+    core::fnv_mix(hash, static_cast<uint64_t>(count));
+    const double end = pass_origin + RANGE_MARGIN;
+    for (int i = std::max(0, GetEnvelopePointByTimeEx(env, -1, pass_origin - RANGE_MARGIN)); i < count; i++) {
+        double time = 0, value = 0, tension = 0;
+        int shape = 0;
+        GetEnvelopePointEx(env, -1, i, &time, &value, &shape, &tension, nullptr);
+        if (time > end)
+            break;
+        mix_double(time);
+        mix_double(value);
+        mix_double(tension);
+        core::fnv_mix(hash, static_cast<uint64_t>(shape));
+    }
+    return hash;
+}
+
+void begin_pass(double position)
+{
+    ETHLT_TRACE_SCOPE("begin recorded automation pass");
+    pass_origin = position;
+    fingerprints_before.clear();
+    for (const EnvelopeRecord &record : envelope_inventory()) {
+        // automation is recorded into track envelopes only
+        if (record.owner != EnvelopeOwner::Track)
+            continue;
+        const bool writing = writes_automation(record.track);
+        const uint64_t hash = writing ? point_fingerprint(record.envelope) : 0;
+        fingerprints_before.push_back({record.envelope, writing, hash});
+    }
+    std::sort(fingerprints_before.begin(), fingerprints_before.end(), by_envelope);
+
+    in_pass = true;
+    pass_project = EnumProjects(-1, nullptr, 0);
+    pass_start = pass_end = position;
+}
+
+// cleans the envelopes the pass recorded into, over the range it played
+void end_pass()
+{
+    in_pass = false;
+    if (EnumProjects(-1, nullptr, 0) != pass_project)
+        return; // switched project tabs, the fingerprints are of another project
+
+    ETHLT_TRACE_SCOPE("clean recorded automation");
+    ScopedActionArena arena; // the cleaner's scratch lists, outside of any action
+    const double start = pass_start - RANGE_MARGIN, end = pass_end + RANGE_MARGIN;
+    int del_point_count = 0, envelope_count = 0;
+
+    PreventUIRefresh(1);
+    for (const EnvelopeRecord &record : envelope_inventory()) {
+        if (record.owner != EnvelopeOwner::Track)
+            continue;
+        // envelopes new since the pass started count as recorded if their track writes now
+        const Fingerprint *before = fingerprint_before(record.envelope);
+        if (before ? !before->writing || point_fingerprint(record.envelope) == before->hash
+                   : !writes_automation(record.track))
+            continue;
+        envelope_count++;
+        del_point_count += clean_envelope_point_range(record.envelope, start, end);
+    }
+
+    if (del_point_count) {
+        char desc[96];
+        snprintf(desc, sizeof(desc), "Clean %d Recorded Envelope %s", del_point_count,
+                 del_point_count == 1 ? "Point" : "Points");
+        Undo_OnStateChange(desc);
+        request_refresh(REFRESH_ARRANGE);
+    }
+    PreventUIRefresh(-1);
+
+    if (envelope_count)
+        ETHLT_LOG(Debug, "Clean recorded automation: %d points from %d envelopes between %.3f and %.3f s",
+                  del_point_count, envelope_count, start, end);
+}
+
+TaskStatus poll(TaskContext &)
+{
+    // pausing ends a pass as well, the points written so far are final
+    if (GetPlayState() & 1) {
+        const double position = GetPlayPosition2();
+        if (!in_pass)
+            begin_pass(position);
+        pass_start = std::min(pass_start, position);
+        pass_end = std::max(pass_end, position);
+    } else if (in_pass) {
+        end_pass();
+    }
+    return TaskStatus::Continue;
+}
+
+} // anonymous namespace
+
+void toggle_clean_recorded_automation()
+{
+    if (main_scheduler().is_scheduled(watch_task)) {
+        main_scheduler().cancel(watch_task);
+        watch_task = INVALID_TASK_ID;
+        in_pass = false;
+        fingerprints_before.clear();
+        return;
+    }
+    watch_task = schedule_on_main(poll, {0, 1, POLL_INTERVAL_MS});
+}
+
+bool is_cleaning_recorded_automation()
+{
+    return main_scheduler().is_scheduled(watch_task);
+}
+
+} // namespace PROJECT_NAME
@@ -0,0 +1,17 @@
+#pragma once
+#include "config.h"
+#include "reaper_plugin_functions.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+
+namespace PROJECT_NAME
+{
+
+// While on, every playback pass that wrote automation (Latch, Write or Touch) is followed by a
+// clean of the written envelopes with the Clean Envelope Points rules, limited to the time range
+// that played, as one undo point. Only envelopes on tracks whose automation mode writes, or that
+// the global automation override sets to a writing mode, are considered, and of those only the
+// ones whose points changed during the pass.
+void toggle_clean_recorded_automation();
+bool is_cleaning_recorded_automation();
+
+} // namespace PROJECT_NAME
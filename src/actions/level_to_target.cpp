@@ -0,0 +1,133 @@
+#include "level_to_target.h"
+#include "../action_stats.h"
+#include "../log.h"
+#include "../refresh.h"
+#include "../track_meter.h"
+#include "../core/parse_number.h"
+#include "../core/volume.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+using core::adjust_volume;
+
+constexpr const char *EXTSTATE_SECTION = "ethlt_reaper_toolkit";
+constexpr const char *EXTSTATE_TARGET = "live_meter_target_level"; // dB RMS
+constexpr double DEFAULT_TARGET_DB = -18;
+
+constexpr double ON_TARGET_DB = 0.25; // half a fine step
+constexpr double COARSE_ABOVE_DB = 3; // one coarse step
+
+double target_db = DEFAULT_TARGET_DB;
+
+static bool prompt_target_level()
+{
+    char buf[32];
+    const char *last = GetExtState(EXTSTATE_SECTION, EXTSTATE_TARGET);
+    if (last && *last)
+        snprintf(buf, sizeof(buf), "%s", last);
+    else
+        snprintf(buf, sizeof(buf), "%g", DEFAULT_TARGET_DB);
+
+    if (!GetUserInputs("Live Track Meters", 1, "Target level (dB RMS):", buf, sizeof(buf)))
+        return false;
+
+    double target;
+    if (!core::parse_double(buf, target) || !(target >= -60) || !(target <= 0)) {
+        ShowMessageBox("Enter a target level from -60 to 0 dB RMS.", "Live Track Meters", 0);
+        return false;
+    }
+
+    target_db = target;
+    snprintf(buf, sizeof(buf), "%g", target);
+    SetExtState(EXTSTATE_SECTION, EXTSTATE_TARGET, buf, true);
+    return true;
+}
+
+// the track's next volume, or its current one when it is on target or a step up would clip
+static double stepped_volume(double vol, const TrackLevel &level)
+{
+    const double diff = target_db - 20 * std::log10(level.rms);
+    if (std::fabs(diff) < ON_TARGET_DB)
+        return vol;
+    if (diff < 0)
+        return diff <= -COARSE_ABOVE_DB ? adjust_volume<false, false>(vol) : adjust_volume<false, true>(vol);
+
+    for (double next : {diff >= COARSE_ABOVE_DB ? adjust_volume<true, false>(vol) : adjust_volume<true, true>(vol),
+                        adjust_volume<true, true>(vol)}) {
+        if (vol <= 0 || level.peak * next / vol <= 1)
+            return next;
+    }
+    return vol;
+}
+
+} // anonymous namespace
+
+void toggle_live_track_meters()
+{
+    if (is_track_metering()) {
+        stop_track_metering();
+        return;
+    }
+
+    std::vector<MediaTrack *> tracks;
+    const int track_count = CountSelectedTracks(nullptr);
+    for (int i = 0; i < track_count; i++)
+        tracks.push_back(GetSelectedTrack(nullptr, i));
+    if (tracks.empty() || !prompt_target_level())
+        return;
+    start_track_metering(tracks);
+}
+
+bool is_live_track_metering()
+{
+    return is_track_metering();
+}
+
+void step_tracks_toward_target_level()
+{
+    if (!is_track_metering())
+        return;
+
+    int stepped = 0, unmetered = 0;
+    PreventUIRefresh(1);
+    const int track_count = CountSelectedTracks(nullptr);
+    for (int i = 0; i < track_count; i++) {
+        MediaTrack *track = GetSelectedTrack(nullptr, i);
+        TrackLevel level;
+        if (!get_track_level(track, level) || !(level.rms > 0)) {
+            unmetered++;
+            continue;
+        }
+
+        const double vol = GetMediaTrackInfo_Value(track, "D_VOL");
+        const double new_vol = stepped_volume(vol, level);
+        if (new_vol == vol)
+            continue;
+        SetMediaTrackInfo_Value(track, "D_VOL", new_vol);
+        forget_track_level(track); // its readings so far are from the old volume
+        stepped++;
+    }
+
+    if (stepped) {
+        record_objects_touched(stepped);
+        char desc[96];
+        snprintf(desc, sizeof(desc), "Step %d %s Toward %g dB RMS", stepped, stepped == 1 ? "Track" : "Tracks",
+                 target_db);
+        Undo_OnStateChange(desc);
+        request_refresh(REFRESH_TRACK_CONTROLS);
+    }
+    PreventUIRefresh(-1);
+
+    if (unmetered)
+        ETHLT_LOG(Info, "Step Toward Target Level: %d selected tracks have no live level yet, play them first",
+                  unmetered);
+}
+
+} // namespace PROJECT_NAME
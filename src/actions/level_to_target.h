@@ -0,0 +1,17 @@
+#pragma once
+#include "config.h"
+#include "reaper_plugin_functions.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+
+namespace PROJECT_NAME
+{
+
+// starts live metering of the selected tracks after asking for the target level, or stops it
+void toggle_live_track_meters();
+bool is_live_track_metering();
+
+// moves the volume of each selected, metered track one step toward the target level, judged by
+// its live meter; repeated while playing, it settles on the target
+void step_tracks_toward_target_level();
+
+} // namespace PROJECT_NAME
@@ -0,0 +1,265 @@
+#include "normalize_items.h"
+#include "../action_stats.h"
+#include "../analysis_cache.h"
+#include "../log.h"
+#include "../refresh.h"
+#include "../trace.h"
+#include "../core/loudness.h"
+#include "../core/parse_number.h"
+#include "../core/volume.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+using core::LoudnessMeter;
+
+constexpr const char *EXTSTATE_SECTION = "ethlt_reaper_toolkit";
+constexpr const char *EXTSTATE_NORMALIZE = "normalize_loudness"; // "target,ceiling"
+constexpr double DEFAULT_TARGET_LUFS = -14;
+constexpr double DEFAULT_CEILING_DB = -1;
+
+// frames per GetAudioAccessorSamples call; large reads keep the per-call overhead negligible
+constexpr int BLOCK_FRAMES = 1 << 16;
+
+struct NormalizeTarget
+{
+    double lufs, ceiling_db;
+};
+
+constexpr size_t NOT_SHARED = SIZE_MAX;
+
+// one selected take, set up on the main thread and measured on a worker, unless the analysis
+// cache or another item with the same audio already has its result
+struct Job
+{
+    MediaItem *item;
+    AudioAccessor *accessor;
+    int rate, channels;
+    double start, end;
+    bool cacheable;
+    uint64_t key;
+    size_t same_as; // index of the job measuring the same audio, or NOT_SHARED
+
+    bool ok = false;
+    AnalysisResult result = {0, 0, core::LUFS_SILENCE};
+};
+
+static bool prompt_target(NormalizeTarget &target)
+{
+    char buf[64];
+    const char *last = GetExtState(EXTSTATE_SECTION, EXTSTATE_NORMALIZE);
+    if (last && *last)
+        snprintf(buf, sizeof(buf), "%s", last);
+    else
+        snprintf(buf, sizeof(buf), "%g,%g", DEFAULT_TARGET_LUFS, DEFAULT_CEILING_DB);
+
+    if (!GetUserInputs("Normalize Items Loudness", 2, "Target loudness (LUFS):,Peak ceiling (dBFS):", buf,
+                       sizeof(buf)))
+        return false;
+
+    const std::string_view input = buf;
+    const size_t comma = input.find(',');
+    if (comma == std::string_view::npos || !core::parse_double(input.substr(0, comma), target.lufs) ||
+        !core::parse_double(input.substr(comma + 1), target.ceiling_db) || !(target.lufs >= -70) ||
+        !(target.lufs <= 0) || !(target.ceiling_db >= -60) || !(target.ceiling_db <= 0)) {
+        ShowMessageBox("Enter a target from -70 to 0 LUFS and a peak ceiling from -60 to 0 dBFS.",
+                       "Normalize Items Loudness", 0);
+        return false;
+    }
+
+    snprintf(buf, sizeof(buf), "%g,%g", target.lufs, target.ceiling_db);
+    SetExtState(EXTSTATE_SECTION, EXTSTATE_NORMALIZE, buf, true);
+    return true;
+}
+
+// accessors have to be created (and destroyed) on the main thread; takes whose result is known
+// from the cache or shared with an earlier take in the selection get none
+static std::vector<Job> create_jobs(int &skipped)
+{
+    std::vector<Job> jobs;
+    std::unordered_map<uint64_t, size_t> first_with_key;
+    const int item_count = CountSelectedMediaItems(nullptr);
+    jobs.reserve(item_count);
+    for (int i = 0; i < item_count; i++) {
+        MediaItem *item = GetSelectedMediaItem(nullptr, i);
+        MediaItem_Take *take = item ? GetActiveTake(item) : nullptr;
+        PCM_source *source = take && !TakeIsMIDI(take) ? GetMediaItemTake_Source(take) : nullptr;
+        const int rate = source ? GetMediaSourceSampleRate(source) : 0;
+        const int channels = std::min(source ? GetMediaSourceNumChannels(source) : 0, LoudnessMeter::MAX_CHANNELS);
+        if (rate <= 0 || channels <= 0) {
+            skipped++;
+            continue;
+        }
+
+        Job job {item, nullptr, rate, channels, 0, 0, false, 0, NOT_SHARED};
+        job.cacheable =
+            analysis_key(take, GetMediaItemInfo_Value(item, "D_LENGTH"), rate, channels, job.key);
+        if (job.cacheable) {
+            if (find_analysis(job.key, job.result)) {
+                job.ok = true;
+                jobs.push_back(job);
+                continue;
+            }
+            if (auto it = first_with_key.find(job.key); it != first_with_key.end()) {
+                job.same_as = it->second;
+                jobs.push_back(job);
+                continue;
+            }
+        }
+
+        job.accessor = CreateTakeAudioAccessor(take);
+        if (!job.accessor) {
+            skipped++;
+            continue;
+        }
+        job.start = GetAudioAccessorStartTime(job.accessor);
+        job.end = GetAudioAccessorEndTime(job.accessor);
+        if (job.cacheable)
+            first_with_key.emplace(job.key, jobs.size());
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+// runs on a worker thread, touching nothing but its own accessor
+static void measure(Job &job, std::vector<double> &buffer)
+{
+    LoudnessMeter meter(job.rate, job.channels);
+    buffer.resize(static_cast<size_t>(BLOCK_FRAMES) * job.channels);
+
+    const double length = job.end - job.start;
+    const long long total_frames = length > 0 ? static_cast<long long>(std::ceil(length * job.rate)) : 0;
+    for (long long done = 0; done < total_frames;) {
+        const int frames = static_cast<int>(std::min<long long>(BLOCK_FRAMES, total_frames - done));
+        const double time = job.start + static_cast<double>(done) / job.rate;
+        const int result = GetAudioAccessorSamples(job.accessor, job.rate, job.channels, time, frames, buffer.data());
+        if (result < 0)
+            return;
+        if (result == 0) // no audio in this block, which still counts towards the length
+            std::fill_n(buffer.data(), static_cast<size_t>(frames) * job.channels, 0.0);
+        meter.process(buffer.data(), frames);
+        done += frames;
+    }
+
+    job.result = {meter.peak(), meter.rms(), meter.integrated_lufs()};
+    job.ok = true;
+}
+
+// spreads the jobs over worker threads, largest first; the main thread joins in and waits, so the
+// accessors stay valid and no one edits the project meanwhile
+static void measure_all(std::vector<Job> &jobs)
+{
+    std::vector<size_t> order;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (jobs[i].accessor)
+            order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return (jobs[a].end - jobs[a].start) * jobs[a].channels > (jobs[b].end - jobs[b].start) * jobs[b].channels;
+    });
+
+    std::atomic<size_t> next {0};
+    auto worker = [&] {
+        std::vector<double> buffer;
+        for (size_t i; (i = next.fetch_add(1)) < order.size();)
+            measure(jobs[order[i]], buffer);
+    };
+
+    unsigned thread_count = std::max(1u, std::thread::hardware_concurrency());
+    thread_count = static_cast<unsigned>(std::min<size_t>(thread_count, std::max<size_t>(1, order.size())));
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < thread_count; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+// the take accessor reads the audio before the item volume, so the gain becomes the item's new
+// volume outright; snapped to the fine volume steps, and one step lower if snapping went over
+// the ceiling
+static double normalized_volume(const Job &job, const NormalizeTarget &target)
+{
+    const double ceiling = std::pow(10.0, target.ceiling_db / 20);
+    const AnalysisResult &result = job.result;
+    double gain = std::pow(10.0, (target.lufs - result.lufs) / 20);
+    if (result.peak * gain > ceiling)
+        gain = ceiling / result.peak;
+
+    double vol = core::snap_volume(gain);
+    if (result.peak * vol > ceiling * (1 + 1e-9))
+        vol = core::snap_volume(vol * exp2(-1.0 / 12));
+    return vol;
+}
+
+} // anonymous namespace
+
+void normalize_selected_items_loudness()
+{
+    NormalizeTarget target;
+    if (!CountSelectedMediaItems(nullptr) || !prompt_target(target))
+        return;
+
+    int skipped = 0;
+    std::vector<Job> jobs;
+    {
+        ETHLT_TRACE_SCOPE("normalize: create accessors");
+        jobs = create_jobs(skipped);
+    }
+    {
+        ETHLT_TRACE_SCOPE("normalize: measure");
+        measure_all(jobs);
+    }
+
+    for (Job &job : jobs) {
+        if (job.accessor) {
+            DestroyAudioAccessor(job.accessor);
+            if (job.ok && job.cacheable)
+                store_analysis(job.key, job.result);
+        } else if (job.same_as != NOT_SHARED) {
+            job.ok = jobs[job.same_as].ok;
+            job.result = jobs[job.same_as].result;
+        }
+    }
+    save_analysis_cache();
+
+    int normalized = 0;
+    PreventUIRefresh(1);
+    for (const Job &job : jobs) {
+        if (!job.ok || job.result.lufs == core::LUFS_SILENCE || !(job.result.peak > 0)) {
+            skipped++;
+            continue;
+        }
+        SetMediaItemInfo_Value(job.item, "D_VOL", normalized_volume(job, target));
+        normalized++;
+    }
+
+    if (normalized) {
+        record_objects_touched(normalized);
+        char desc[96];
+        snprintf(desc, sizeof(desc), "Normalize %d %s To %g LUFS", normalized, normalized == 1 ? "Item" : "Items",
+                 target.lufs);
+        Undo_OnStateChange(desc);
+        request_refresh(REFRESH_ARRANGE);
+    }
+    PreventUIRefresh(-1);
+
+    if (skipped)
+        ETHLT_LOG(Info, "Normalize: %d items normalized, %d skipped (silent, MIDI or unreadable)", normalized,
+                  skipped);
+}
+
+} // namespace PROJECT_NAME
@@ -0,0 +1,13 @@
+#pragma once
+#include "config.h"
+#include "reaper_plugin_functions.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+
+namespace PROJECT_NAME
+{
+
+// sets the volume of each selected audio item so its integrated loudness hits a target, without
+// its sample peak going over a ceiling
+void normalize_selected_items_loudness();
+
+} // namespace PROJECT_NAME
@@ -1,6 +1,24 @@
 #include "setup_global_midisend.h"
+#include "../action_stats.h"
+#include "../log.h"
+#include "../refresh.h"
+#include "../routing_matrix.h"
+#include "../trace.h"
+#include "../core/onset.h"
+#include "../core/parse_number.h"
+#include "../core/pump.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <map>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace PROJECT_NAME
@@ -25,11 +43,80 @@ namespace
 //     }
 // }
 
-void init_global_midisend_track(MediaTrack *send_track)
+constexpr const char *EXTSTATE_SECTION = "ethlt_reaper_toolkit";
+constexpr const char *EXTSTATE_TRACK_GUID = "global_midisend_track_guid";
+constexpr const char *EXTSTATE_FX_GUID = "global_midisend_fx_guid";
+constexpr const char *MIDISEND_FX_NAME = "VST: ReaControlMIDI (Cockos)";
+
+// resolved global midisend track of one project
+struct MidisendTrackRef
+{
+    MediaTrack *track;
+    int fx_index;
+    GUID fx_guid;
+};
+
+// one entry per open project, so switching project tabs never invalidates another tab's lookup
+std::unordered_map<ReaProject *, MidisendTrackRef> midisend_cache;
+
+inline bool guid_equal(const GUID *a, const GUID *b) noexcept
+{
+    return a && b && memcmp(a, b, sizeof(GUID)) == 0;
+}
+
+// locate the cached ReaControlMIDI instance by GUID, following it if the FX chain was reordered
+bool locate_midisend_fx(MidisendTrackRef &ref)
+{
+    if (guid_equal(TrackFX_GetFXGUID(ref.track, ref.fx_index), &ref.fx_guid))
+        return true;
+
+    int fx_count = TrackFX_GetCount(ref.track);
+    for (int i = 0; i < fx_count; i++) {
+        if (guid_equal(TrackFX_GetFXGUID(ref.track, i), &ref.fx_guid)) {
+            ref.fx_index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+MediaTrack *find_track_by_guid(ReaProject *proj, const GUID &guid)
+{
+    int track_count = CountTracks(proj);
+    for (int i = 0; i < track_count; i++) {
+        MediaTrack *track = GetTrack(proj, i);
+        if (track && guid_equal(GetTrackGUID(track), &guid))
+            return track;
+    }
+    return nullptr;
+}
+
+// persist the track and fx GUIDs in the project so they survive reloads and undo
+void store_midisend_ref(ReaProject *proj, const MidisendTrackRef &ref)
+{
+    char guid_str[64];
+    guidToString(GetTrackGUID(ref.track), guid_str);
+    SetProjExtState(proj, EXTSTATE_SECTION, EXTSTATE_TRACK_GUID, guid_str);
+    guidToString(&ref.fx_guid, guid_str);
+    SetProjExtState(proj, EXTSTATE_SECTION, EXTSTATE_FX_GUID, guid_str);
+    midisend_cache[proj] = ref;
+}
+
+bool make_midisend_ref(MediaTrack *track, int fx_index, MidisendTrackRef *ref)
 {
-    int fx_index = TrackFX_AddByName(send_track, "VST: ReaControlMIDI (Cockos)", false, -1);
+    const GUID *fx_guid = TrackFX_GetFXGUID(track, fx_index);
+    if (!fx_guid)
+        return false;
+
+    *ref = {track, fx_index, *fx_guid};
+    return true;
+}
+
+bool init_global_midisend_track(MediaTrack *send_track, MidisendTrackRef *ref)
+{
+    int fx_index = TrackFX_AddByName(send_track, MIDISEND_FX_NAME, false, -1);
     if (fx_index == -1)
-        return;
+        return false;
 
     TrackFX_SetPreset(send_track, fx_index, "global midisend");
     char name[] = "[Global MIDI Send]";
@@ -37,102 +124,610 @@ void init_global_midisend_track(MediaTrack *send_track)
     char val_true[] = "true";
     GetSetMediaTrackInfo_String(send_track, "P_EXT:is_global_midisend", val_true, true);
     GetFXEnvelope(send_track, fx_index, 3, true);
+
+    return make_midisend_ref(send_track, fx_index, ref);
 }
 
-bool is_valid_midisend_track(MediaTrack *track)
+// resolve the project's midisend track from the GUIDs stored in its extension state
+bool resolve_stored_midisend_ref(ReaProject *proj, MidisendTrackRef *ref)
+{
+    char guid_str[64];
+    GUID track_guid, fx_guid;
+
+    if (GetProjExtState(proj, EXTSTATE_SECTION, EXTSTATE_TRACK_GUID, guid_str, sizeof(guid_str)) <= 0)
+        return false;
+    stringToGuid(guid_str, &track_guid);
+
+    if (GetProjExtState(proj, EXTSTATE_SECTION, EXTSTATE_FX_GUID, guid_str, sizeof(guid_str)) <= 0)
+        return false;
+    stringToGuid(guid_str, &fx_guid);
+
+    MediaTrack *track = find_track_by_guid(proj, track_guid);
+    if (!track)
+        return false;
+
+    *ref = {track, 0, fx_guid};
+    return locate_midisend_fx(*ref);
+}
+
+// projects set up before the GUIDs were stored only carry the P_EXT flag on the track
+bool resolve_legacy_midisend_ref(ReaProject *proj, MidisendTrackRef *ref)
 {
     char ext_data[6];
+    int track_count = CountTracks(proj);
+    for (int i = 0; i < track_count; i++) {
+        MediaTrack *track = GetTrack(proj, i);
+        if (!track ||
+            !GetSetMediaTrackInfo_String(track, "P_EXT:is_global_midisend", ext_data, false) ||
+            ext_data[0] != 't')
+            continue;
 
-    if (track &&
-        // check if the cached track pointer is still valid
-        ValidatePtr2(nullptr, track, "MediaTrack*") &&
-        // check if the track has the global midisend flag
-        GetSetMediaTrackInfo_String(track, "P_EXT:is_global_midisend", ext_data, false) &&
-        ext_data[0] == 't')
-    {
         // check if ReaControlMIDI exists in track FX chain
-        if (TrackFX_AddByName(track, "VST: ReaControlMIDI (Cockos)", false, 0) != -1) {
+        int fx_index = TrackFX_AddByName(track, MIDISEND_FX_NAME, false, 0);
+        if (fx_index != -1 && make_midisend_ref(track, fx_index, ref))
             return true;
-        } else {
-            char val_false[] = "false";
-            GetSetMediaTrackInfo_String(track, "P_EXT:is_global_midisend", val_false, true);
-            return false;
-        }
-    } else {
-        return false;
+
+        char val_false[] = "false";
+        GetSetMediaTrackInfo_String(track, "P_EXT:is_global_midisend", val_false, true);
     }
+    return false;
 }
 
-MediaTrack *get_or_create_global_midisend_track()
+// drops the entries of closed project tabs, before a new project can reuse one's address
+void prune_midisend_cache()
 {
-    static MediaTrack *send_track = nullptr;
+    if (midisend_cache.empty())
+        return;
 
-    if (is_valid_midisend_track(send_track))
-        return send_track;
+    std::vector<ReaProject *> open_projects; // a handful of tabs, a linear search beats a set
+    for (int i = 0; ReaProject *proj = EnumProjects(i, nullptr, 0); i++)
+        open_projects.push_back(proj);
+    for (auto it = midisend_cache.begin(); it != midisend_cache.end();) {
+        if (std::find(open_projects.begin(), open_projects.end(), it->first) != open_projects.end())
+            ++it;
+        else
+            it = midisend_cache.erase(it);
+    }
+}
 
-    int track_count = CountTracks(nullptr);
-    for (int i = 0; i < track_count; i++) {
-        MediaTrack *track = GetTrack(nullptr, i);
-        if (track && is_valid_midisend_track(track)) {
-            send_track = track;
-            return send_track;
+// the project's midisend track as set up before, without creating one
+bool find_global_midisend(ReaProject *proj, MidisendTrackRef *ref)
+{
+    prune_midisend_cache();
+
+    // fast path: cached pointer is still alive and its FX is where we left it
+    auto cached = midisend_cache.find(proj);
+    if (cached != midisend_cache.end()) {
+        if (ValidatePtr2(proj, cached->second.track, "MediaTrack*") &&
+            locate_midisend_fx(cached->second)) {
+            *ref = cached->second;
+            return true;
         }
+        midisend_cache.erase(cached);
     }
 
-    InsertTrackInProject(nullptr, track_count, false);
-    send_track = GetTrack(nullptr, track_count);
-    init_global_midisend_track(send_track);
+    if (resolve_stored_midisend_ref(proj, ref)) {
+        midisend_cache[proj] = *ref;
+        return true;
+    }
+
+    if (resolve_legacy_midisend_ref(proj, ref)) {
+        store_midisend_ref(proj, *ref);
+        return true;
+    }
+    return false;
+}
+
+MediaTrack *get_or_create_global_midisend_track(ReaProject *proj)
+{
+    MidisendTrackRef ref;
+    if (find_global_midisend(proj, &ref))
+        return ref.track;
+
+    int track_count = CountTracks(proj);
+    InsertTrackInProject(proj, track_count, false);
+    MediaTrack *send_track = GetTrack(proj, track_count);
+    request_refresh(REFRESH_ARRANGE | REFRESH_TRACK_LIST);
+    if (!send_track || !init_global_midisend_track(send_track, &ref))
+        return send_track;
 
+    store_midisend_ref(proj, ref);
     return send_track;
 }
 
-// create sends to all tracks except self and those already receiving
-void send_to_all_tracks(MediaTrack *send_track)
+// MIDI only, channel 4 -> 4, from the send track to every other track
+int update_midisend_routing(ReaProject *proj, MediaTrack *send_track)
 {
-    int track_count = CountTracks(nullptr);
-    for (int i = 0; i < track_count; i++) {
-        MediaTrack *track = GetTrack(nullptr, i);
-        if (!track)
+    RoutingSpec spec {};
+    spec.source = {TrackSelector::Kind::Track, send_track};
+    spec.destination = {TrackSelector::Kind::AllTracks};
+    spec.mapping.src_chan = -1; // no audio send
+    spec.mapping.midi_flags = 0x84;
+
+    RoutingDiff diff = apply_routing_spec(proj, spec, "Update Global MIDI Send");
+    return diff.created + diff.updated + diff.removed;
+}
+
+// kick detection: the track is read at a low rate, plenty for the kick's band, in stretches that
+// worker threads analyse independently; each stretch starts a little early so the filter and the
+// rise window are settled by the time its own hits count
+constexpr int TRIGGER_RATE = 12000;
+constexpr int TRIGGER_CHANNELS = 2;
+constexpr int TRIGGER_BLOCK_FRAMES = 1 << 15;
+constexpr double STRETCH_SECONDS = 30;
+constexpr double PREROLL_SECONDS = 1;
+
+constexpr const char *TRIGGER_ITEM_EXT = "P_EXT:ethlt_kick_triggers";
+constexpr int TRIGGER_CHANNEL = 3; // channel 4, the one the midisend routes
+constexpr int TRIGGER_PITCH = 36;
+
+struct Stretch
+{
+    double start, end;
+    std::vector<core::OnsetHit> hits; // in project time
+};
+
+// runs on a worker thread, reading only through its own accessor
+void detect_hits(AudioAccessor *accessor, double range_start, Stretch &stretch,
+                 std::vector<double> &buffer)
+{
+    const double from = std::max(range_start, stretch.start - PREROLL_SECONDS);
+    core::OnsetDetector detector(TRIGGER_RATE, TRIGGER_CHANNELS);
+    buffer.resize(static_cast<size_t>(TRIGGER_BLOCK_FRAMES) * TRIGGER_CHANNELS);
+
+    const long long total_frames =
+        static_cast<long long>(std::ceil((stretch.end - from) * TRIGGER_RATE));
+    for (long long done = 0; done < total_frames;) {
+        const int frames =
+            static_cast<int>(std::min<long long>(TRIGGER_BLOCK_FRAMES, total_frames - done));
+        const double time = from + static_cast<double>(done) / TRIGGER_RATE;
+        const int result = GetAudioAccessorSamples(accessor, TRIGGER_RATE, TRIGGER_CHANNELS, time,
+                                                   frames, buffer.data());
+        if (result < 0)
+            break;
+        if (result == 0)
+            std::fill_n(buffer.data(), static_cast<size_t>(frames) * TRIGGER_CHANNELS, 0.0);
+        detector.process(buffer.data(), frames);
+        done += frames;
+    }
+
+    for (const core::OnsetHit &hit : detector.hits()) {
+        const double time = from + hit.time;
+        if (time >= stretch.start && time < stretch.end)
+            stretch.hits.push_back({time, hit.level_db});
+    }
+}
+
+std::vector<core::OnsetHit> detect_track_hits(MediaTrack *track, double start, double end)
+{
+    std::vector<Stretch> stretches;
+    for (double t = start; t < end; t += STRETCH_SECONDS)
+        stretches.push_back({t, std::min(end, t + STRETCH_SECONDS), {}});
+
+    // one accessor per thread, created and destroyed here on the main thread
+    unsigned thread_count = std::max(1u, std::thread::hardware_concurrency());
+    thread_count = static_cast<unsigned>(std::min<size_t>(thread_count, stretches.size()));
+    std::vector<AudioAccessor *> accessors;
+    for (unsigned i = 0; i < thread_count; i++) {
+        if (AudioAccessor *accessor = CreateTrackAudioAccessor(track))
+            accessors.push_back(accessor);
+    }
+    if (accessors.empty())
+        return {};
+
+    std::atomic<size_t> next {0};
+    auto worker = [&](AudioAccessor *accessor) {
+        std::vector<double> buffer;
+        for (size_t i; (i = next.fetch_add(1)) < stretches.size();)
+            detect_hits(accessor, start, stretches[i], buffer);
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < accessors.size(); i++)
+        threads.emplace_back(worker, accessors[i]);
+    worker(accessors[0]);
+    for (std::thread &thread : threads)
+        thread.join();
+    for (AudioAccessor *accessor : accessors)
+        DestroyAudioAccessor(accessor);
+
+    std::vector<core::OnsetHit> hits;
+    for (const Stretch &stretch : stretches)
+        hits.insert(hits.end(), stretch.hits.begin(), stretch.hits.end());
+    core::enforce_min_interval(hits, core::OnsetParams {}.min_interval);
+    return hits;
+}
+
+// the packed event list MIDI_SetAllEvts takes: offset since the previous event, flags, length and
+// the message, ending with all-notes-off at the item end
+class EventWriter
+{
+public:
+    void add(int ppq, std::initializer_list<unsigned char> message)
+    {
+        const int32_t offset = ppq - last_ppq_, length = static_cast<int32_t>(message.size());
+        last_ppq_ = ppq;
+        append(&offset, sizeof(offset));
+        buffer_.push_back(0); // flags: unselected, unmuted
+        append(&length, sizeof(length));
+        buffer_.insert(buffer_.end(), message.begin(), message.end());
+    }
+
+    const std::string &buffer() const noexcept { return buffer_; }
+
+private:
+    void append(const void *data, size_t size)
+    {
+        buffer_.append(static_cast<const char *>(data), size);
+    }
+
+    std::string buffer_;
+    int last_ppq_ = 0;
+};
+
+// velocity follows the hit's level, the loudest hit at 127 and about 40 dB below it at 1; hits whose
+// note-on would fall before the item start or on/after its end are dropped, so every offset stays >= 0
+std::string trigger_events(MediaItem_Take *take, const std::vector<core::OnsetHit> &hits, double end)
+{
+    constexpr int NOTE_PPQ = 60;
+    const int end_ppq = static_cast<int>(std::lround(MIDI_GetPPQPosFromProjTime(take, end)));
+    std::vector<std::pair<int, double>> notes; // note-on ppq, level
+    for (const core::OnsetHit &hit : hits) {
+        const int on = static_cast<int>(std::lround(MIDI_GetPPQPosFromProjTime(take, hit.time)));
+        if (on >= 0 && on < end_ppq && (notes.empty() || on > notes.back().first))
+            notes.emplace_back(on, hit.level_db);
+    }
+    double loudest = -HUGE_VAL;
+    for (const auto &note : notes)
+        loudest = std::max(loudest, note.second);
+
+    EventWriter events;
+    for (size_t i = 0; i < notes.size(); i++) {
+        const int on = notes[i].first;
+        const int next_on = i + 1 < notes.size() ? notes[i + 1].first : end_ppq;
+        const int off = std::min({on + NOTE_PPQ, next_on, end_ppq});
+        const int velocity =
+            std::clamp(static_cast<int>(std::lround(127 + (notes[i].second - loudest) * 3)), 1, 127);
+        events.add(on, {static_cast<unsigned char>(0x90 | TRIGGER_CHANNEL), TRIGGER_PITCH,
+                        static_cast<unsigned char>(velocity)});
+        events.add(off, {static_cast<unsigned char>(0x80 | TRIGGER_CHANNEL), TRIGGER_PITCH, 0});
+    }
+    events.add(std::max(end_ppq, 0), {0xB0, 123, 0});
+    return events.buffer();
+}
+
+// trigger notes an earlier run left in [start, end): trigger items inside the range go as a whole,
+// items reaching out of it only lose the notes in it, so the hits detected around the range stay;
+// returns the number of items and notes deleted
+int delete_trigger_notes(MediaTrack *send_track, double start, double end)
+{
+    int deleted = 0;
+    for (int i = CountTrackMediaItems(send_track) - 1; i >= 0; i--) {
+        MediaItem *item = GetTrackMediaItem(send_track, i);
+        MediaItem_Take *take = item ? GetActiveTake(item) : nullptr;
+        char mark[4] = "";
+        if (!take || !GetSetMediaItemTakeInfo_String(take, TRIGGER_ITEM_EXT, mark, false) ||
+            mark[0] != '1')
+            continue;
+        const double pos = GetMediaItemInfo_Value(item, "D_POSITION");
+        const double len = GetMediaItemInfo_Value(item, "D_LENGTH");
+        if (!(pos < end && pos + len > start))
+            continue;
+        if (pos >= start && pos + len <= end) {
+            deleted += DeleteTrackMediaItem(send_track, item);
             continue;
+        }
+
+        int note_count = 0, kept = 0;
+        MIDI_CountEvts(take, &note_count, nullptr, nullptr);
+        for (int j = note_count - 1; j >= 0; j--) {
+            double start_ppq;
+            int channel, pitch;
+            if (!MIDI_GetNote(take, j, nullptr, nullptr, &start_ppq, nullptr, &channel, &pitch, nullptr))
+                continue;
+            const double time = MIDI_GetProjTimeFromPPQPos(take, start_ppq);
+            if (channel == TRIGGER_CHANNEL && pitch == TRIGGER_PITCH && time >= start && time < end &&
+                MIDI_DeleteNote(take, j))
+                deleted++;
+            else
+                kept++;
+        }
+        if (!kept)
+            deleted += DeleteTrackMediaItem(send_track, item);
+    }
+    return deleted;
+}
 
-        // skip if it's the source track
-        if (track == send_track)
+// the first selected track that is not a midisend track itself
+MediaTrack *trigger_source_track(ReaProject *proj)
+{
+    char ext_data[6];
+    const int count = CountSelectedTracks(proj);
+    for (int i = 0; i < count; i++) {
+        MediaTrack *track = GetSelectedTrack(proj, i);
+        if (track && !(GetSetMediaTrackInfo_String(track, "P_EXT:is_global_midisend", ext_data, false) &&
+                       ext_data[0] == 't'))
+            return track;
+    }
+    return nullptr;
+}
+
+// pump envelope: rendered into the ReaControlMIDI parameter envelope init_global_midisend_track
+// creates, one automation item per bar; bars with the same hits share a pool, so a song with a
+// handful of distinct bar patterns stores a handful of point lists
+constexpr const char *EXTSTATE_PUMP = "pump_envelope_params"; // "attack ms,release ms,depth %"
+constexpr int PUMP_PARAM = 3;
+constexpr double PATTERN_RESOLUTION = 1e-4; // seconds; hit offsets this close are the same pattern
+
+bool prompt_pump_shape(core::PumpShape &shape)
+{
+    char buf[64];
+    const char *last = GetExtState(EXTSTATE_SECTION, EXTSTATE_PUMP);
+    snprintf(buf, sizeof(buf), "%s", last && *last ? last : "5,150,60");
+    if (!GetUserInputs("Render Pump Envelope", 3, "Attack (ms):,Release (ms):,Depth (%):", buf,
+                       sizeof(buf)))
+        return false;
+
+    double attack_ms, release_ms, depth_pct;
+    const std::string_view input = buf;
+    const size_t first = input.find(','), second = input.find(',', first + 1);
+    if (first == std::string_view::npos || second == std::string_view::npos ||
+        !core::parse_double(input.substr(0, first), attack_ms) ||
+        !core::parse_double(input.substr(first + 1, second - first - 1), release_ms) ||
+        !core::parse_double(input.substr(second + 1), depth_pct) || !(attack_ms >= 0) ||
+        !(attack_ms <= 1000) || !(release_ms > 0) || !(release_ms <= 10000) || !(depth_pct >= 0) ||
+        !(depth_pct <= 100)) {
+        ShowMessageBox(
+            "Enter an attack of 0 to 1000 ms, a release of up to 10000 ms and a depth of 0 to 100%.",
+            "Render Pump Envelope", 0);
+        return false;
+    }
+    shape = {attack_ms / 1000, release_ms / 1000, depth_pct / 100};
+
+    snprintf(buf, sizeof(buf), "%g,%g,%g", attack_ms, release_ms, depth_pct);
+    SetExtState(EXTSTATE_SECTION, EXTSTATE_PUMP, buf, true);
+    return true;
+}
+
+// the trigger notes anywhere on the send track, in project time
+std::vector<double> trigger_times(MediaTrack *send_track)
+{
+    std::vector<double> times;
+    const int item_count = CountTrackMediaItems(send_track);
+    for (int i = 0; i < item_count; i++) {
+        MediaItem_Take *take = GetActiveTake(GetTrackMediaItem(send_track, i));
+        if (!take || !TakeIsMIDI(take))
             continue;
 
-        // check if the track already receives from send_track
-        int recv_count = GetTrackNumSends(track, -1); // -1 for receives
-        bool already_linked = false;
-        for (int j = 0; j < recv_count; j++) {
-            MediaTrack *src_track = reinterpret_cast<MediaTrack *>(
-                static_cast<uintptr_t>(GetTrackSendInfo_Value(track, -1, j, "P_SRCTRACK")));
-            if (src_track == send_track) {
-                already_linked = true;
-                break;
+        int note_count = 0;
+        MIDI_CountEvts(take, &note_count, nullptr, nullptr);
+        for (int j = 0; j < note_count; j++) {
+            bool muted;
+            double start_ppq;
+            int channel;
+            const bool got =
+                MIDI_GetNote(take, j, nullptr, &muted, &start_ppq, nullptr, &channel, nullptr, nullptr);
+            if (got && !muted && channel == TRIGGER_CHANNEL)
+                times.push_back(MIDI_GetProjTimeFromPPQPos(take, start_ppq));
+        }
+    }
+    std::sort(times.begin(), times.end());
+    times.erase(std::unique(times.begin(), times.end()), times.end());
+    return times;
+}
+
+// drops the automation items starting in [start, end) and the underlying points there; the API
+// cannot delete automation items, so this goes through the state chunk
+void clear_pump_range(TrackEnvelope *env, double start, double end)
+{
+    DeleteEnvelopePointRangeEx(env, -1, start, end);
+    if (!CountAutomationItems(env))
+        return;
+
+    std::vector<char> buf(1 << 16);
+    for (;;) {
+        if (!GetEnvelopeStateChunk(env, buf.data(), static_cast<int>(buf.size()), false))
+            return;
+        if (strlen(buf.data()) + 1 < buf.size())
+            break;
+        buf.resize(buf.size() * 4); // possibly cut off, try again with room to spare
+    }
+
+    std::string chunk;
+    bool removed = false;
+    for (std::string_view rest = buf.data(); !rest.empty();) {
+        const size_t eol = rest.find('\n');
+        const std::string_view line =
+            rest.substr(0, eol == std::string_view::npos ? rest.size() : eol + 1);
+        rest.remove_prefix(line.size());
+
+        // POOLEDENVINST <pool id> <position> <length> ...
+        std::string_view fields = line;
+        while (!fields.empty() && (fields.front() == ' ' || fields.front() == '\t'))
+            fields.remove_prefix(1);
+        if (fields.substr(0, 14) == "POOLEDENVINST ") {
+            double pool_id, position;
+            const char *p = fields.data() + 14, *last = fields.data() + fields.size();
+            if ((p = core::parse_double_prefix(p, last, pool_id)) &&
+                (p = core::parse_double_prefix(p + 1, last, position)) && position >= start - 1e-9 &&
+                position < end) {
+                removed = true;
+                continue;
             }
         }
-        if (already_linked)
+        chunk.append(line);
+    }
+    if (removed)
+        SetEnvelopeStateChunk(env, chunk.c_str(), false);
+}
+
+// every bar a hit or its release touches, in order
+std::vector<int> pump_bars(ReaProject *proj, const std::vector<double> &hits, double reach)
+{
+    std::vector<int> bars;
+    for (double hit : hits) {
+        int first, last;
+        TimeMap2_timeToBeats(proj, hit, &first, nullptr, nullptr, nullptr);
+        TimeMap2_timeToBeats(proj, hit + reach, &last, nullptr, nullptr, nullptr);
+        for (int bar = bars.empty() ? first : std::max(first, bars.back() + 1); bar <= last; bar++)
+            bars.push_back(bar);
+    }
+    return bars;
+}
+
+// returns the number of points written, which is what the pooling saves on
+int render_pump(ReaProject *proj, TrackEnvelope *env, const std::vector<int> &bars,
+                const std::vector<double> &hits, const core::PumpShape &shape, double param_min,
+                double param_max, int *item_count)
+{
+    const double reach = shape.attack + shape.release;
+    const int scaling_mode = GetEnvelopeScalingMode(env);
+
+    std::map<std::vector<int64_t>, int> pools; // bar length and hit offsets -> pool id
+    std::vector<double> offsets;
+    std::vector<core::PumpPoint> points;
+    int written = 0;
+    bool nosort = true; // the API takes a non-const pointer
+    for (int bar : bars) {
+        const int next_bar = bar + 1;
+        const double start = TimeMap2_beatsToTime(proj, 0, &bar);
+        const double length = TimeMap2_beatsToTime(proj, 0, &next_bar) - start;
+        if (!(length > 0))
+            continue;
+
+        std::vector<int64_t> pattern {std::llround(length / PATTERN_RESOLUTION)};
+        offsets.clear();
+        for (auto it = std::lower_bound(hits.begin(), hits.end(), start - reach);
+             it != hits.end() && *it < start + length; ++it) {
+            const int64_t offset = std::llround((*it - start) / PATTERN_RESOLUTION);
+            pattern.push_back(offset);
+            offsets.push_back(static_cast<double>(offset) * PATTERN_RESOLUTION);
+        }
+
+        if (auto pool = pools.find(pattern); pool != pools.end()) {
+            InsertAutomationItem(env, pool->second, start, length);
+            ++*item_count;
             continue;
+        }
 
-        // create new send
-        int send_idx = CreateTrackSend(send_track, track);
-        if (send_idx >= 0) {
-            ShowConsoleMsg(("Created send to track " + std::to_string(i) + "\n").c_str());
-            SetTrackSendInfo_Value(send_track, 0, send_idx, "I_SRCCHAN", -1); // no audio send
-            SetTrackSendInfo_Value(send_track, 0, send_idx, "I_MIDIFLAGS",
-                                   0x84); // send MIDI channel 4 -> 4
+        const int index = InsertAutomationItem(env, -1, start, length);
+        if (index < 0)
+            continue;
+        core::pump_points(shape, offsets, length, points);
+        for (const core::PumpPoint &point : points) {
+            const double value =
+                ScaleToEnvelopeMode(scaling_mode, param_min + (param_max - param_min) * point.value);
+            InsertEnvelopePointEx(env, index, start + point.time, value, point.shape, 0, false, &nosort);
         }
+        Envelope_SortPointsEx(env, index);
+        const double pool_id = GetSetAutomationItemInfo(env, index, "D_POOL_ID", 0, false);
+        pools.emplace(std::move(pattern), static_cast<int>(pool_id));
+        written += static_cast<int>(points.size());
+        ++*item_count;
     }
+    return written;
 }
 
 } // anonymous namespace
 
 void setup_global_midisend()
 {
-    MediaTrack *send_track = get_or_create_global_midisend_track();
+    ReaProject *proj = EnumProjects(-1, nullptr, 0);
+    MediaTrack *send_track = get_or_create_global_midisend_track(proj);
     if (!send_track)
         return;
 
-    send_to_all_tracks(send_track);
+    record_objects_touched(update_midisend_routing(proj, send_track));
+}
+
+void detect_kick_triggers()
+{
+    ReaProject *proj = EnumProjects(-1, nullptr, 0);
+    MediaTrack *source = trigger_source_track(proj);
+    if (!source) {
+        ShowMessageBox("Select the kick track to detect hits on.", "Detect Kick Hits", 0);
+        return;
+    }
+
+    // the time selection, or everything the track plays
+    double start, end;
+    GetSet_LoopTimeRange2(proj, false, false, &start, &end, false);
+    if (!(end > start)) {
+        AudioAccessor *accessor = CreateTrackAudioAccessor(source);
+        if (!accessor)
+            return;
+        start = GetAudioAccessorStartTime(accessor);
+        end = GetAudioAccessorEndTime(accessor);
+        DestroyAudioAccessor(accessor);
+        if (!(end > start))
+            return;
+    }
+
+    std::vector<core::OnsetHit> hits;
+    {
+        ETHLT_TRACE_SCOPE("detect_kick_triggers: analyse");
+        hits = detect_track_hits(source, start, end);
+    }
+
+    PreventUIRefresh(1);
+    Undo_BeginBlock2(proj);
+    MediaTrack *send_track = get_or_create_global_midisend_track(proj);
+    if (send_track && send_track != source) {
+        int touched = delete_trigger_notes(send_track, start, end);
+        if (MediaItem *item = CreateNewMIDIItemInProj(send_track, start, end, nullptr)) {
+            MediaItem_Take *take = GetActiveTake(item);
+            char name[] = "Kick Triggers", mark[] = "1";
+            GetSetMediaItemTakeInfo_String(take, "P_NAME", name, true);
+            GetSetMediaItemTakeInfo_String(take, TRIGGER_ITEM_EXT, mark, true);
+            const std::string events = trigger_events(take, hits, end);
+            MIDI_SetAllEvts(take, events.data(), static_cast<int>(events.size()));
+            touched += static_cast<int>(hits.size());
+        }
+        touched += update_midisend_routing(proj, send_track);
+        record_objects_touched(touched);
+        request_refresh(REFRESH_ARRANGE);
+        ETHLT_LOG(Info, "Detect Kick Hits: %zu hits between %.3f and %.3f s", hits.size(), start, end);
+    }
+    Undo_EndBlock2(proj, "Detect Kick Hits", UNDO_STATE_ITEMS | UNDO_STATE_TRACKCFG);
+    PreventUIRefresh(-1);
+}
+
+void render_pump_envelope()
+{
+    ReaProject *proj = EnumProjects(-1, nullptr, 0);
+    MidisendTrackRef ref;
+    if (!find_global_midisend(proj, &ref)) {
+        ShowMessageBox("Create the global MIDI send track and its trigger notes first.",
+                       "Render Pump Envelope", 0);
+        return;
+    }
+
+    const std::vector<double> hits = trigger_times(ref.track);
+    core::PumpShape shape;
+    if (hits.empty() || !prompt_pump_shape(shape))
+        return;
+
+    double param_min = 0, param_max = 1;
+    TrackFX_GetParam(ref.track, ref.fx_index, PUMP_PARAM, &param_min, &param_max);
+
+    PreventUIRefresh(1);
+    Undo_BeginBlock2(proj);
+    if (TrackEnvelope *env = GetFXEnvelope(ref.track, ref.fx_index, PUMP_PARAM, true)) {
+        ETHLT_TRACE_SCOPE("render_pump_envelope: write");
+        // the bars rendered, whole: an earlier render's items there start on the same bar lines
+        const std::vector<int> bars = pump_bars(proj, hits, shape.attack + shape.release);
+        int first_bar = bars.front(), end_bar = bars.back() + 1;
+        clear_pump_range(env, TimeMap2_beatsToTime(proj, 0, &first_bar),
+                         TimeMap2_beatsToTime(proj, 0, &end_bar));
+        int item_count = 0;
+        const int points = render_pump(proj, env, bars, hits, shape, param_min, param_max, &item_count);
+        record_objects_touched(points + item_count);
+        request_refresh(REFRESH_ARRANGE);
+        ETHLT_LOG(Debug, "Render Pump Envelope: %zu hits, %d automation items, %d points", hits.size(),
+                  item_count, points);
+    }
+    Undo_EndBlock2(proj, "Render Pump Envelope",
+                   UNDO_STATE_TRACKCFG | UNDO_STATE_FXENVELOPES | UNDO_STATE_POOLEDENVS);
+    PreventUIRefresh(-1);
 }
 
 } // namespace PROJECT_NAME
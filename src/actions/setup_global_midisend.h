@@ -8,4 +8,13 @@ namespace PROJECT_NAME
 
 void setup_global_midisend();
 
+// finds the kick hits on the first selected track, in the time selection or over the whole
+// track, and writes them as channel 4 notes into an item on the global midisend track, replacing
+// the trigger notes an earlier run left in that range
+void detect_kick_triggers();
+
+// renders a pump curve from those trigger notes into the ReaControlMIDI parameter envelope, as
+// pooled automation items, one per bar
+void render_pump_envelope();
+
 }
@@ -1,8 +1,12 @@
 #pragma once
 #include "config.h"
+#include "../action_stats.h"
+#include "../refresh.h"
+#include "../trace.h"
+#include "../core/velocity.h"
 #include "reaper_plugin_functions.h"
 #include <WDL/wdltypes.h> // might be unnecessary in future
-#include <string>
+#include <cstdio>
 
 namespace PROJECT_NAME
 {
@@ -10,20 +14,12 @@ namespace PROJECT_NAME
 namespace
 {
 
-template<bool increase, bool is_fine>
-inline int adjust_velocity(int vel) noexcept
-{
-    if (is_fine)
-        return increase ? std::min(0x7F, (((vel + 1) >> 2) + 1) << 2)
-                        : std::max(1, (((vel + 3) >> 2) - 1) << 2);
-    else
-        return increase ? std::min(0x7F, (((vel + 7) >> 4) + 1) << 4)
-                        : std::max(1, (((vel + 9) >> 4) - 1) << 4);
-}
+using core::adjust_velocity;
 
 template<bool increase, bool is_fine>
 int handle_midi_editor()
 {
+    ETHLT_TRACE_SCOPE("handle_midi_editor");
     HWND midi_editor = MIDIEditor_GetActive();
     if (!midi_editor)
         return 0;
@@ -54,8 +50,10 @@ int handle_midi_editor()
                      &NOSORT_TRUE);
     }
 
-    if (modified_notes_count)
+    if (modified_notes_count) {
+        ETHLT_TRACE_SCOPE("MIDI_Sort");
         MIDI_Sort(take);
+    }
 
     return modified_notes_count;
 }
@@ -70,13 +68,16 @@ void smart_midi_vel_adjust()
     PreventUIRefresh(1);
 
     if (int n = handle_midi_editor<increase, is_fine>()) {
-        Undo_OnStateChange(((is_fine ? (increase ? "Slightly increase " : "Slightly decrease ")
-                                     : (increase ? "Increase " : "Decrease ")) +
-                            std::to_string(n) + " MIDI " + (n == 1 ? "Note" : "Notes") + " Velocity")
-                               .c_str());
+        record_objects_touched(n);
+        ETHLT_TRACE_SCOPE("Undo_OnStateChange");
+        const char *verb = is_fine ? (increase ? "Slightly increase" : "Slightly decrease")
+                                   : (increase ? "Increase" : "Decrease");
+        char desc[64];
+        snprintf(desc, sizeof(desc), "%s %d MIDI %s Velocity", verb, n, n == 1 ? "Note" : "Notes");
+        Undo_OnStateChange(desc);
+        request_refresh(REFRESH_ARRANGE); // the item's notes in the arrange view
     }
     PreventUIRefresh(-1);
-    UpdateArrange();
 }
 
 } // namespace PROJECT_NAME
@@ -1,26 +1,11 @@
 #include "switch_triplet_grid.h"
+#include "../core/grid.h"
 #include <string>
 
 namespace PROJECT_NAME
 {
 
-namespace
-{
-
-static constexpr double switch_gridsize(const double gridsize) noexcept
-{
-    unsigned int denominator = (unsigned int)(1 / gridsize + 0.5);
-
-    if (denominator % 3) // not dividable by 3
-        if (denominator % 2)
-            return gridsize;
-        else
-            return 1. / (denominator / 2 * 3);
-    else
-        return 1. / (denominator / 3 * 2);
-}
-
-} // anonymous namespace
+using core::switch_gridsize;
 
 void switch_triplet_main_grid()
 {
@@ -1,4 +1,11 @@
 #include "test.h"
+#include "../envelope_index.h"
+#include "../log.h"
+#include "../core/envelope_info.h"
+
+// debug-only actions, compiled out of release builds
+#ifndef NDEBUG
+
 #include <climits>
 #include <cmath>
 #include <stdio.h>
@@ -7,86 +14,7 @@
 namespace PROJECT_NAME
 {
 
-constexpr inline int ipow(int base, int exp) noexcept
-{
-    int result = 1;
-    while (exp > 0) {
-        if (exp & 1)
-            result *= base;
-        base *= base;
-        exp >>= 1;
-    }
-    return result;
-}
-
-constexpr inline int extract_index(const char *str, const size_t len) noexcept
-{
-    int n = 0;
-    for (size_t i = 0; i < len; i++) {
-        char c = str[len - i - 1];
-        if (isdigit(c))
-            n += (c - '0') * ipow(10, i);
-        else
-            break;
-    }
-    return n;
-}
-
-constexpr inline bool extract_envelope_info(const char *str, const size_t len, char *env_type,
-                                            double *min_val, double *max_val, double *mid_val) noexcept
-{
-    if (len < 1 || str[0] != '<')
-        return false;
-
-    // find first space
-    const char *end = str;
-    while (*end && !isspace(*end))
-        end++;
-    if (!*end)
-        return false;
-
-    // assign env_type
-    size_t env_type_len = end - str - 1;
-    strncpy(env_type, str + 1, env_type_len);
-    env_type[env_type_len] = '\0';
-
-    if (strcmp(env_type, "PARMENV") == 0) {
-        char param_name[32] = {};
-        int parsed = sscanf(end + 1, "%s %lf %lf %lf", param_name, min_val, max_val, mid_val);
-        sprintf(env_type, "PARMENV %s", param_name);
-        return parsed == 4;
-
-    } else if (strcmp(env_type, "VOLENV") == 0 || strcmp(env_type, "VOLENV2") == 0 ||
-               strcmp(env_type, "AUXVOLENV") == 0)
-    {
-
-        *min_val = 0.0;
-        *max_val = 2.0;
-        *mid_val = 1.0;
-        return true;
-
-    } else if (strcmp(env_type, "PANENV") == 0 || strcmp(env_type, "PANENV2") == 0 ||
-               strcmp(env_type, "AUXPANENV") == 0 || strcmp(env_type, "WIDTHENV") == 0 ||
-               strcmp(env_type, "WIDTHENV2") == 0)
-    {
-
-        *min_val = -1.0;
-        *max_val = 1.0;
-        *mid_val = 0.0;
-        return true;
-
-    } else if (strcmp(env_type, "MUTEENV") == 0 || strcmp(env_type, "VOLENV3") == 0 ||
-               strcmp(env_type, "AUXMUTEENV") == 0)
-    {
-
-        *min_val = 0.0;
-        *max_val = 1.0;
-        *mid_val = 0.5;
-        return true;
-    }
-
-    return false;
-}
+using core::extract_index;
 
 bool active_midi_editor()
 {
@@ -104,7 +32,7 @@ void print_element_under_point(int x, int y)
 {
     std::string buf;
     buf = "Cursor position: " + std::to_string(x) + ", " + std::to_string(y) + "\n";
-    ShowConsoleMsg(buf.c_str());
+    ETHLT_LOG(Debug, "%s", buf.c_str());
 
     char info[256];
     GetMousePosition(&x, &y);
@@ -115,23 +43,21 @@ void print_element_under_point(int x, int y)
         buf = "GetThingFromPoint: " + std::string(trackName) + " " + std::string(info) + "\n";
         if (strncmp(info, "envelope", 8) == 0 || strncmp(info, "envcp", 5) == 0) {
             int envidx = extract_index(info, strlen(info));
-            ShowConsoleMsg(("envidx: " + std::to_string(envidx) + "\n").c_str());
+            ETHLT_LOG(Debug, "%s", ("envidx: " + std::to_string(envidx) + "\n").c_str());
             TrackEnvelope *env = GetTrackEnvelope(track, envidx);
             if (env) {
                 char env_state_chunk[256];
                 if (GetEnvelopeStateChunk(env, env_state_chunk, sizeof(env_state_chunk), true)) {
-                    // char env_type[32];
-                    // double min_val, max_val, mid_val;
-                    // if (extract_envelope_info(env_state_chunk, strlen(env_state_chunk), env_type, &min_val, &max_val, &mid_val)) {
-                    //     ShowConsoleMsg(("env_type: " + std::string(env_type) + "\n").c_str());
-                    //     ShowConsoleMsg(("min_val: " + std::to_string(min_val) + "\n").c_str());
-                    //     ShowConsoleMsg(("max_val: " + std::to_string(max_val) + "\n").c_str());
-                    //     ShowConsoleMsg(("mid_val: " + std::to_string(mid_val) + "\n").c_str());
-                    // } else {
-                    //     ShowConsoleMsg("Failed to extract envelope info:\n");
-                    //     ShowConsoleMsg(env_state_chunk);
-                    // }
-                    ShowConsoleMsg(env_state_chunk);
+                    core::EnvelopeInfo env_info;
+                    char env_type[64];
+                    const bool known = core::parse_envelope_info(env_state_chunk, env_info);
+                    core::format_envelope_type(env_info, env_type, sizeof(env_type));
+                    if (known)
+                        ETHLT_LOG(Debug, "env_type: %s\nmin_val: %f\nmax_val: %f\nmid_val: %f\n", env_type,
+                                  env_info.min_val, env_info.max_val, env_info.mid_val);
+                    else
+                        ETHLT_LOG(Debug, "Failed to extract envelope info:\n");
+                    ETHLT_LOG(Debug, "%s", env_state_chunk);
                 }
                 int point_count = CountEnvelopePoints(env);
                 for (int i = 0; i < point_count; i++) {
@@ -142,7 +68,7 @@ void print_element_under_point(int x, int y)
                     {
                         int scale_mode = GetEnvelopeScalingMode(env);
                         double scaled_val = ScaleFromEnvelopeMode(scale_mode, point_val);
-                        ShowConsoleMsg(("selected point: " + std::to_string(i) + " " +
+                        ETHLT_LOG(Debug, "%s", ("selected point: " + std::to_string(i) + " " +
                                         std::to_string(point_val) + " " + std::to_string(scale_mode) +
                                         " " + std::to_string(scaled_val) + "\n")
                                            .c_str());
@@ -153,7 +79,7 @@ void print_element_under_point(int x, int y)
     } else {
         buf = "GetThingFromPoint: non-track " + std::string(info) + "\n";
     }
-    ShowConsoleMsg(buf.empty() ? "unknown\n" : buf.c_str());
+    ETHLT_LOG(Debug, "%s", buf.empty() ? "unknown\n" : buf.c_str());
 
     int info_out = 0;
     track = GetTrackFromPoint(x, y, &info_out);
@@ -164,7 +90,7 @@ void print_element_under_point(int x, int y)
     } else {
         buf = "GetTrackFromPoint: non-track " + std::to_string(info_out) + "\n";
     }
-    ShowConsoleMsg(buf.empty() ? "unknown\n" : buf.c_str());
+    ETHLT_LOG(Debug, "%s", buf.empty() ? "unknown\n" : buf.c_str());
 
     MediaItem_Take *take = nullptr;
     MediaItem *item = GetItemFromPoint(x, y, true, &take);
@@ -195,38 +121,38 @@ void print_element_under_point(int x, int y)
     } else {
         buf += "TakeInfo: None\n";
     }
-    ShowConsoleMsg(buf.empty() ? "unknown\n" : buf.c_str());
+    ETHLT_LOG(Debug, "%s", buf.empty() ? "unknown\n" : buf.c_str());
 }
 
 void show_all_envelope_points()
 {
-    int track_count = CountTracks(nullptr);
-    for (int i = 0; i < track_count; i++) {
-        MediaTrack *track = GetTrack(nullptr, i);
-        if (!track)
-            continue;
-        ShowConsoleMsg(("track: " + std::to_string(i) + "\n").c_str());
-
-
-        int env_count = CountTrackEnvelopes(track);
-        for (int j = 0; j < env_count; j++) {
-            TrackEnvelope *env = GetTrackEnvelope(track, j);
-            if (!env)
+    MediaTrack *last_track = nullptr;
+    int track_idx = -1, env_idx = 0;
+    for (const EnvelopeRecord &record : envelope_inventory()) {
+        if (record.track != last_track) {
+            last_track = record.track;
+            track_idx = static_cast<int>(GetMediaTrackInfo_Value(record.track, "IP_TRACKNUMBER")) - 1;
+            env_idx = 0;
+            ETHLT_LOG(Debug, "%s", ("track: " + std::to_string(track_idx) + "\n").c_str());
+        }
+        ETHLT_LOG(Debug, "%s",
+                  ("  " + std::string(record.owner == EnvelopeOwner::Take ? "take envelope: " : "envelope: ") +
+                   std::to_string(env_idx++) + "\n")
+                      .c_str());
+
+        TrackEnvelope *env = record.envelope;
+        const int point_count = CountEnvelopePoints(env);
+        for (int k = 0; k < point_count; k++) {
+            int shape;
+            double time, value, tension;
+            bool selected;
+            if (!GetEnvelopePointEx(env, -1, k, &time, &value, &shape, &tension, &selected))
                 continue;
-            ShowConsoleMsg(("  envelope: " + std::to_string(j) + "\n").c_str());
-
-            int point_count = CountEnvelopePoints(env);
-            for (int k = 0; k < point_count; k++) {
-                int shape;
-                double time, value, tension;
-                bool selected;
-                GetEnvelopePoint(env, k, &time, &value, &shape, &tension, &selected);
-                ShowConsoleMsg((std::to_string(k) + " " + precise_numstr<double, 10>(time) + " " +
-                                precise_numstr<double, 2>(value) + " " + std::to_string(shape) + " " +
-                                precise_numstr<double, 2>(tension) + " " +
-                                (selected ? "[selected] " : "") + "\n")
-                                   .c_str());
-            }
+            ETHLT_LOG(Debug, "%s", (std::to_string(k) + " " + precise_numstr<double, 10>(time) + " " +
+                            precise_numstr<double, 2>(value) + " " + std::to_string(shape) + " " +
+                            precise_numstr<double, 2>(tension) + " " +
+                            (selected ? "[selected] " : "") + "\n")
+                               .c_str());
         }
     }
 }
@@ -241,7 +167,7 @@ void show_all_midi_items()
     if (!take)
         return;
 
-    ShowConsoleMsg("All MIDI items:\n");
+    ETHLT_LOG(Debug, "%s", "All MIDI items:\n");
 
     int note_count;
     MIDI_CountEvts(take, &note_count, nullptr, nullptr);
@@ -256,7 +182,7 @@ void show_all_midi_items()
         if (!result)
             continue;
 
-        ShowConsoleMsg(("note_index: " + std::to_string(i) + (selected ? "[selected] " : "") +
+        ETHLT_LOG(Debug, "%s", ("note_index: " + std::to_string(i) + (selected ? "[selected] " : "") +
                         "\n  note_pos: " + std::to_string(note_start_pos) + " - " +
                         std::to_string(note_end_pos) + "\n  channel: " + std::to_string(channel) +
                         " pitch: " + std::to_string(pitch) + " velocity: " + std::to_string(velocity) +
@@ -275,7 +201,7 @@ void show_selected_midi_items()
     if (!take)
         return;
 
-    ShowConsoleMsg("Selected MIDI items:\n");
+    ETHLT_LOG(Debug, "%s", "Selected MIDI items:\n");
 
     int note_count;
     MIDI_CountEvts(take, &note_count, nullptr, nullptr);
@@ -292,7 +218,7 @@ void show_selected_midi_items()
         if (!selected)
             continue;
 
-        ShowConsoleMsg(
+        ETHLT_LOG(Debug, "%s",
             ("note_index: " + std::to_string(i) + "\n  note_pos: " + std::to_string(note_start_pos) +
              " - " + std::to_string(note_end_pos) + "\n  channel: " + std::to_string(channel) +
              " pitch: " + std::to_string(pitch) + " velocity: " + std::to_string(velocity) + "\n")
@@ -305,7 +231,7 @@ void show_thing_under_point()
     POINT pt;
     GetCursorPos(&pt);
     if (active_midi_editor())
-        ShowConsoleMsg("MIDI Editor is active\n");
+        ETHLT_LOG(Debug, "%s", "MIDI Editor is active\n");
     print_element_under_point(pt.x, pt.y);
 }
 
@@ -320,7 +246,7 @@ void show_track_ui()
 
 #define SHOW_TRACK_UI_RECT(element)                                                                     \
     GetSetMediaTrackInfo_String(track, "P_UI_RECT:" #element, buf, false);                              \
-    ShowConsoleMsg((#element ": \t" + std::string(buf) + "\n").c_str());
+    ETHLT_LOG(Debug, "%s", (#element ": \t" + std::string(buf) + "\n").c_str());
 
     SHOW_TRACK_UI_RECT(tcp.size)
     SHOW_TRACK_UI_RECT(tcp.trackidx)
@@ -350,7 +276,7 @@ void show_track_ui()
 void test()
 {
     int cursor_context = GetCursorContext2(true);
-    ShowConsoleMsg(("GetCursorContext2: " + std::to_string(cursor_context) + " " +
+    ETHLT_LOG(Debug, "%s", ("GetCursorContext2: " + std::to_string(cursor_context) + " " +
                     (cursor_context == 0   ? "track panels"
                      : cursor_context == 1 ? "items"
                      : cursor_context == 2 ? "envelopes"
@@ -375,16 +301,18 @@ void test()
                 GetEnvelopePoint(env, i, nullptr, nullptr, nullptr, nullptr, &selected);
                 selected_count += selected;
             }
-            ShowConsoleMsg(
+            ETHLT_LOG(Debug, "%s",
                 ("Selected envelope: " + std::string(buf) + " " +
                  (selected_count ? ("(" + std::to_string(selected_count) + " points selected)") : "") +
                  "\n")
                     .c_str());
         } else {
-            ShowConsoleMsg("No selected envelope\n");
+            ETHLT_LOG(Debug, "%s", "No selected envelope\n");
         }
         break;
     }
 }
 
 } // namespace PROJECT_NAME
+
+#endif // NDEBUG
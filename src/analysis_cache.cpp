@@ -0,0 +1,235 @@
+#include "analysis_cache.h"
+#include "log.h"
+#include "mapped_file.h"
+#include "core/fnv.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+// bump when the analysis changes, so results of the old one are never found again
+constexpr uint64_t ANALYSIS_VERSION = 1;
+constexpr size_t MAX_ENTRIES = 100000; // about 4 MB
+
+constexpr char FILE_MAGIC[8] = {'E', 'T', 'H', 'L', 'T', 'A', 'C', '1'};
+
+// on-disk layout, native byte order; every platform REAPER runs on is little-endian
+struct FileHeader
+{
+    char magic[8];
+    uint32_t record_size;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+struct Record
+{
+    uint64_t key;
+    int64_t last_used; // seconds since the epoch
+    double peak, rms, lufs;
+};
+
+static_assert(sizeof(FileHeader) == 24 && sizeof(Record) == 40, "cache file layout must not have padding");
+
+bool loaded = false;
+MappedFile file;
+const char *records = nullptr; // into the mapping, sorted by key
+size_t record_count = 0;
+
+// hits and new results since the last save, with their new last use time
+std::unordered_map<uint64_t, Record> recent;
+
+fs::path cache_path()
+{
+    return fs::u8path(GetResourcePath()) / "ethlt_analysis_cache.bin";
+}
+
+Record record_at(size_t i)
+{
+    Record record;
+    memcpy(&record, records + i * sizeof(Record), sizeof(Record));
+    return record;
+}
+
+void map_cache_file()
+{
+    records = nullptr;
+    record_count = 0;
+    file = MappedFile(cache_path());
+    const std::string_view data = file.view();
+    if (data.size() < sizeof(FileHeader))
+        return;
+
+    FileHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+    if (memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.record_size != sizeof(Record) ||
+        header.count > (data.size() - sizeof(header)) / sizeof(Record)) {
+        ETHLT_LOG(Warn, "Ignoring an unreadable analysis cache file");
+        return;
+    }
+    records = data.data() + sizeof(header);
+    record_count = static_cast<size_t>(header.count);
+}
+
+void ensure_loaded()
+{
+    if (!loaded) {
+        loaded = true;
+        map_cache_file();
+    }
+}
+
+bool find_record(uint64_t key, Record &record)
+{
+    size_t lo = 0, hi = record_count;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        record = record_at(mid);
+        if (record.key == key)
+            return true;
+        if (record.key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return false;
+}
+
+} // anonymous namespace
+
+bool analysis_key(MediaItem_Take *take, double length, int rate, int channels, uint64_t &key)
+{
+    if (TakeFX_GetCount(take) > 0 || CountTakeEnvelopes(take) > 0)
+        return false;
+
+    char path[4096];
+    path[0] = '\0';
+    GetMediaSourceFileName(GetMediaItemTake_Source(take), path, sizeof(path));
+    if (!path[0])
+        return false;
+
+    std::error_code ec;
+    const fs::path source = fs::u8path(path);
+    const uintmax_t size = fs::file_size(source, ec);
+    if (ec)
+        return false;
+    const auto mtime = fs::last_write_time(source, ec);
+    if (ec)
+        return false;
+
+    // doubles are mixed in bitwise; equal settings give equal bits
+    auto mix_double = [&](double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        core::fnv_mix(key, bits);
+    };
+
+    key = core::FNV_OFFSET_BASIS;
+    core::fnv_mix(key, ANALYSIS_VERSION);
+    core::fnv_mix(key, std::string_view(path));
+    core::fnv_mix(key, static_cast<uint64_t>(size));
+    core::fnv_mix(key, static_cast<uint64_t>(mtime.time_since_epoch().count()));
+    mix_double(GetMediaItemTakeInfo_Value(take, "D_STARTOFFS"));
+    mix_double(length);
+    mix_double(GetMediaItemTakeInfo_Value(take, "D_PLAYRATE"));
+    mix_double(GetMediaItemTakeInfo_Value(take, "D_VOL"));
+    mix_double(GetMediaItemTakeInfo_Value(take, "D_PAN"));
+    mix_double(GetMediaItemTakeInfo_Value(take, "I_CHANMODE"));
+    core::fnv_mix(key, static_cast<uint64_t>(rate));
+    core::fnv_mix(key, static_cast<uint64_t>(channels));
+    return true;
+}
+
+bool find_analysis(uint64_t key, AnalysisResult &result)
+{
+    ensure_loaded();
+
+    Record record;
+    if (auto it = recent.find(key); it != recent.end()) {
+        record = it->second;
+    } else if (find_record(key, record)) {
+        record.last_used = static_cast<int64_t>(time(nullptr));
+        recent.emplace(key, record);
+    } else {
+        return false;
+    }
+    result = {record.peak, record.rms, record.lufs};
+    return true;
+}
+
+void store_analysis(uint64_t key, const AnalysisResult &result)
+{
+    ensure_loaded();
+    recent[key] = {key, static_cast<int64_t>(time(nullptr)), result.peak, result.rms, result.lufs};
+}
+
+void save_analysis_cache()
+{
+    if (recent.empty())
+        return;
+
+    // merge: what was looked up or added replaces its old record
+    std::vector<Record> merged;
+    merged.reserve(record_count + recent.size());
+    for (size_t i = 0; i < record_count; i++) {
+        const Record record = record_at(i);
+        if (!recent.count(record.key))
+            merged.push_back(record);
+    }
+    for (const auto &[key, record] : recent)
+        merged.push_back(record);
+
+    if (merged.size() > MAX_ENTRIES) {
+        std::nth_element(merged.begin(), merged.begin() + MAX_ENTRIES, merged.end(),
+                         [](const Record &a, const Record &b) { return a.last_used > b.last_used; });
+        merged.resize(MAX_ENTRIES);
+    }
+    std::sort(merged.begin(), merged.end(), [](const Record &a, const Record &b) { return a.key < b.key; });
+
+    FileHeader header {};
+    memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.record_size = sizeof(Record);
+    header.count = merged.size();
+
+    // written aside and renamed over, so a crash never leaves a torn cache; the old mapping has to
+    // go first, Windows does not replace a mapped file
+    const fs::path path = cache_path();
+    fs::path partial = path;
+    partial += ".partial";
+    FILE *out = open_file(partial, "wb");
+    bool ok = out && fwrite(&header, sizeof(header), 1, out) == 1 &&
+              fwrite(merged.data(), sizeof(Record), merged.size(), out) == merged.size();
+    if (out)
+        ok = fclose(out) == 0 && ok;
+
+    file = MappedFile();
+    records = nullptr;
+    record_count = 0;
+
+    std::error_code ec;
+    if (ok)
+        fs::rename(partial, path, ec);
+    if (!ok || ec) {
+        fs::remove(partial, ec);
+        ETHLT_LOG(Warn, "Could not write the analysis cache to %s", path.string().c_str());
+    } else {
+        recent.clear();
+    }
+    map_cache_file();
+}
+
+} // namespace PROJECT_NAME
@@ -0,0 +1,33 @@
+#pragma once
+#include "config.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+#include <reaper_plugin_functions.h>
+#include <cstdint>
+
+namespace PROJECT_NAME
+{
+
+// what the audio analysis found for one take's audio
+struct AnalysisResult
+{
+    double peak; // linear sample peak
+    double rms;  // linear, over all channels
+    double lufs; // integrated loudness, -HUGE_VAL for silence
+};
+
+// Key of a take's audio as the analysis reads it: the source file's path, size and modification
+// time, the part of it the take plays and the take settings that change the samples. False for
+// takes whose audio is not determined by those alone, e.g. with take FX or take envelopes, or
+// with a source that is not a file on disk. Main thread only, like everything below.
+bool analysis_key(MediaItem_Take *take, double length, int rate, int channels, uint64_t &key);
+
+// Persistent, content-addressed store of analysis results, so items sharing a source are analysed
+// once across sessions. It lives in the REAPER resource path as fixed-size records sorted by key
+// and is binary searched through a memory mapping; lookups and new results since the last save
+// live in memory. save_analysis_cache() writes both back, dropping the least recently used
+// entries beyond the size limit.
+bool find_analysis(uint64_t key, AnalysisResult &result);
+void store_analysis(uint64_t key, const AnalysisResult &result);
+void save_analysis_cache();
+
+} // namespace PROJECT_NAME
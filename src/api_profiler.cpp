@@ -0,0 +1,182 @@
+#include "api_profiler.h"
+
+#ifdef ETHLT_API_PROFILING
+
+#include "action_stats.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+#include <reaper_plugin_functions.h>
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+std::vector<const char *> api_names;
+std::vector<ApiCallStats> api_stats; // (action_count + 1) rows of api_names.size() columns
+int api_stats_action_count {0};
+
+inline ApiCallStats &stats_slot(int action_index, int api_index) noexcept
+{
+    return api_stats[(action_index + 1) * api_names.size() + api_index];
+}
+
+class ApiCallTimer
+{
+public:
+    explicit ApiCallTimer(int api_index) noexcept
+        : api_index_(api_index), start_(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ApiCallTimer()
+    {
+        const auto end = std::chrono::steady_clock::now();
+        int action_index = running_action_index();
+        if (action_index >= api_stats_action_count)
+            action_index = -1;
+
+        ApiCallStats &stats = stats_slot(action_index, api_index_);
+        stats.calls++;
+        stats.total_us += std::chrono::duration<double, std::micro>(end - start_).count();
+    }
+
+private:
+    int api_index_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// one thunk per bound function pointer: slot is the address of the REAPERAPI pointer variable
+template<auto *slot, typename Fn = std::remove_reference_t<decltype(*slot)>>
+struct ApiThunk;
+
+template<auto *slot, typename R, typename... Args>
+struct ApiThunk<slot, R (*)(Args...)>
+{
+    static inline R (*original)(Args...) = nullptr;
+    static inline int api_index = -1;
+
+    static R call(Args... args)
+    {
+        ApiCallTimer timer {api_index};
+        return original(args...);
+    }
+
+    static void install(const char *name)
+    {
+        if (!*slot || original) // not provided by this REAPER version, or already wrapped
+            return;
+        original = *slot;
+        api_index = static_cast<int>(api_names.size());
+        api_names.push_back(name);
+        *slot = &call;
+    }
+};
+
+#define ETHLT_INTERPOSE(fn) ApiThunk<&fn>::install(#fn)
+
+} // anonymous namespace
+
+void install_api_profiler(int action_count)
+{
+    // the API surface the toolkit's actions use
+    ETHLT_INTERPOSE(CountAutomationItems);
+    ETHLT_INTERPOSE(CountEnvelopePointsEx);
+    ETHLT_INTERPOSE(GetEnvelopePointEx);
+    ETHLT_INTERPOSE(SetEnvelopePointEx);
+    ETHLT_INTERPOSE(DeleteEnvelopePointEx);
+    ETHLT_INTERPOSE(Envelope_SortPoints);
+    ETHLT_INTERPOSE(Envelope_SortPointsEx);
+    ETHLT_INTERPOSE(InsertEnvelopePointEx);
+    ETHLT_INTERPOSE(InsertAutomationItem);
+    ETHLT_INTERPOSE(GetEnvelopeStateChunk);
+    ETHLT_INTERPOSE(GetEnvelopeScalingMode);
+    ETHLT_INTERPOSE(ScaleFromEnvelopeMode);
+    ETHLT_INTERPOSE(ScaleToEnvelopeMode);
+    ETHLT_INTERPOSE(GetSelectedEnvelope);
+    ETHLT_INTERPOSE(CountTrackEnvelopes);
+    ETHLT_INTERPOSE(GetTrackEnvelope);
+    ETHLT_INTERPOSE(CountTakeEnvelopes);
+    ETHLT_INTERPOSE(GetTakeEnvelope);
+
+    ETHLT_INTERPOSE(CountTracks);
+    ETHLT_INTERPOSE(GetTrack);
+    ETHLT_INTERPOSE(IsTrackSelected);
+    ETHLT_INTERPOSE(SetTrackSelected);
+    ETHLT_INTERPOSE(GetMediaTrackInfo_Value);
+    ETHLT_INTERPOSE(SetMediaTrackInfo_Value);
+    ETHLT_INTERPOSE(GetSetMediaTrackInfo_String);
+    ETHLT_INTERPOSE(GetTrackGUID);
+    ETHLT_INTERPOSE(ValidatePtr2);
+
+    ETHLT_INTERPOSE(CountMediaItems);
+    ETHLT_INTERPOSE(GetMediaItem);
+    ETHLT_INTERPOSE(CountTrackMediaItems);
+    ETHLT_INTERPOSE(GetTrackMediaItem);
+    ETHLT_INTERPOSE(IsMediaItemSelected);
+    ETHLT_INTERPOSE(GetMediaItemInfo_Value);
+    ETHLT_INTERPOSE(SetMediaItemInfo_Value);
+    ETHLT_INTERPOSE(CountTakes);
+    ETHLT_INTERPOSE(GetMediaItemTake);
+    ETHLT_INTERPOSE(AddMediaItemToTrack);
+    ETHLT_INTERPOSE(GetItemStateChunk);
+    ETHLT_INTERPOSE(SetItemStateChunk);
+
+    ETHLT_INTERPOSE(MIDI_CountEvts);
+    ETHLT_INTERPOSE(MIDI_GetNote);
+    ETHLT_INTERPOSE(MIDI_SetNote);
+    ETHLT_INTERPOSE(MIDI_InsertNote);
+    ETHLT_INTERPOSE(MIDI_DeleteNote);
+    ETHLT_INTERPOSE(MIDI_Sort);
+
+    ETHLT_INTERPOSE(GetTrackNumSends);
+    ETHLT_INTERPOSE(GetTrackSendInfo_Value);
+    ETHLT_INTERPOSE(SetTrackSendInfo_Value);
+    ETHLT_INTERPOSE(GetSetTrackSendInfo);
+    ETHLT_INTERPOSE(CreateTrackSend);
+    ETHLT_INTERPOSE(RemoveTrackSend);
+    ETHLT_INTERPOSE(TrackFX_AddByName);
+    ETHLT_INTERPOSE(TrackFX_GetFXGUID);
+
+    ETHLT_INTERPOSE(GetMousePosition);
+    ETHLT_INTERPOSE(GetItemFromPoint);
+    ETHLT_INTERPOSE(GetThingFromPoint);
+    ETHLT_INTERPOSE(GetCursorContext2);
+    ETHLT_INTERPOSE(Main_OnCommand);
+    ETHLT_INTERPOSE(Undo_OnStateChange);
+    ETHLT_INTERPOSE(PreventUIRefresh);
+    ETHLT_INTERPOSE(UpdateArrange);
+
+    api_stats_action_count = action_count;
+    api_stats.assign((action_count + 1) * api_names.size(), ApiCallStats {});
+}
+
+#undef ETHLT_INTERPOSE
+
+void reset_api_profile()
+{
+    std::fill(api_stats.begin(), api_stats.end(), ApiCallStats {});
+}
+
+int profiled_api_count()
+{
+    return static_cast<int>(api_names.size());
+}
+
+const char *profiled_api_name(int api_index)
+{
+    return api_names[api_index];
+}
+
+const ApiCallStats &profiled_api_stats(int action_index, int api_index)
+{
+    return stats_slot(action_index, api_index);
+}
+
+} // namespace PROJECT_NAME
+
+#endif // ETHLT_API_PROFILING
@@ -0,0 +1,32 @@
+#pragma once
+#include "config.h"
+
+// Optional profiling build (ETHLT_API_PROFILING=ON): the REAPER API function pointers the toolkit
+// calls are swapped for thin thunks that count and time every call, attributed to the action
+// running at the time. Counters are plain, so only calls from the main thread are meaningful.
+#ifdef ETHLT_API_PROFILING
+
+#include <cstdint>
+
+namespace PROJECT_NAME
+{
+
+struct ApiCallStats
+{
+    uint64_t calls;
+    double total_us;
+};
+
+// wraps the bound API pointers, call once after REAPERAPI_LoadAPI and before any action runs
+void install_api_profiler(int action_count);
+void reset_api_profile();
+
+int profiled_api_count();
+const char *profiled_api_name(int api_index);
+
+// action_index -1 holds calls made outside of any action, e.g. from timers or ReaScript exports
+const ApiCallStats &profiled_api_stats(int action_index, int api_index);
+
+} // namespace PROJECT_NAME
+
+#endif // ETHLT_API_PROFILING
@@ -0,0 +1,89 @@
+#include "arena.h"
+#include "action_stats.h"
+#include <algorithm>
+#include <cassert>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+constexpr size_t MIN_BLOCK_SIZE = 64 * 1024;
+constexpr size_t MAX_RETAINED_SIZE = 64 * 1024 * 1024; // an outlier invocation does not pin more
+
+int arena_depth = 0;
+
+inline size_t align_up(size_t offset, size_t align) noexcept
+{
+    return (offset + align - 1) & ~(align - 1);
+}
+
+} // anonymous namespace
+
+void *Arena::allocate(size_t size, size_t align)
+{
+    assert(align && (align & (align - 1)) == 0 && align <= alignof(std::max_align_t));
+    size = std::max<size_t>(size, 1);
+
+    // blocks come from new[] (uninitialised, aligned for anything), so aligning offsets aligns addresses
+    for (; current_ < blocks_.size(); current_++, offset_ = 0) {
+        const size_t start = align_up(offset_, align);
+        if (start + size <= blocks_[current_].size) {
+            used_ += start + size - offset_;
+            offset_ = start + size;
+            return blocks_[current_].data.get() + start;
+        }
+    }
+
+    const size_t last = blocks_.empty() ? 0 : blocks_.back().size;
+    const size_t block_size = std::max({MIN_BLOCK_SIZE, last * 2, size});
+    blocks_.push_back({std::unique_ptr<std::byte[]>(new std::byte[block_size]), block_size});
+    current_ = blocks_.size() - 1;
+    offset_ = size;
+    used_ += size;
+    return blocks_.back().data.get();
+}
+
+void Arena::reset()
+{
+    if (blocks_.size() > 1 || (!blocks_.empty() && blocks_.front().size > MAX_RETAINED_SIZE)) {
+        // one block with room for all of it and some slack for different padding next time
+        const size_t block_size =
+            std::min(MAX_RETAINED_SIZE, std::max(MIN_BLOCK_SIZE, used_ + used_ / 4));
+        blocks_.clear();
+        blocks_.push_back({std::unique_ptr<std::byte[]>(new std::byte[block_size]), block_size});
+    }
+    current_ = 0;
+    offset_ = 0;
+    used_ = 0;
+}
+
+size_t Arena::capacity() const noexcept
+{
+    size_t total = 0;
+    for (const Block &block : blocks_)
+        total += block.size;
+    return total;
+}
+
+Arena &action_arena()
+{
+    static Arena arena;
+    return arena;
+}
+
+ScopedActionArena::ScopedActionArena() noexcept
+{
+    arena_depth++;
+}
+
+ScopedActionArena::~ScopedActionArena()
+{
+    if (--arena_depth > 0)
+        return;
+    record_arena_high_water(action_arena().used());
+    action_arena().reset();
+}
+
+} // namespace PROJECT_NAME
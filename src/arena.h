@@ -0,0 +1,100 @@
+#pragma once
+#include "config.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+// Monotonic arena for the temporaries of one action invocation: allocation bumps a pointer,
+// deallocation does nothing and reset() releases everything at once. The memory stays for the
+// next invocation; when one needed more than the first block, reset() replaces the blocks by a
+// single one that fits it all, so pressing the same action again allocates nothing from the heap.
+class Arena
+{
+public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // align at most alignof(std::max_align_t)
+    void *allocate(size_t size, size_t align);
+    void reset();
+
+    size_t used() const noexcept { return used_; } // bytes since the last reset, padding included
+    size_t capacity() const noexcept;
+
+private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    size_t current_ = 0; // block being filled
+    size_t offset_ = 0;  // into it
+    size_t used_ = 0;
+};
+
+// std allocator over an arena, for containers of per-invocation temporaries
+template<typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena &arena) noexcept : arena_(&arena) {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) noexcept : arena_(other.arena())
+    {
+    }
+
+    T *allocate(size_t n) { return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T *, size_t) noexcept {} // freed with the whole arena
+
+    Arena *arena() const noexcept { return arena_; }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U> &other) const noexcept
+    {
+        return arena_ == other.arena();
+    }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const noexcept
+    {
+        return arena_ != other.arena();
+    }
+
+private:
+    Arena *arena_;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// the arena of the running action; main thread only
+Arena &action_arena();
+
+template<typename T>
+ArenaVector<T> make_action_vector()
+{
+    return ArenaVector<T>(ArenaAllocator<T>(action_arena()));
+}
+
+// Wraps an action invocation: when the outermost one ends, its arena use is recorded as the
+// action's high-water mark (see action_stats.h) and the arena is reset. Nested invocations, like
+// an action run from a pipeline, share the outer one's arena.
+class ScopedActionArena
+{
+public:
+    ScopedActionArena() noexcept;
+    ~ScopedActionArena();
+
+    ScopedActionArena(const ScopedActionArena &) = delete;
+    ScopedActionArena &operator=(const ScopedActionArena &) = delete;
+};
+
+} // namespace PROJECT_NAME
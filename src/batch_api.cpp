@@ -0,0 +1,378 @@
+#include "batch_api.h"
+#include "refresh.h"
+#include "core/envelope_info.h"
+#include "core/velocity.h"
+#include "core/volume.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+// calls fn(std::bool_constant<increase>, std::bool_constant<fine>) so the per-value loop is
+// instantiated once per step direction instead of branching on every value
+template<typename Fn>
+auto with_step(bool increase, bool fine, Fn &&fn)
+{
+    if (increase)
+        return fine ? fn(std::true_type {}, std::true_type {}) : fn(std::true_type {}, std::false_type {});
+    return fine ? fn(std::false_type {}, std::true_type {}) : fn(std::false_type {}, std::false_type {});
+}
+
+inline const char *skip_space(const char *p) noexcept
+{
+    while (isspace(static_cast<unsigned char>(*p)))
+        p++;
+    return p;
+}
+
+inline bool at_token_end(const char *p) noexcept
+{
+    return !*p || isspace(static_cast<unsigned char>(*p));
+}
+
+bool parse_doubles(const char *packed, std::vector<double> &out)
+{
+    if (!packed)
+        return false;
+    for (const char *p = skip_space(packed); *p; p = skip_space(p)) {
+        char *end;
+        const double value = strtod(p, &end);
+        if (end == p || !at_token_end(end))
+            return false;
+        out.push_back(value);
+        p = end;
+    }
+    return true;
+}
+
+bool parse_ints(const char *packed, std::vector<int> &out)
+{
+    if (!packed)
+        return false;
+    for (const char *p = skip_space(packed); *p; p = skip_space(p)) {
+        char *end;
+        const long value = strtol(p, &end, 10);
+        if (end == p || !at_token_end(end) || value < INT_MIN || value > INT_MAX)
+            return false;
+        out.push_back(static_cast<int>(value));
+        p = end;
+    }
+    return true;
+}
+
+// indices in ascending order with duplicates removed, so an index listed twice is stepped once
+bool parse_indices(const char *packed, std::vector<int> &out)
+{
+    if (!parse_ints(packed, out))
+        return false;
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return true;
+}
+
+void append_double(std::string &packed, double value)
+{
+    char buf[32];
+    const int len = snprintf(buf, sizeof(buf), packed.empty() ? "%.17g" : " %.17g", value);
+    packed.append(buf, len);
+}
+
+void append_int(std::string &packed, int value)
+{
+    char buf[16];
+    const int len = snprintf(buf, sizeof(buf), packed.empty() ? "%d" : " %d", value);
+    packed.append(buf, len);
+}
+
+// NeedBig output buffers may be grown through realloc_cmd_ptr when called from ReaScript; the
+// bridge then takes the new size as the string length, so no terminator is written in that case
+void write_result(const std::string &packed, char *buf, int buf_sz)
+{
+    if (!buf || buf_sz <= 0)
+        return;
+
+    const int size = static_cast<int>(packed.size());
+    if (size < buf_sz) {
+        memcpy(buf, packed.c_str(), size + 1);
+    } else if (realloc_cmd_ptr(&buf, &buf_sz, size)) {
+        memcpy(buf, packed.data(), size);
+    } else { // native callers get a truncated, terminated result
+        memcpy(buf, packed.data(), buf_sz - 1);
+        buf[buf_sz - 1] = '\0';
+    }
+}
+
+// the same undo point names as the smart volume adjust actions, e.g. "Increase 2 Tracks Volume"
+template<size_t N>
+void undo_description(char (&desc)[N], bool increase, bool fine, int count, const char *singular,
+                      const char *plural, const char *what)
+{
+    const char *verb = fine ? (increase ? "Slightly increase" : "Slightly decrease")
+                            : (increase ? "Increase" : "Decrease");
+    snprintf(desc, N, "%s %d %s %s", verb, count, count == 1 ? singular : plural, what);
+}
+
+} // anonymous namespace
+
+const char *defstring_StepVolumes =
+    "int" // return type
+    "\0"  // delimiter ('separator')
+    // input parameter types
+    "const char*,bool,bool,char*,int"
+    "\0"
+    // input parameter names
+    "volumes,increase,fine,resultOutNeedBig,resultOutNeedBig_sz"
+    "\0"
+    "Steps each of the whitespace-separated volume factors (1 = 0 dB) one notch up or down on the "
+    "toolkit's volume lattice (3 dB steps, or 0.5 dB when fine) and returns them packed the same way.\n"
+    "Returns the number of values, or -1 if the input is not a list of numbers.\n";
+
+int StepVolumes(const char *volumes, bool increase, bool fine, char *resultOutNeedBig, int resultOutNeedBig_sz)
+{
+    std::vector<double> values;
+    if (!parse_doubles(volumes, values))
+        return -1;
+
+    std::string packed;
+    packed.reserve(values.size() * 24);
+    with_step(increase, fine, [&](auto inc, auto is_fine) {
+        for (double value : values)
+            append_double(packed, core::adjust_volume<decltype(inc)::value, decltype(is_fine)::value>(value));
+        return 0;
+    });
+
+    write_result(packed, resultOutNeedBig, resultOutNeedBig_sz);
+    return static_cast<int>(values.size());
+}
+
+const char *defstring_StepVelocities =
+    "int" // return type
+    "\0"  // delimiter ('separator')
+    // input parameter types
+    "const char*,bool,bool,char*,int"
+    "\0"
+    // input parameter names
+    "velocities,increase,fine,resultOutNeedBig,resultOutNeedBig_sz"
+    "\0"
+    "Steps each of the whitespace-separated MIDI velocities to the next multiple of 16 (or 4 when "
+    "fine), clamped to 1-127, and returns them packed the same way.\n"
+    "Returns the number of values, or -1 if the input is not a list of integers.\n";
+
+int StepVelocities(const char *velocities, bool increase, bool fine, char *resultOutNeedBig,
+                   int resultOutNeedBig_sz)
+{
+    std::vector<int> values;
+    if (!parse_ints(velocities, values))
+        return -1;
+
+    std::string packed;
+    packed.reserve(values.size() * 4);
+    with_step(increase, fine, [&](auto inc, auto is_fine) {
+        for (int value : values)
+            append_int(packed, core::adjust_velocity<decltype(inc)::value, decltype(is_fine)::value>(value));
+        return 0;
+    });
+
+    write_result(packed, resultOutNeedBig, resultOutNeedBig_sz);
+    return static_cast<int>(values.size());
+}
+
+const char *defstring_StepEnvelopeValues =
+    "int" // return type
+    "\0"  // delimiter ('separator')
+    // input parameter types
+    "TrackEnvelope*,const char*,bool,bool,char*,int"
+    "\0"
+    // input parameter names
+    "envelope,values,increase,fine,resultOutNeedBig,resultOutNeedBig_sz"
+    "\0"
+    "Steps the whitespace-separated raw point values of the given envelope the same way the smart "
+    "volume adjust actions step its selected points, honouring the envelope's range and scaling "
+    "mode, and returns them packed the same way.\n"
+    "Returns the number of values, or -1 if the envelope type is not supported or the input is not "
+    "a list of numbers.\n";
+
+int StepEnvelopeValues(TrackEnvelope *envelope, const char *values, bool increase, bool fine,
+                       char *resultOutNeedBig, int resultOutNeedBig_sz)
+{
+    if (!envelope || !ValidatePtr2(nullptr, envelope, "TrackEnvelope*"))
+        return -1;
+
+    std::vector<double> points;
+    if (!parse_doubles(values, points))
+        return -1;
+
+    char env_state_chunk[256];
+    if (!GetEnvelopeStateChunk(envelope, env_state_chunk, sizeof(env_state_chunk), true))
+        return -1;
+
+    core::EnvelopeInfo info;
+    if (!core::parse_envelope_info(env_state_chunk, info))
+        return -1;
+
+    const int scale_mode = GetEnvelopeScalingMode(envelope);
+    std::string packed;
+    packed.reserve(points.size() * 24);
+    with_step(increase, fine, [&](auto inc, auto is_fine) {
+        for (double value : points) {
+            double scaled = ScaleFromEnvelopeMode(scale_mode, value);
+            scaled = core::adjust_envpt_value<decltype(inc)::value, decltype(is_fine)::value>(
+                scaled, info.min_val, info.max_val, info.mid_val, info.adjust_type);
+            append_double(packed, ScaleToEnvelopeMode(scale_mode, scaled));
+        }
+        return 0;
+    });
+
+    write_result(packed, resultOutNeedBig, resultOutNeedBig_sz);
+    return static_cast<int>(points.size());
+}
+
+const char *defstring_AdjustTracksVolume =
+    "int" // return type
+    "\0"  // delimiter ('separator')
+    // input parameter types
+    "const char*,bool,bool"
+    "\0"
+    // input parameter names
+    "trackIndices,increase,fine"
+    "\0"
+    "Steps the volume of the tracks at the whitespace-separated 0-based indices of the current "
+    "project, each once even if listed twice, as one undo point.\n"
+    "Returns the number of tracks modified, or -1 if the input is not a list of integers.\n";
+
+int AdjustTracksVolume(const char *trackIndices, bool increase, bool fine)
+{
+    std::vector<int> indices;
+    if (!parse_indices(trackIndices, indices))
+        return -1;
+
+    PreventUIRefresh(1);
+    const int modified = with_step(increase, fine, [&](auto inc, auto is_fine) {
+        int n = 0;
+        for (int index : indices) {
+            MediaTrack *track = GetTrack(nullptr, index);
+            if (!track)
+                continue;
+            const double vol = GetMediaTrackInfo_Value(track, "D_VOL");
+            SetMediaTrackInfo_Value(
+                track, "D_VOL", core::adjust_volume<decltype(inc)::value, decltype(is_fine)::value>(vol));
+            n++;
+        }
+        return n;
+    });
+
+    if (modified) {
+        char desc[64];
+        undo_description(desc, increase, fine, modified, "Track", "Tracks", "Volume");
+        Undo_OnStateChange(desc);
+        request_refresh(REFRESH_TRACK_CONTROLS);
+    }
+    PreventUIRefresh(-1);
+    return modified;
+}
+
+const char *defstring_AdjustItemsVolume =
+    "int" // return type
+    "\0"  // delimiter ('separator')
+    // input parameter types
+    "const char*,bool,bool"
+    "\0"
+    // input parameter names
+    "itemIndices,increase,fine"
+    "\0"
+    "Steps the volume of the media items at the whitespace-separated 0-based indices of the "
+    "current project (as in GetMediaItem), each once even if listed twice, as one undo point.\n"
+    "Returns the number of items modified, or -1 if the input is not a list of integers.\n";
+
+int AdjustItemsVolume(const char *itemIndices, bool increase, bool fine)
+{
+    std::vector<int> indices;
+    if (!parse_indices(itemIndices, indices))
+        return -1;
+
+    PreventUIRefresh(1);
+    const int modified = with_step(increase, fine, [&](auto inc, auto is_fine) {
+        int n = 0;
+        for (int index : indices) {
+            MediaItem *item = GetMediaItem(nullptr, index);
+            if (!item)
+                continue;
+            const double vol = GetMediaItemInfo_Value(item, "D_VOL");
+            SetMediaItemInfo_Value(
+                item, "D_VOL", core::adjust_volume<decltype(inc)::value, decltype(is_fine)::value>(vol));
+            n++;
+        }
+        return n;
+    });
+
+    if (modified) {
+        char desc[64];
+        undo_description(desc, increase, fine, modified, "Item", "Items", "Volume");
+        Undo_OnStateChange(desc);
+        request_refresh(REFRESH_ARRANGE);
+    }
+    PreventUIRefresh(-1);
+    return modified;
+}
+
+const char *defstring_AdjustNotesVelocity =
+    "int" // return type
+    "\0"  // delimiter ('separator')
+    // input parameter types
+    "MediaItem_Take*,const char*,bool,bool"
+    "\0"
+    // input parameter names
+    "take,noteIndices,increase,fine"
+    "\0"
+    "Steps the velocity of the notes at the whitespace-separated indices (as in MIDI_GetNote) of "
+    "the take, each once even if listed twice, as one undo point.\n"
+    "Returns the number of notes modified, or -1 if the take is invalid or the input is not a list "
+    "of integers.\n";
+
+int AdjustNotesVelocity(MediaItem_Take *take, const char *noteIndices, bool increase, bool fine)
+{
+    if (!take || !ValidatePtr2(nullptr, take, "MediaItem_Take*"))
+        return -1;
+
+    std::vector<int> indices;
+    if (!parse_indices(noteIndices, indices))
+        return -1;
+
+    static constexpr bool NOSORT_TRUE = true;
+    PreventUIRefresh(1);
+    const int modified = with_step(increase, fine, [&](auto inc, auto is_fine) {
+        int n = 0;
+        for (int index : indices) {
+            int vel;
+            if (!MIDI_GetNote(take, index, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &vel))
+                continue;
+            const int new_vel = core::adjust_velocity<decltype(inc)::value, decltype(is_fine)::value>(vel);
+            MIDI_SetNote(take, index, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &new_vel, &NOSORT_TRUE);
+            n++;
+        }
+        return n;
+    });
+
+    if (modified) {
+        MIDI_Sort(take);
+        char desc[64];
+        undo_description(desc, increase, fine, modified, "MIDI Note", "MIDI Notes", "Velocity");
+        Undo_OnStateChange(desc);
+        request_refresh(REFRESH_ARRANGE);
+    }
+    PreventUIRefresh(-1);
+    return modified;
+}
+
+} // namespace PROJECT_NAME
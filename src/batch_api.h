@@ -0,0 +1,31 @@
+#pragma once
+#include "config.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+#include <reaper_plugin_functions.h>
+
+// Batch ReaScript exports: each call applies the toolkit's step logic to a whole set of values or
+// objects, so scripts pay the script bridge overhead once instead of once per object. Sets are
+// passed as whitespace-separated numbers ("0.5 1 1.25") and results come back packed the same way.
+namespace PROJECT_NAME
+{
+
+extern const char *defstring_StepVolumes;
+extern const char *defstring_StepVelocities;
+extern const char *defstring_StepEnvelopeValues;
+extern const char *defstring_AdjustTracksVolume;
+extern const char *defstring_AdjustItemsVolume;
+extern const char *defstring_AdjustNotesVelocity;
+
+// pure transforms, return the number of values or -1 if the input is not a list of numbers
+int StepVolumes(const char *volumes, bool increase, bool fine, char *resultOutNeedBig, int resultOutNeedBig_sz);
+int StepVelocities(const char *velocities, bool increase, bool fine, char *resultOutNeedBig,
+                   int resultOutNeedBig_sz);
+int StepEnvelopeValues(TrackEnvelope *envelope, const char *values, bool increase, bool fine,
+                       char *resultOutNeedBig, int resultOutNeedBig_sz);
+
+// in-place edits with a single undo point, return the number of objects modified
+int AdjustTracksVolume(const char *trackIndices, bool increase, bool fine);
+int AdjustItemsVolume(const char *itemIndices, bool increase, bool fine);
+int AdjustNotesVelocity(MediaItem_Take *take, const char *noteIndices, bool increase, bool fine);
+
+} // namespace PROJECT_NAME
@@ -0,0 +1,47 @@
+#pragma once
+#include "config.h"
+#include <cmath>
+#include <cstdint>
+
+// Tolerant comparison of envelope point times and values, which REAPER round-trips with a few
+// bits of noise
+namespace PROJECT_NAME::core
+{
+
+union reinterpretable_double
+{
+    double d;
+    uint64_t i;
+
+    struct
+    {
+        uint64_t value : 63;
+        uint64_t sign : 1;
+    } bitfield;
+
+    constexpr reinterpretable_double(double value) noexcept : d(value) { }
+
+    // constexpr reinterpretable_double(uint64_t value) noexcept : i(value) { }
+};
+
+constexpr int IGNORE_LAST_N_BITS = 34;
+
+constexpr inline bool almost_equal(reinterpretable_double a, reinterpretable_double b) noexcept
+{
+    if (a.d == b.d)
+        return true;
+
+    if (std::isfinite(a.d) && std::isfinite(b.d)) {
+        const uint64_t diff = (a.bitfield.sign == b.bitfield.sign)
+                                  ? (a.bitfield.value > b.bitfield.value)
+                                        ? (a.bitfield.value - b.bitfield.value)
+                                        : (b.bitfield.value - a.bitfield.value)
+                                  : (a.bitfield.value + b.bitfield.value);
+
+        return !(diff >> IGNORE_LAST_N_BITS);
+    }
+
+    return false;
+}
+
+} // namespace PROJECT_NAME::core
@@ -0,0 +1,92 @@
+#pragma once
+#include "config.h"
+#include "almost_equal.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// The point reduction rules of Clean Envelope Points, on a plain list of points so the plugin
+// action and the offline .RPP cleaner share one implementation
+namespace PROJECT_NAME::core
+{
+
+namespace detail
+{
+
+// drops the flagged points, keeping the order of the rest
+template<typename Points, typename Flags>
+size_t erase_flagged(Points &points, Flags &flags)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < points.size(); i++) {
+        if (!flags[i]) {
+            if (kept != i)
+                points[kept] = std::move(points[i]);
+            kept++;
+        }
+    }
+    const size_t erased = points.size() - kept;
+    points.resize(kept);
+    flags.assign(kept, 0);
+    return erased;
+}
+
+} // namespace detail
+
+// Removes redundant points from one point list (an envelope or one automation item), sorted by
+// time. Point needs `time`, `value` and `shape` members; any other members travel along, so
+// callers can tell which of their points survived. Each pass looks at the list as the previous
+// pass left it, matching the order the plugin used to delete points through the API in.
+// The scratch flags come from the list's own allocator. Returns the number of points removed.
+template<typename Point, typename Alloc>
+size_t clean_envelope_points(std::vector<Point, Alloc> &points)
+{
+    using FlagAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<char>;
+    size_t erased = 0;
+    std::vector<char, FlagAlloc> flags(points.size(), 0, FlagAlloc(points.get_allocator()));
+
+    // consecutive points with the same time: keep the first and last of each run
+    for (size_t j = 2; j < points.size(); j++) {
+        if (almost_equal(points[j - 1].time, points[j].time) &&
+            almost_equal(points[j - 2].time, points[j - 1].time))
+            flags[j - 1] = 1;
+    }
+    erased += detail::erase_flagged(points, flags);
+
+    // overlapping points
+    for (size_t j = 1; j < points.size(); j++) {
+        if (almost_equal(points[j - 1].time, points[j].time) && points[j - 1].value == points[j].value)
+            flags[j - 1] = 1;
+    }
+    erased += detail::erase_flagged(points, flags);
+
+    // consecutive points with the same value: keep the first and last of each run
+    for (size_t j = 2; j < points.size(); j++) {
+        if (points[j - 1].value == points[j].value && points[j - 2].value == points[j - 1].value)
+            flags[j - 1] = 1;
+    }
+    erased += detail::erase_flagged(points, flags);
+
+    // square points that repeat the previous square point's value
+    for (size_t j = 1; j < points.size(); j++) {
+        if (points[j - 1].shape == 1 && points[j].shape == 1 && points[j - 1].value == points[j].value)
+            flags[j] = 1;
+    }
+    erased += detail::erase_flagged(points, flags);
+
+    // a tail point repeating the value before it
+    if (points.size() >= 2 && points[points.size() - 2].value == points.back().value) {
+        points.pop_back();
+        erased++;
+    }
+
+    // a head point repeated by the value after it
+    if (points.size() >= 2 && points[0].value == points[1].value) {
+        points.erase(points.begin());
+        erased++;
+    }
+
+    return erased;
+}
+
+} // namespace PROJECT_NAME::core
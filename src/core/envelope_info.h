@@ -0,0 +1,237 @@
+#pragma once
+#include "config.h"
+#include "parse_number.h"
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+// Parsing of envelope state chunk headers and of the envelope index in GetThingFromPoint info
+// strings
+namespace PROJECT_NAME::core
+{
+
+constexpr inline int ipow(int base, int exp) noexcept {
+    int result = 1;
+    while (exp > 0) {
+        if (exp & 1) result *= base;
+        base *= base;
+        exp >>= 1;
+    }
+    return result;
+}
+
+inline int extract_index(const char* str, const size_t len) noexcept
+{
+    int n = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = str[len - i - 1];
+        if (isdigit(c))
+            n += (c - '0') * ipow(10, i);
+        else break;
+    }
+    return n;
+}
+
+// adjust_type: 0: normal
+//              1: volume
+//              2: mute {0, 1}
+struct EnvelopeInfo
+{
+    std::string_view tag;   // VOLENV2, PARMENV, ...; a slice of the chunk
+    std::string_view param; // PARMENV only: the parameter, e.g. "3" or "0:delta"
+    double min_val, max_val, mid_val;
+    int value_count; // how many of min/max/mid were set, left as they were otherwise
+    int adjust_type;
+};
+
+namespace detail
+{
+
+struct EnvelopeTagRange
+{
+    std::string_view tag;
+    double min_val, max_val, mid_val;
+    int adjust_type; // -1 for PARMENV, whose range is in the chunk
+};
+
+constexpr EnvelopeTagRange ENVELOPE_TAGS[] = {
+    {"VOLENV", 0.0, 2.0, 1.0, 1},     {"VOLENV2", 0.0, 2.0, 1.0, 1},    {"AUXVOLENV", 0.0, 2.0, 1.0, 1},
+    {"PANENV", -1.0, 1.0, 0.0, 0},    {"PANENV2", -1.0, 1.0, 0.0, 0},   {"AUXPANENV", -1.0, 1.0, 0.0, 0},
+    {"WIDTHENV", -1.0, 1.0, 0.0, 0},  {"WIDTHENV2", -1.0, 1.0, 0.0, 0}, {"MUTEENV", 0.0, 1.0, 0.5, 2},
+    {"AUXMUTEENV", 0.0, 1.0, 0.5, 2}, {"VOLENV3", 0.0, 1.0, 0.5, 1},    {"PARMENV", 0.0, 0.0, 0.0, -1},
+};
+constexpr int ENVELOPE_TAG_COUNT = sizeof(ENVELOPE_TAGS) / sizeof(ENVELOPE_TAGS[0]);
+constexpr uint32_t TAG_TABLE_SIZE = 32;
+
+// the length and three characters are enough to tell the known tags apart
+constexpr uint32_t tag_hash(std::string_view tag, uint32_t seed) noexcept
+{
+    uint32_t h = seed ^ static_cast<uint32_t>(tag.size());
+    h = h * 31 + static_cast<unsigned char>(tag[0]);
+    h = h * 31 + static_cast<unsigned char>(tag[tag.size() / 2]);
+    h = h * 31 + static_cast<unsigned char>(tag[tag.size() - 1]);
+    return (h ^ (h >> 7)) % TAG_TABLE_SIZE;
+}
+
+constexpr bool is_perfect_seed(uint32_t seed) noexcept
+{
+    bool used[TAG_TABLE_SIZE] = {};
+    for (const EnvelopeTagRange &entry : ENVELOPE_TAGS) {
+        const uint32_t slot = tag_hash(entry.tag, seed);
+        if (used[slot])
+            return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t find_perfect_seed() noexcept
+{
+    uint32_t seed = 0;
+    while (!is_perfect_seed(seed))
+        seed++;
+    return seed;
+}
+
+constexpr uint32_t TAG_SEED = find_perfect_seed();
+
+struct TagSlots
+{
+    int8_t index[TAG_TABLE_SIZE];
+};
+
+constexpr TagSlots make_tag_slots() noexcept
+{
+    TagSlots slots {};
+    for (int8_t &index : slots.index)
+        index = -1;
+    for (int i = 0; i < ENVELOPE_TAG_COUNT; i++)
+        slots.index[tag_hash(ENVELOPE_TAGS[i].tag, TAG_SEED)] = static_cast<int8_t>(i);
+    return slots;
+}
+
+constexpr TagSlots TAG_SLOTS = make_tag_slots();
+
+constexpr const EnvelopeTagRange *find_envelope_tag(std::string_view tag) noexcept
+{
+    if (tag.empty())
+        return nullptr;
+    const int index = TAG_SLOTS.index[tag_hash(tag, TAG_SEED)];
+    return index >= 0 && ENVELOPE_TAGS[index].tag == tag ? &ENVELOPE_TAGS[index] : nullptr;
+}
+
+static_assert(find_envelope_tag("VOLENV2") == &ENVELOPE_TAGS[1] && !find_envelope_tag("PITCHENV"),
+              "envelope tag table is not a perfect hash");
+
+inline bool is_space(char c) noexcept
+{
+    return isspace(static_cast<unsigned char>(c));
+}
+
+// the next whitespace-separated token, crossing line breaks like scanf does
+inline std::string_view next_token(std::string_view &rest) noexcept
+{
+    size_t begin = 0;
+    while (begin < rest.size() && is_space(rest[begin]))
+        begin++;
+    size_t end = begin;
+    while (end < rest.size() && !is_space(rest[end]))
+        end++;
+    const std::string_view token = rest.substr(begin, end - begin);
+    rest.remove_prefix(end);
+    return token;
+}
+
+// scanf("%lf") on the rest: skips whitespace and takes the longest number prefix
+inline bool next_double(std::string_view &rest, double &value) noexcept
+{
+    size_t begin = 0;
+    while (begin < rest.size() && is_space(rest[begin]))
+        begin++;
+    const char *last = rest.data() + rest.size();
+    const char *end = parse_double_prefix(rest.data() + begin, last, value);
+    if (!end)
+        return false;
+    rest.remove_prefix(end - rest.data());
+    return true;
+}
+
+} // namespace detail
+
+// Identifies an envelope from the header of its state chunk ("<VOLENV2\n...", or
+// "<PARMENV 3 0 1 0.5\n..." for FX parameters) and fills in its value range. Only looks at the
+// given slice, allocates nothing and never reads past a truncated chunk. Returns false for
+// envelopes it has no range for; tag, param and the values read so far are filled in regardless.
+inline bool parse_envelope_info(std::string_view chunk, EnvelopeInfo &info) noexcept
+{
+    info.tag = info.param = {};
+    info.value_count = 0;
+    if (chunk.empty() || chunk[0] != '<')
+        return false;
+
+    size_t tag_end = 1;
+    while (tag_end < chunk.size() && !detail::is_space(chunk[tag_end]))
+        tag_end++;
+    if (tag_end == chunk.size())
+        return false;
+    info.tag = chunk.substr(1, tag_end - 1);
+
+    const detail::EnvelopeTagRange *known = detail::find_envelope_tag(info.tag);
+    if (!known)
+        return false;
+    if (known->adjust_type >= 0) {
+        info.min_val = known->min_val;
+        info.max_val = known->max_val;
+        info.mid_val = known->mid_val;
+        info.value_count = 3;
+        info.adjust_type = known->adjust_type;
+        return true;
+    }
+
+    // PARMENV <param> <min> <max> <mid>
+    std::string_view rest = chunk.substr(tag_end + 1);
+    info.param = detail::next_token(rest);
+    if (info.param.empty())
+        return false;
+    double *values[] = {&info.min_val, &info.max_val, &info.mid_val};
+    while (info.value_count < 3 && detail::next_double(rest, *values[info.value_count]))
+        info.value_count++;
+
+    // toggle-like parameters step straight to on or off
+    const size_t defshape = chunk.find("DEFSHAPE", tag_end + 1);
+    if (defshape != std::string_view::npos) {
+        std::string_view shape_rest = chunk.substr(defshape + 8);
+        double shape;
+        if (detail::next_double(shape_rest, shape) && shape == 1) {
+            info.adjust_type = 2;
+            return true;
+        }
+    }
+
+    if (info.value_count < 3)
+        return false;
+
+    // for factorial volume parameters in build-in plugins
+    if ((info.min_val == 0 && info.max_val == 2 && info.mid_val == 1) ||
+        (info.min_val == 0 && info.max_val == 1 && info.mid_val == 0.25) ||
+        (info.min_val == 0 && info.max_val == 4 && info.mid_val == 1))
+        info.adjust_type = 1;
+    else
+        info.adjust_type = 0;
+    return true;
+}
+
+// "VOLENV2", or "PARMENV 3" for FX parameters, for undo point names; truncated to fit
+inline void format_envelope_type(const EnvelopeInfo &info, char *buf, size_t size) noexcept
+{
+    if (!size)
+        return;
+    if (info.param.empty())
+        snprintf(buf, size, "%.*s", static_cast<int>(info.tag.size()), info.tag.data());
+    else
+        snprintf(buf, size, "%.*s %.*s", static_cast<int>(info.tag.size()), info.tag.data(),
+                 static_cast<int>(info.param.size()), info.param.data());
+}
+
+} // namespace PROJECT_NAME::core
@@ -0,0 +1,33 @@
+#pragma once
+#include "config.h"
+#include <cstdint>
+#include <string_view>
+
+// 64-bit FNV-1a, for cheap fingerprints of plain values (not collision-resistant against crafted
+// input, which none of the toolkit's keys are)
+namespace PROJECT_NAME::core
+{
+
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+// mixes in all 8 bytes of the value, least significant first
+inline void fnv_mix(uint64_t &hash, uint64_t value) noexcept
+{
+    for (int i = 0; i < 8; i++) {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= FNV_PRIME;
+    }
+}
+
+// mixes in the bytes, then the length, so adjacent strings cannot run into each other
+inline void fnv_mix(uint64_t &hash, std::string_view bytes) noexcept
+{
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= FNV_PRIME;
+    }
+    fnv_mix(hash, static_cast<uint64_t>(bytes.size()));
+}
+
+} // namespace PROJECT_NAME::core
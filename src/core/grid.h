@@ -0,0 +1,21 @@
+#pragma once
+#include "config.h"
+
+namespace PROJECT_NAME::core
+{
+
+// toggles a straight grid division to its triplet counterpart and back, e.g. 1/8 <-> 1/12
+constexpr double switch_gridsize(const double gridsize) noexcept
+{
+    unsigned int denominator = (unsigned int)(1 / gridsize + 0.5);
+
+    if (denominator % 3) // not dividable by 3
+        if (denominator % 2)
+            return gridsize;
+        else
+            return 1. / (denominator / 2 * 3);
+    else
+        return 1. / (denominator / 3 * 2);
+}
+
+} // namespace PROJECT_NAME::core
@@ -0,0 +1,245 @@
+#pragma once
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ETHLT_LOUDNESS_SSE2
+#endif
+
+// Sample peak, RMS and integrated loudness (ITU-R BS.1770 K-weighting and gating) of interleaved
+// audio, fed block by block. All channels weigh the same (no surround weights) and a trailing
+// partial block is dropped, so it approximates a proper LUFS meter closely enough to level stems
+// against each other.
+namespace PROJECT_NAME::core
+{
+
+// y = b0 x + b1 x[-1] + b2 x[-2] - a1 y[-1] - a2 y[-2]
+struct Biquad
+{
+    double b0, b1, b2, a1, a2;
+};
+
+// the two BS.1770 K-weighting stages for any sample rate, derived from the analog prototypes the
+// 48 kHz coefficients in the standard come from
+inline void k_weighting(double rate, Biquad &shelf, Biquad &highpass) noexcept
+{
+    constexpr double PI = 3.14159265358979323846;
+
+    double f0 = 1681.974450955533;
+    const double gain_db = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = std::tan(PI * f0 / rate);
+    const double vh = std::pow(10.0, gain_db / 20);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1 + k / q + k * k;
+    shelf = {(vh + vb * k / q + k * k) / a0, 2 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+             2 * (k * k - 1) / a0, (1 - k / q + k * k) / a0};
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(PI * f0 / rate);
+    a0 = 1 + k / q + k * k;
+    highpass = {1, -2, 1, 2 * (k * k - 1) / a0, (1 - k / q + k * k) / a0};
+}
+
+constexpr double LUFS_SILENCE = -HUGE_VAL;
+
+inline double energy_to_lufs(double mean_square) noexcept
+{
+    return mean_square > 0 ? -0.691 + 10 * std::log10(mean_square) : LUFS_SILENCE;
+}
+
+class LoudnessMeter
+{
+public:
+    static constexpr int MAX_CHANNELS = 8;
+
+    // vectorize = false keeps to the scalar loop even where SSE2 is available, which gives the same
+    // results bit for bit; for checking the two against each other
+    LoudnessMeter(double rate, int channels, bool vectorize = true)
+        : channels_(std::clamp(channels, 1, MAX_CHANNELS)),
+          subblock_frames_(std::max<size_t>(1, static_cast<size_t>(rate / 10))), vectorize_(vectorize)
+    {
+        k_weighting(rate, shelf_, highpass_);
+    }
+
+    // frames of `channels` interleaved samples each, as passed to the constructor
+    void process(const double *samples, size_t frames)
+    {
+        while (frames) {
+            const size_t n = std::min(frames, subblock_frames_ - subblock_filled_);
+            process_run(samples, n);
+            samples += n * channels_;
+            frames -= n;
+            subblock_filled_ += n;
+            if (subblock_filled_ == subblock_frames_) {
+                subblocks_.push_back(subblock_energy_);
+                subblock_energy_ = 0;
+                subblock_filled_ = 0;
+            }
+        }
+    }
+
+    double peak() const noexcept { return peak_; }
+
+    double rms() const noexcept
+    {
+        return sample_count_ ? std::sqrt(sum_squares_ / static_cast<double>(sample_count_)) : 0;
+    }
+
+    // gated over 400 ms blocks with 75% overlap; audio shorter than one block counts as a single
+    // block, so short one-shots still get a value
+    double integrated_lufs() const
+    {
+        constexpr size_t SUBBLOCKS_PER_BLOCK = 4;
+        const double block_frames = static_cast<double>(subblock_frames_ * SUBBLOCKS_PER_BLOCK);
+
+        std::vector<double> blocks;
+        if (subblocks_.size() >= SUBBLOCKS_PER_BLOCK) {
+            blocks.reserve(subblocks_.size() - SUBBLOCKS_PER_BLOCK + 1);
+            double window = 0;
+            for (size_t i = 0; i < subblocks_.size(); i++) {
+                window += subblocks_[i];
+                if (i >= SUBBLOCKS_PER_BLOCK)
+                    window -= subblocks_[i - SUBBLOCKS_PER_BLOCK];
+                if (i + 1 >= SUBBLOCKS_PER_BLOCK)
+                    blocks.push_back(std::max(0.0, window) / block_frames);
+            }
+        } else {
+            const size_t frames = subblocks_.size() * subblock_frames_ + subblock_filled_;
+            double energy = subblock_energy_;
+            for (double e : subblocks_)
+                energy += e;
+            if (frames)
+                blocks.push_back(energy / static_cast<double>(frames));
+        }
+
+        // absolute gate at -70 LUFS, then a relative gate 10 LU below the loudness of what passed
+        constexpr double ABSOLUTE_GATE = -70;
+        constexpr double RELATIVE_GATE = -10;
+        const double absolute_threshold = std::pow(10.0, (ABSOLUTE_GATE + 0.691) / 10);
+        const double relative_threshold = gated_mean(blocks, absolute_threshold) * std::pow(10.0, RELATIVE_GATE / 10);
+        return energy_to_lufs(gated_mean(blocks, std::max(absolute_threshold, relative_threshold)));
+    }
+
+private:
+    static double gated_mean(const std::vector<double> &blocks, double threshold) noexcept
+    {
+        double sum = 0;
+        size_t count = 0;
+        for (double e : blocks) {
+            if (e > threshold) {
+                sum += e;
+                count++;
+            }
+        }
+        return count ? sum / static_cast<double>(count) : 0;
+    }
+
+    // frames within one sub-block
+    void process_run(const double *samples, size_t frames) noexcept
+    {
+        int c = 0;
+#ifdef ETHLT_LOUDNESS_SSE2
+        // the filters are recursive in time, so the vector lanes run two channels side by side
+        for (; vectorize_ && c + 1 < channels_; c += 2)
+            process_pair_sse2(samples + c, frames, c);
+#endif
+        for (; c < channels_; c++)
+            process_channel(samples + c, frames, c);
+        sample_count_ += frames * static_cast<size_t>(channels_);
+    }
+
+    void process_channel(const double *x, size_t frames, int c) noexcept
+    {
+        const Biquad s = shelf_, h = highpass_;
+        double s1 = state_[c][0], s2 = state_[c][1], h1 = state_[c][2], h2 = state_[c][3];
+        double peak = peak_, sum_squares = 0, energy = 0;
+        for (size_t i = 0; i < frames; i++, x += channels_) {
+            const double in = *x;
+            peak = std::max(peak, std::fabs(in));
+            sum_squares += in * in;
+
+            const double y = s.b0 * in + s1;
+            s1 = s.b1 * in - s.a1 * y + s2;
+            s2 = s.b2 * in - s.a2 * y;
+            const double z = h.b0 * y + h1;
+            h1 = h.b1 * y - h.a1 * z + h2;
+            h2 = h.b2 * y - h.a2 * z;
+            energy += z * z;
+        }
+        state_[c][0] = s1, state_[c][1] = s2, state_[c][2] = h1, state_[c][3] = h2;
+        peak_ = peak;
+        sum_squares_ += sum_squares;
+        subblock_energy_ += energy;
+    }
+
+#ifdef ETHLT_LOUDNESS_SSE2
+    void process_pair_sse2(const double *x, size_t frames, int c) noexcept
+    {
+        const __m128d sb0 = _mm_set1_pd(shelf_.b0), sb1 = _mm_set1_pd(shelf_.b1), sb2 = _mm_set1_pd(shelf_.b2),
+                      sa1 = _mm_set1_pd(shelf_.a1), sa2 = _mm_set1_pd(shelf_.a2);
+        const __m128d hb0 = _mm_set1_pd(highpass_.b0), hb1 = _mm_set1_pd(highpass_.b1),
+                      hb2 = _mm_set1_pd(highpass_.b2), ha1 = _mm_set1_pd(highpass_.a1),
+                      ha2 = _mm_set1_pd(highpass_.a2);
+        const __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+
+        __m128d s1 = _mm_set_pd(state_[c + 1][0], state_[c][0]), s2 = _mm_set_pd(state_[c + 1][1], state_[c][1]);
+        __m128d h1 = _mm_set_pd(state_[c + 1][2], state_[c][2]), h2 = _mm_set_pd(state_[c + 1][3], state_[c][3]);
+        __m128d peak = _mm_set1_pd(peak_), sum_squares = _mm_setzero_pd(), energy = _mm_setzero_pd();
+
+        for (size_t i = 0; i < frames; i++, x += channels_) {
+            const __m128d in = _mm_loadu_pd(x);
+            peak = _mm_max_pd(peak, _mm_and_pd(in, abs_mask));
+            sum_squares = _mm_add_pd(sum_squares, _mm_mul_pd(in, in));
+
+            const __m128d y = _mm_add_pd(_mm_mul_pd(sb0, in), s1);
+            s1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(sb1, in), _mm_mul_pd(sa1, y)), s2);
+            s2 = _mm_sub_pd(_mm_mul_pd(sb2, in), _mm_mul_pd(sa2, y));
+            const __m128d z = _mm_add_pd(_mm_mul_pd(hb0, y), h1);
+            h1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(hb1, y), _mm_mul_pd(ha1, z)), h2);
+            h2 = _mm_sub_pd(_mm_mul_pd(hb2, y), _mm_mul_pd(ha2, z));
+            energy = _mm_add_pd(energy, _mm_mul_pd(z, z));
+        }
+
+        double lanes[2];
+        _mm_storeu_pd(lanes, s1);
+        state_[c][0] = lanes[0], state_[c + 1][0] = lanes[1];
+        _mm_storeu_pd(lanes, s2);
+        state_[c][1] = lanes[0], state_[c + 1][1] = lanes[1];
+        _mm_storeu_pd(lanes, h1);
+        state_[c][2] = lanes[0], state_[c + 1][2] = lanes[1];
+        _mm_storeu_pd(lanes, h2);
+        state_[c][3] = lanes[0], state_[c + 1][3] = lanes[1];
+        _mm_storeu_pd(lanes, peak);
+        peak_ = std::max(lanes[0], lanes[1]);
+        // one channel after the other, in the order the scalar loop adds them
+        _mm_storeu_pd(lanes, sum_squares);
+        sum_squares_ += lanes[0];
+        sum_squares_ += lanes[1];
+        _mm_storeu_pd(lanes, energy);
+        subblock_energy_ += lanes[0];
+        subblock_energy_ += lanes[1];
+    }
+#endif
+
+    int channels_;
+    size_t subblock_frames_;
+    [[maybe_unused]] bool vectorize_; // only read where SSE2 is available
+    Biquad shelf_, highpass_;
+    double state_[MAX_CHANNELS][4] = {}; // shelf z1, z2, high pass z1, z2 per channel
+
+    double peak_ = 0, sum_squares_ = 0;
+    size_t sample_count_ = 0;
+
+    // K-weighted energy summed over channels, per 100 ms
+    std::vector<double> subblocks_;
+    double subblock_energy_ = 0;
+    size_t subblock_filled_ = 0;
+};
+
+} // namespace PROJECT_NAME::core
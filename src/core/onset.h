@@ -0,0 +1,192 @@
+#pragma once
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ETHLT_ONSET_SSE2
+#endif
+
+// Kick-style onset detection on interleaved audio, fed block by block: the mono downmix is low
+// passed, its energy taken per short hop, and a hit is where the hop energy rises steeply above
+// the quietest of the last few hops. Hits are reported at the start of their hop, so they come at
+// most one hop early, which suits triggering a ducker.
+namespace PROJECT_NAME::core
+{
+
+struct OnsetParams
+{
+    double hop_seconds = 0.005;
+    double lowpass_hz = 150;   // the kick's band
+    double rise_window = 0.02; // how far back the rise is measured from, seconds
+    double rise_db = 9;        // minimum rise over that window
+    double floor_db = -45;     // hop energy below this never triggers, dBFS
+    double min_interval = 0.1; // seconds between two hits
+};
+
+struct OnsetHit
+{
+    double time;     // seconds since the first frame processed
+    double level_db; // energy of the hop it was found in, dBFS
+};
+
+class OnsetDetector
+{
+public:
+    OnsetDetector(double rate, int channels, const OnsetParams &params = {})
+        : channels_(std::max(1, channels)),
+          hop_frames_(std::max<size_t>(1, static_cast<size_t>(std::lround(rate * params.hop_seconds)))),
+          hop_seconds_(static_cast<double>(hop_frames_) / rate),
+          window_hops_(std::max<size_t>(1, static_cast<size_t>(std::lround(params.rise_window / hop_seconds_)))),
+          min_interval_hops_(static_cast<size_t>(std::ceil(params.min_interval / hop_seconds_))),
+          rise_db_(params.rise_db), floor_db_(params.floor_db), recent_(window_hops_, -HUGE_VAL)
+    {
+        // RBJ low pass, Q = 1/sqrt(2)
+        constexpr double PI = 3.14159265358979323846;
+        const double w = 2 * PI * std::min(params.lowpass_hz, rate * 0.45) / rate;
+        const double alpha = std::sin(w) / std::sqrt(2.0);
+        const double cosw = std::cos(w);
+        const double a0 = 1 + alpha;
+        b0_ = (1 - cosw) / 2 / a0;
+        b1_ = (1 - cosw) / a0;
+        b2_ = b0_;
+        a1_ = -2 * cosw / a0;
+        a2_ = (1 - alpha) / a0;
+    }
+
+    void process(const double *samples, size_t frames)
+    {
+        while (frames) {
+            const size_t n = std::min(frames, hop_frames_ - hop_filled_);
+            mono_.resize(n);
+            downmix(samples, n, mono_.data());
+            lowpass(mono_.data(), n);
+            hop_energy_ += sum_squares(mono_.data(), n);
+            samples += n * channels_;
+            frames -= n;
+            hop_filled_ += n;
+            if (hop_filled_ == hop_frames_)
+                finish_hop();
+        }
+    }
+
+    const std::vector<OnsetHit> &hits() const noexcept { return hits_; }
+
+    double hop_seconds() const noexcept { return hop_seconds_; }
+
+private:
+    void downmix(const double *x, size_t frames, double *out) const noexcept
+    {
+        size_t i = 0;
+        if (channels_ == 1) {
+            std::copy(x, x + frames, out);
+            return;
+        }
+#ifdef ETHLT_ONSET_SSE2
+        if (channels_ == 2) {
+            const __m128d half = _mm_set1_pd(0.5);
+            for (; i + 2 <= frames; i += 2) {
+                const __m128d a = _mm_loadu_pd(x + 2 * i);     // L0 R0
+                const __m128d b = _mm_loadu_pd(x + 2 * i + 2); // L1 R1
+                const __m128d sum = _mm_add_pd(_mm_unpacklo_pd(a, b), _mm_unpackhi_pd(a, b));
+                _mm_storeu_pd(out + i, _mm_mul_pd(sum, half));
+            }
+        }
+#endif
+        const double scale = 1.0 / channels_;
+        for (; i < frames; i++) {
+            double sum = 0;
+            for (int c = 0; c < channels_; c++)
+                sum += x[i * channels_ + c];
+            out[i] = sum * scale;
+        }
+    }
+
+    // recursive, so one sample after another
+    void lowpass(double *x, size_t frames) noexcept
+    {
+        double z1 = z1_, z2 = z2_;
+        for (size_t i = 0; i < frames; i++) {
+            const double in = x[i];
+            const double y = b0_ * in + z1;
+            z1 = b1_ * in - a1_ * y + z2;
+            z2 = b2_ * in - a2_ * y;
+            x[i] = y;
+        }
+        z1_ = z1, z2_ = z2;
+    }
+
+    static double sum_squares(const double *x, size_t n) noexcept
+    {
+        size_t i = 0;
+        double sum = 0;
+#ifdef ETHLT_ONSET_SSE2
+        __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+        for (; i + 4 <= n; i += 4) {
+            const __m128d a = _mm_loadu_pd(x + i), b = _mm_loadu_pd(x + i + 2);
+            acc0 = _mm_add_pd(acc0, _mm_mul_pd(a, a));
+            acc1 = _mm_add_pd(acc1, _mm_mul_pd(b, b));
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+        sum = lanes[0] + lanes[1];
+#endif
+        for (; i < n; i++)
+            sum += x[i] * x[i];
+        return sum;
+    }
+
+    void finish_hop()
+    {
+        const double level = 10 * std::log10(hop_energy_ / static_cast<double>(hop_frames_) + 1e-20);
+        const double floor = *std::min_element(recent_.begin(), recent_.end());
+        const bool rising = level - floor >= rise_db_;
+
+        // the first hop of a rise only, and not within the minimum interval of the last hit
+        if (rising && !was_rising_ && level >= floor_db_ &&
+            (hits_.empty() || hop_index_ - last_hit_hop_ >= min_interval_hops_)) {
+            hits_.push_back({static_cast<double>(hop_index_) * hop_seconds_, level});
+            last_hit_hop_ = hop_index_;
+        }
+        was_rising_ = rising;
+
+        recent_[hop_index_ % window_hops_] = level;
+        hop_index_++;
+        hop_energy_ = 0;
+        hop_filled_ = 0;
+    }
+
+    int channels_;
+    size_t hop_frames_;
+    double hop_seconds_;
+    size_t window_hops_, min_interval_hops_;
+    double rise_db_, floor_db_;
+
+    double b0_, b1_, b2_, a1_, a2_;
+    double z1_ = 0, z2_ = 0;
+    std::vector<double> mono_;
+
+    std::vector<double> recent_; // hop levels of the rise window, a ring
+    double hop_energy_ = 0;
+    size_t hop_filled_ = 0, hop_index_ = 0, last_hit_hop_ = 0;
+    bool was_rising_ = false;
+    std::vector<OnsetHit> hits_;
+};
+
+// joins hits of consecutive stretches analysed apart, dropping those closer than min_interval to
+// the previous one; hits has to be sorted by time
+inline void enforce_min_interval(std::vector<OnsetHit> &hits, double min_interval)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < hits.size(); i++) {
+        if (kept && hits[i].time - hits[kept - 1].time < min_interval)
+            continue;
+        hits[kept++] = hits[i];
+    }
+    hits.resize(kept);
+}
+
+} // namespace PROJECT_NAME::core
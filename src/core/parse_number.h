@@ -0,0 +1,63 @@
+#pragma once
+#include "config.h"
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+// Locale-independent number parsing from a non-terminated token, e.g. a field of a memory-mapped
+// chunk. Floating-point std::from_chars is missing from older standard libraries (libc++ before
+// macOS 14), those fall back to strtod on a stack copy.
+namespace PROJECT_NAME::core
+{
+
+namespace detail
+{
+
+inline const char *strtod_prefix(const char *first, const char *last, double &value) noexcept
+{
+    char buf[64];
+    const size_t len = static_cast<size_t>(last - first) < sizeof(buf) ? last - first : sizeof(buf) - 1;
+    memcpy(buf, first, len);
+    buf[len] = '\0';
+    char *end;
+    value = strtod(buf, &end);
+    return end == buf ? nullptr : first + (end - buf);
+}
+
+} // namespace detail
+
+// parses the longest decimal number at the start of [first, last) like strtod does, returns the end
+// of the number or nullptr if there is none; hex floats are not supported
+inline const char *parse_double_prefix(const char *first, const char *last, double &value) noexcept
+{
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    // from_chars takes no leading '+', which strtod does
+    const char *start = first;
+    if (start != last && *start == '+' && start + 1 != last && start[1] != '-' && start[1] != '+')
+        start++;
+    const auto [end, ec] = std::from_chars(start, last, value);
+    if (ec == std::errc())
+        return end;
+    if (ec == std::errc::result_out_of_range) // strtod saturates instead
+        return detail::strtod_prefix(first, last, value);
+    return nullptr;
+#else
+    return detail::strtod_prefix(first, last, value);
+#endif
+}
+
+// the whole token has to be a number
+inline bool parse_double(std::string_view token, double &value) noexcept
+{
+    const char *last = token.data() + token.size();
+    return !token.empty() && parse_double_prefix(token.data(), last, value) == last;
+}
+
+inline bool parse_int(std::string_view token, int &value) noexcept
+{
+    const auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    return !token.empty() && ec == std::errc() && end == token.data() + token.size();
+}
+
+} // namespace PROJECT_NAME::core
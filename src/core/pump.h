@@ -0,0 +1,109 @@
+#pragma once
+#include "config.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Pump (sidechain ducking) curves as envelope points: each hit ramps the gain down linearly over
+// the attack and lets it recover over the release with a "fast start" segment, so one hit costs
+// at most three points however long the curve is. A hit that comes before the previous one has
+// recovered starts from wherever that one got to.
+namespace PROJECT_NAME::core
+{
+
+// REAPER envelope point shapes used here
+constexpr int SHAPE_LINEAR = 0;
+constexpr int SHAPE_FAST_START = 3;
+
+struct PumpShape
+{
+    double attack, release; // seconds
+    double depth;           // 0..1, how far the gain goes down from 1
+};
+
+struct PumpPoint
+{
+    double time, value;
+    int shape; // of the segment towards the next point
+};
+
+// value of a segment at a fraction x of the way from a to b; fast start is approximated as
+// 1 - (1 - x)^2, close to what REAPER draws
+inline double segment_value(int shape, double a, double b, double x) noexcept
+{
+    x = std::clamp(x, 0.0, 1.0);
+    if (shape == SHAPE_FAST_START)
+        x = 1 - (1 - x) * (1 - x);
+    return a + (b - a) * x;
+}
+
+namespace detail
+{
+
+inline double value_at(const std::vector<PumpPoint> &points, double time) noexcept
+{
+    if (points.empty() || time < points.front().time)
+        return 1;
+    auto next = std::upper_bound(points.begin(), points.end(), time,
+                                 [](double t, const PumpPoint &p) { return t < p.time; });
+    if (next == points.end())
+        return points.back().value;
+    const PumpPoint &prev = *(next - 1);
+    return segment_value(prev.shape, prev.value, next->value, (time - prev.time) / (next->time - prev.time));
+}
+
+} // namespace detail
+
+// Points of the curve over [0, length) for hits at the given times relative to the window,
+// sorted; hits before 0 count for the part of their release that reaches in. The window starts
+// and ends with a point, so windows laid side by side join without steps.
+inline void pump_points(const PumpShape &shape, const std::vector<double> &hits, double length,
+                        std::vector<PumpPoint> &out)
+{
+    const double floor = 1 - std::clamp(shape.depth, 0.0, 1.0);
+    const double attack = std::max(shape.attack, 0.0), release = std::max(shape.release, 1e-6);
+
+    std::vector<PumpPoint> curve;
+    double value = 1; // the curve's value at the current hit
+    for (size_t i = 0; i < hits.size(); i++) {
+        const double t = hits[i];
+        const double next = i + 1 < hits.size() ? hits[i + 1] : t + attack + release + 1;
+        curve.push_back({t, value, SHAPE_LINEAR});
+
+        if (next < t + attack) { // still going down when the next hit comes
+            value = segment_value(SHAPE_LINEAR, value, floor, (next - t) / attack);
+            continue;
+        }
+        curve.push_back({t + attack, floor, SHAPE_FAST_START});
+        if (next < t + attack + release) {
+            value = segment_value(SHAPE_FAST_START, floor, 1, (next - t - attack) / release);
+            continue;
+        }
+        curve.push_back({t + attack + release, 1, SHAPE_LINEAR});
+        value = 1;
+    }
+
+    out.clear();
+    auto segment_shape_at = [&](double time) {
+        auto next = std::upper_bound(curve.begin(), curve.end(), time,
+                                     [](double t, const PumpPoint &p) { return t < p.time; });
+        return next == curve.begin() ? SHAPE_LINEAR : (next - 1)->shape;
+    };
+    out.push_back({0, detail::value_at(curve, 0), segment_shape_at(0)});
+    for (const PumpPoint &point : curve) {
+        if (point.time > 0 && point.time < length)
+            out.push_back(point);
+    }
+    out.push_back({length, detail::value_at(curve, length), SHAPE_LINEAR});
+
+    // a point between two of the same value lies on a flat stretch and adds nothing
+    size_t kept = 0;
+    for (size_t i = 0; i < out.size(); i++) {
+        if (kept && i + 1 < out.size() && out[kept - 1].value == out[i].value && out[i + 1].value == out[i].value)
+            continue;
+        out[kept++] = out[i];
+    }
+    out.resize(kept);
+}
+
+} // namespace PROJECT_NAME::core
@@ -0,0 +1,59 @@
+#pragma once
+#include "config.h"
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+// Bounded single-producer/single-consumer queue for handing values from a real-time thread to
+// another one. Both ends are wait-free and never allocate: the producer owns head_, the consumer
+// owns tail_, and each only reads the other's index (acquire) to see how far it may go.
+namespace PROJECT_NAME::core
+{
+
+template<typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "values are copied in and out of the slots");
+
+public:
+    // producer only; false when full, the value is then dropped
+    bool try_push(const T &value) noexcept
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ == Capacity) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ == Capacity)
+                return false;
+        }
+        slots_[head & (Capacity - 1)] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only; false when empty
+    bool try_pop(T &value) noexcept
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cached_head_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail == cached_head_)
+                return false;
+        }
+        value = slots_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    static constexpr size_t capacity() noexcept { return Capacity; }
+
+private:
+    // the two ends on their own cache lines, each next to the copy of the other's index it keeps
+    alignas(64) std::atomic<size_t> head_ {0};
+    size_t cached_tail_ = 0; // producer's
+    alignas(64) std::atomic<size_t> tail_ {0};
+    size_t cached_head_ = 0; // consumer's
+    alignas(64) T slots_[Capacity];
+};
+
+} // namespace PROJECT_NAME::core
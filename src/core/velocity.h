@@ -0,0 +1,20 @@
+#pragma once
+#include "config.h"
+#include <algorithm>
+
+// MIDI velocity stepping used by the smart velocity adjust actions
+namespace PROJECT_NAME::core
+{
+
+template<bool increase, bool is_fine>
+inline int adjust_velocity(int vel) noexcept
+{
+    if (is_fine)
+        return increase ? std::min(0x7F, (((vel + 1) >> 2) + 1) << 2)
+                        : std::max(1, (((vel + 3) >> 2) - 1) << 2);
+    else
+        return increase ? std::min(0x7F, (((vel + 7) >> 4) + 1) << 4)
+                        : std::max(1, (((vel + 9) >> 4) - 1) << 4);
+}
+
+} // namespace PROJECT_NAME::core
@@ -0,0 +1,116 @@
+#pragma once
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+
+// Volume and envelope value stepping used by the smart volume adjust actions. These kernels have
+// no REAPER dependency; bench/bench_kernels checks them against the original implementation.
+namespace PROJECT_NAME::core
+{
+
+constexpr double db2factor(double db) noexcept {
+    double exp = db / 6;
+    int int_part = static_cast<int>(exp);
+    double frac_part = exp - int_part;
+    
+    // calculate 2^int_part using bit shifting
+    double result = 1;
+    if (int_part > 0)
+        result *= static_cast<double>(1 << int_part);
+    else if (int_part < 0)
+        result /= static_cast<double>(1 << -int_part);
+    
+    // for fractional part, use a simple approximation
+    if (frac_part != 0) {
+        double x = frac_part;
+        result *= 1.0 + 0.6931471805599453 * x 
+                      + 0.24022650695910072 * x*x
+                      + 0.05550410866482158 * x*x*x
+                      + 0.009618129107628477 * x*x*x*x
+                      + 0.0013333558146428443 * x*x*x*x*x;
+    }
+    
+    return result;
+}
+
+constexpr int MIN_VOL_DB = -48;
+constexpr double MIN_VOL_FACTOR = db2factor(MIN_VOL_DB);
+#define STEP_OFFSET (increase ? 1.4 : -0.4)
+
+template<bool increase, bool is_fine>
+double adjust_volume(const double vol) noexcept
+{
+    if (vol <= 0)
+        return increase ? MIN_VOL_FACTOR : 0;
+
+    if (!increase && vol < MIN_VOL_FACTOR)
+        return 0;
+    
+    const double new_vol = exp2(
+        is_fine ? floor(log2(vol) * 12 + STEP_OFFSET) / 12 :
+                  floor(log2(vol) *  2 + STEP_OFFSET) /  2
+    );
+    
+    if (new_vol < MIN_VOL_FACTOR)
+        return increase ? MIN_VOL_FACTOR : 0;
+    
+    return new_vol;
+}
+
+// the nearest step of the fine volume lattice (2^(k/12), 0.5 dB apart), so a computed gain keeps
+// stepping cleanly with adjust_volume<_, true> afterwards
+inline double snap_volume(const double vol) noexcept
+{
+    if (vol < MIN_VOL_FACTOR)
+        return MIN_VOL_FACTOR;
+    return exp2(std::round(log2(vol) * 12) / 12);
+}
+
+template<bool increase, bool is_fine>
+double adjust_envpt_value(
+    const double val,
+    const double min_val,
+    const double max_val,
+    const double mid_val,
+    const int adjust_type = 0
+) noexcept
+{
+    static constexpr int STEP_NUM = is_fine ? 32 : 8;
+
+    // common case
+    if (adjust_type == 0 && min_val == 0 && max_val == 1 && mid_val == 0.5)
+        return std::clamp(
+            floor(STEP_NUM * val + STEP_OFFSET) / STEP_NUM,
+            0.0, 1.0
+        );
+    
+    if (adjust_type == 1 && min_val == 0)
+        return std::min(max_val / mid_val, adjust_volume<increase, is_fine>(val / mid_val)) * mid_val;
+    
+    if (adjust_type == 2)
+        return increase;
+    
+    // volume smoother
+    if (min_val == -60 && max_val == 12 && mid_val == 0)
+        return std::clamp(
+            is_fine ? floor(val * 2 + STEP_OFFSET) / 2 :
+                      floor(val / 3 + STEP_OFFSET) * 3,
+            -60.0, 12.0
+        );
+    
+    // normalize
+    double factor = val < min_val ? 0 :
+                    val < mid_val ? (val - min_val) / (mid_val - min_val) / 2 :
+                    val < max_val ? (val - mid_val) / (max_val - mid_val) / 2 + 0.5 : 1;
+    
+    factor = floor(STEP_NUM * factor + STEP_OFFSET) / STEP_NUM;
+    factor = std::clamp(factor, 0.0, 1.0);
+
+    // scale back
+    return factor < 0.5 ? min_val + (mid_val - min_val) * factor * 2 :
+                          mid_val + (max_val - mid_val) * (factor - 0.5) * 2;
+}
+
+#undef STEP_OFFSET
+
+} // namespace PROJECT_NAME::core
@@ -0,0 +1,156 @@
+#include "envelope_index.h"
+#include "core/fnv.h"
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+using core::FNV_OFFSET_BASIS;
+using core::fnv_mix;
+
+// identifies the set of envelopes on a track from what REAPER counts for it: an automated FX
+// deleted and another one automated keeps the envelope count but changes the pointers, which are
+// few per track; items, takes and take envelopes are only counted
+struct TrackSignature
+{
+    GUID guid;
+    int envelope_count;
+    int item_count;
+    int take_count;          // over all items
+    int take_envelope_count; // over all takes
+    uint64_t envelopes_hash; // track envelope pointers, in order
+
+    bool operator==(const TrackSignature &other) const noexcept
+    {
+        return envelope_count == other.envelope_count && item_count == other.item_count &&
+               take_count == other.take_count && take_envelope_count == other.take_envelope_count &&
+               envelopes_hash == other.envelopes_hash && !memcmp(&guid, &other.guid, sizeof(GUID));
+    }
+};
+
+struct TrackInventory
+{
+    MediaTrack *track;
+    TrackSignature signature;
+    std::vector<EnvelopeRecord> records;
+};
+
+ReaProject *cached_project = nullptr;
+int cached_state_change_count = 0;
+bool cache_valid = false;
+std::vector<TrackInventory> cached_tracks;
+std::vector<EnvelopeRecord> inventory;
+
+TrackSignature track_signature(MediaTrack *track)
+{
+    TrackSignature signature {};
+    if (const GUID *guid = GetTrackGUID(track))
+        signature.guid = *guid;
+    signature.envelope_count = CountTrackEnvelopes(track);
+    signature.item_count = CountTrackMediaItems(track);
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (int i = 0; i < signature.envelope_count; i++)
+        fnv_mix(hash, reinterpret_cast<uintptr_t>(GetTrackEnvelope(track, i)));
+    signature.envelopes_hash = hash;
+
+    for (int i = 0; i < signature.item_count; i++) {
+        MediaItem *item = GetTrackMediaItem(track, i);
+        const int take_count = item ? CountTakes(item) : 0;
+        signature.take_count += take_count;
+        for (int j = 0; j < take_count; j++) {
+            if (MediaItem_Take *take = GetMediaItemTake(item, j))
+                signature.take_envelope_count += CountTakeEnvelopes(take);
+        }
+    }
+    return signature;
+}
+
+void collect_envelopes(MediaTrack *track, std::vector<EnvelopeRecord> &records)
+{
+    records.clear();
+
+    const int env_count = CountTrackEnvelopes(track);
+    for (int i = 0; i < env_count; i++) {
+        if (TrackEnvelope *env = GetTrackEnvelope(track, i))
+            records.push_back({env, track, nullptr, EnvelopeOwner::Track});
+    }
+
+    const int item_count = CountTrackMediaItems(track);
+    for (int i = 0; i < item_count; i++) {
+        MediaItem *item = GetTrackMediaItem(track, i);
+        if (!item)
+            continue;
+
+        const int take_count = CountTakes(item);
+        for (int j = 0; j < take_count; j++) {
+            MediaItem_Take *take = GetMediaItemTake(item, j);
+            if (!take)
+                continue;
+
+            const int take_env_count = CountTakeEnvelopes(take);
+            for (int k = 0; k < take_env_count; k++) {
+                if (TrackEnvelope *env = GetTakeEnvelope(take, k))
+                    records.push_back({env, track, take, EnvelopeOwner::Take});
+            }
+        }
+    }
+}
+
+void rebuild(bool full)
+{
+    std::unordered_map<MediaTrack *, size_t> previous;
+    if (!full) {
+        previous.reserve(cached_tracks.size());
+        for (size_t i = 0; i < cached_tracks.size(); i++)
+            previous.emplace(cached_tracks[i].track, i);
+    }
+
+    std::vector<TrackInventory> tracks;
+    const int track_count = CountTracks(nullptr);
+    tracks.reserve(track_count);
+    for (int i = 0; i < track_count; i++) {
+        MediaTrack *track = GetTrack(nullptr, i);
+        if (!track)
+            continue;
+
+        TrackInventory entry {track, track_signature(track), {}};
+        auto it = previous.find(track);
+        if (it != previous.end() && cached_tracks[it->second].signature == entry.signature)
+            entry.records = std::move(cached_tracks[it->second].records);
+        else
+            collect_envelopes(track, entry.records);
+        tracks.push_back(std::move(entry));
+    }
+    cached_tracks = std::move(tracks);
+
+    inventory.clear();
+    for (const TrackInventory &entry : cached_tracks)
+        inventory.insert(inventory.end(), entry.records.begin(), entry.records.end());
+}
+
+} // anonymous namespace
+
+const std::vector<EnvelopeRecord> &envelope_inventory()
+{
+    ReaProject *project = EnumProjects(-1, nullptr, 0);
+    const int state_change_count = GetProjectStateChangeCount(project);
+
+    // a different track count without a state change means a script edited without an undo point
+    if (cache_valid && project == cached_project && state_change_count == cached_state_change_count &&
+        CountTracks(nullptr) == static_cast<int>(cached_tracks.size()))
+        return inventory;
+
+    rebuild(!cache_valid || project != cached_project);
+    cached_project = project;
+    cached_state_change_count = state_change_count;
+    cache_valid = true;
+    return inventory;
+}
+
+} // namespace PROJECT_NAME
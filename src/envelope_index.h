@@ -0,0 +1,32 @@
+#pragma once
+#include "config.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+#include <reaper_plugin_functions.h>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+enum class EnvelopeOwner
+{
+    Track,
+    Take
+};
+
+struct EnvelopeRecord
+{
+    TrackEnvelope *envelope;
+    MediaTrack *track;    // owning track, for take envelopes the track of the item
+    MediaItem_Take *take; // nullptr for track envelopes
+    EnvelopeOwner owner;
+};
+
+// Every track and take envelope of the current project, in track order, track envelopes before
+// take envelopes. The inventory is rebuilt only when GetProjectStateChangeCount moves, and then
+// only for tracks whose key changed: GUID, track envelope pointers and the counts of items, takes
+// and take envelopes. A take envelope replaced by another with no count moving keeps its old
+// record until the track's key changes. Main thread only; the reference stays valid until the
+// next call.
+const std::vector<EnvelopeRecord> &envelope_inventory();
+
+} // namespace PROJECT_NAME
@@ -1,9 +1,28 @@
 #include "ethlt_reaper_toolkit.h"
+#include "action_stats.h"
+#include "api_profiler.h"
+#include "arena.h"
+#include "batch_api.h"
+#include "log.h"
+#include "pipeline.h"
 #include "reaper_vararg.hpp"
+#include "scheduler.h"
+#include "trace.h"
+#include "track_meter.h"
 #include <gsl/gsl>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
 
 #include "actions/append_duplicate.h"
+#include "actions/automation_file.h"
 #include "actions/clean_envelope_points.h"
+#include "actions/clean_recorded_automation.h"
+#include "actions/level_to_target.h"
+#include "actions/normalize_items.h"
 #include "actions/setup_global_midisend.h"
 #include "actions/smart_midi_vel_adjust.h"
 #include "actions/smart_vol_adjust.h"
@@ -32,48 +51,125 @@ enum class SectionId
     MediaExplorer = 32063
 };
 
+using ActionCallback = void (*)();
+using ToggleStateCallback = bool (*)();
+
+void dump_action_stats();
+#ifdef ETHLT_API_PROFILING
+void dump_api_profile();
+#endif
+
 struct ActionInfo
 {
-    int command_id;
     bool run_on_timer; // individual timer setting for each action
-    bool toggle_state;
     SectionId section_id;
     const char *command_name;
     const char *action_name;
-    custom_action_register_t action;
-    std::function<void()> onaction; // function to call when action triggered
+    ActionCallback onaction; // function to call when action triggered
+    ToggleStateCallback toggle_state = nullptr; // on/off state of actions that aren't run_on_timer
 };
 
 // define your actions here with individual timer settings
 // clang-format off
-std::vector<ActionInfo> actions = {
-    { 0, false, false, SectionId::Main,                "ETHLT_SMART_VOLUP_COMMAND_MAIN",            "ethlt: Smart Volume Up (Main Section)",         {}, smart_vol_adjust<true, false>},
-    { 1, false, false, SectionId::MidiEditor,          "ETHLT_SMART_VOLUP_COMMAND_MIDI_EDITOR",     "ethlt: Smart Volume Up (Midi Editor)",          {}, smart_midi_vel_adjust<true, false>},
-    { 2, false, false, SectionId::Main,                "ETHLT_SMART_VOLDOWN_COMMAND_MAIN",          "ethlt: Smart Volume Down (Main Section)",       {}, smart_vol_adjust<false, false>},
-    { 3, false, false, SectionId::MidiEditor,          "ETHLT_SMART_VOLDOWN_COMMAND_MIDI_EDITOR",   "ethlt: Smart Volume Down (Midi Editor)",        {}, smart_midi_vel_adjust<false, false>},
-    { 4, false, false, SectionId::Main,                "ETHLT_FINE_VOLUP_COMMAND_MAIN",             "ethlt: Fine Volume Up (Main Section)",          {}, smart_vol_adjust<true, true>},
-    { 5, false, false, SectionId::MidiEditor,          "ETHLT_FINE_VOLUP_COMMAND_MIDI_EDITOR",      "ethlt: Fine Volume Up (Midi Editor)",           {}, smart_midi_vel_adjust<true, true>},
-    { 6, false, false, SectionId::Main,                "ETHLT_FINE_VOLDOWN_COMMAND_MAIN",           "ethlt: Fine Volume Down (Main Section)",        {}, smart_vol_adjust<false, true>},
-    { 7, false, false, SectionId::MidiEditor,          "ETHLT_FINE_VOLDOWN_COMMAND_MIDI_EDITOR",    "ethlt: Fine Volume Down (Midi Editor)",         {}, smart_midi_vel_adjust<false, true>},
-    { 8, false, false, SectionId::Main,                "ETHLT_APPEND_DUPLICATE_MAIN",               "ethlt: Append Duplicate (Main Section)",        {}, append_duplicate_main},
-    { 9, false, false, SectionId::MidiEditor,          "ETHLT_APPEND_DUPLICATE_MIDI_EDITOR",        "ethlt: Append Duplicate (Midi Editor)",         {}, append_duplicate_midi_editor},
-    {10, false, false, SectionId::Main,                "ETHLT_CLEAN_ENVELOPE_POINTS",               "ethlt: Clean Envelope Points",                  {}, clean_envelope_points},
-    {11, false, false, SectionId::Main,                "ETHLT_SWITCH_TRIPET_GRID_MAIN",             "ethlt: Switch Triplet Grid (Main Section)",     {}, switch_triplet_main_grid},
-    {12, false, false, SectionId::MidiEditor,          "ETHLT_SWITCH_TRIPET_GRID_MIDI_EDITOR",      "ethlt: Switch Triplet Grid (Midi Editor)",      {}, switch_triplet_midi_grid},
-    {13, false, false, SectionId::Main,                "ETHLT_SETUP_GLOBAL_MIDISEND",               "ethlt: Create/Update Global MIDI Send Track",   {}, setup_global_midisend},
-
-    {14, false, false, SectionId::Main,                "ETHLT_SHOW_THING_UNDER_POINT",              "ethlt: Show Thing Under Point",                 {}, show_thing_under_point},
-    {15, false, false, SectionId::Main,                "ETHLT_SHOW_ALL_ENVELOPE_POINTS",            "ethlt: Show All Envelope Points",               {}, show_all_envelope_points},
-    {16, false, false, SectionId::Main,                "ETHLT_TEST_COMMAND_MAIN",                   "ethlt: Test (Main Section)",                    {}, test},
-    {17, false, false, SectionId::MidiEditor,          "ETHLT_TEST_SHOW_SELECTED_MIDI_ITEMS",       "ethlt: Show Selected MIDI Items (Midi Editor)", {}, show_selected_midi_items},
-    {18, false, false, SectionId::MidiEditor,          "ETHLT_TEST_SHOW_ALL_MIDI_ITEMS",            "ethlt: Show All MIDI Items (Midi Editor)",      {}, show_all_midi_items},
-    {19, false, false, SectionId::Main,                "ETHLT_TEST_SHOW_TRACK_UI",                  "ethlt: Show Track UI (Main Section)",           {}, show_track_ui},
-    {20, false, false, SectionId::MidiEventListEditor, "ETHLT_TEST_COMMAND_MIDI_EVENT_LIST_EDITOR", "ethlt: Test (Midi Event List Editor Section)",  {}, test},
-    {21, false, false, SectionId::MidiInlineEditor,    "ETHLT_TEST_COMMAND_MIDI_INLINE_EDITOR",     "ethlt: Test (Midi Inline Editor Section)",      {}, test},
-    {22, false, false, SectionId::MediaExplorer,       "ETHLT_TEST_COMMAND_MEDIA_EXPLORER",         "ethlt: Test (Media Explorer Section)",          {}, test}
+constexpr ActionInfo actions[] = {
+    {false, SectionId::Main,                "ETHLT_SMART_VOLUP_COMMAND_MAIN",            "ethlt: Smart Volume Up (Main Section)",         smart_vol_adjust<true, false>},
+    {false, SectionId::MidiEditor,          "ETHLT_SMART_VOLUP_COMMAND_MIDI_EDITOR",     "ethlt: Smart Volume Up (Midi Editor)",          smart_midi_vel_adjust<true, false>},
+    {false, SectionId::Main,                "ETHLT_SMART_VOLDOWN_COMMAND_MAIN",          "ethlt: Smart Volume Down (Main Section)",       smart_vol_adjust<false, false>},
+    {false, SectionId::MidiEditor,          "ETHLT_SMART_VOLDOWN_COMMAND_MIDI_EDITOR",   "ethlt: Smart Volume Down (Midi Editor)",        smart_midi_vel_adjust<false, false>},
+    {false, SectionId::Main,                "ETHLT_FINE_VOLUP_COMMAND_MAIN",             "ethlt: Fine Volume Up (Main Section)",          smart_vol_adjust<true, true>},
+    {false, SectionId::MidiEditor,          "ETHLT_FINE_VOLUP_COMMAND_MIDI_EDITOR",      "ethlt: Fine Volume Up (Midi Editor)",           smart_midi_vel_adjust<true, true>},
+    {false, SectionId::Main,                "ETHLT_FINE_VOLDOWN_COMMAND_MAIN",           "ethlt: Fine Volume Down (Main Section)",        smart_vol_adjust<false, true>},
+    {false, SectionId::MidiEditor,          "ETHLT_FINE_VOLDOWN_COMMAND_MIDI_EDITOR",    "ethlt: Fine Volume Down (Midi Editor)",         smart_midi_vel_adjust<false, true>},
+    {false, SectionId::Main,                "ETHLT_APPEND_DUPLICATE_MAIN",               "ethlt: Append Duplicate (Main Section)",        append_duplicate_main},
+    {false, SectionId::MidiEditor,          "ETHLT_APPEND_DUPLICATE_MIDI_EDITOR",        "ethlt: Append Duplicate (Midi Editor)",         append_duplicate_midi_editor},
+    {false, SectionId::Main,                "ETHLT_APPEND_DUPLICATE_TIMES_MAIN",         "ethlt: Append Duplicate N Times (Main Section)", append_duplicate_times_main},
+    {false, SectionId::MidiEditor,          "ETHLT_APPEND_DUPLICATE_TIMES_MIDI_EDITOR",  "ethlt: Append Duplicate N Times (Midi Editor)",  append_duplicate_times_midi_editor},
+    {false, SectionId::Main,                "ETHLT_APPEND_DUPLICATE_TO_TIMESEL_MAIN",    "ethlt: Append Duplicate Until Time Selection End (Main Section)", append_duplicate_to_time_selection_main},
+    {false, SectionId::MidiEditor,          "ETHLT_APPEND_DUPLICATE_TO_TIMESEL_MIDI_EDITOR", "ethlt: Append Duplicate Until Time Selection End (Midi Editor)", append_duplicate_to_time_selection_midi_editor},
+    {false, SectionId::Main,                "ETHLT_NORMALIZE_ITEMS_LOUDNESS",            "ethlt: Normalize Selected Items Loudness",      normalize_selected_items_loudness},
+    {false, SectionId::Main,                "ETHLT_TOGGLE_LIVE_TRACK_METERS",            "ethlt: Toggle Live Meters On Selected Tracks",  toggle_live_track_meters, is_live_track_metering},
+    {false, SectionId::Main,                "ETHLT_STEP_TRACKS_TOWARD_TARGET_LEVEL",     "ethlt: Step Selected Tracks Toward Target Level", step_tracks_toward_target_level},
+    {false, SectionId::Main,                "ETHLT_CLEAN_ENVELOPE_POINTS",               "ethlt: Clean Envelope Points",                  clean_envelope_points},
+    {false, SectionId::Main,                "ETHLT_TOGGLE_CLEAN_RECORDED_AUTOMATION",    "ethlt: Toggle Clean Automation After Recording", toggle_clean_recorded_automation, is_cleaning_recorded_automation},
+    {false, SectionId::Main,                "ETHLT_EXPORT_AUTOMATION",                   "ethlt: Export Automation To File",              export_automation},
+    {false, SectionId::Main,                "ETHLT_IMPORT_AUTOMATION",                   "ethlt: Import Automation From File",            import_automation},
+    {false, SectionId::Main,                "ETHLT_SWITCH_TRIPET_GRID_MAIN",             "ethlt: Switch Triplet Grid (Main Section)",     switch_triplet_main_grid},
+    {false, SectionId::MidiEditor,          "ETHLT_SWITCH_TRIPET_GRID_MIDI_EDITOR",      "ethlt: Switch Triplet Grid (Midi Editor)",      switch_triplet_midi_grid},
+    {false, SectionId::Main,                "ETHLT_SETUP_GLOBAL_MIDISEND",               "ethlt: Create/Update Global MIDI Send Track",   setup_global_midisend},
+    {false, SectionId::Main,                "ETHLT_DETECT_KICK_TRIGGERS",                "ethlt: Detect Kick Hits To Global MIDI Send",   detect_kick_triggers},
+    {false, SectionId::Main,                "ETHLT_RENDER_PUMP_ENVELOPE",                "ethlt: Render Pump Envelope From Triggers",     render_pump_envelope},
+    {false, SectionId::Main,                "ETHLT_DUMP_ACTION_STATS",                   "ethlt: Dump Action Stats",                      dump_action_stats},
+    {false, SectionId::Main,                "ETHLT_TOGGLE_LOG_TO_FILE",                  "ethlt: Toggle Logging To File",                 toggle_log_to_file, is_logging_to_file},
+#ifdef ETHLT_API_PROFILING
+    {false, SectionId::Main,                "ETHLT_DUMP_API_PROFILE",                    "ethlt: Dump REAPER API Call Profile",           dump_api_profile},
+#endif
+#ifdef ETHLT_ENABLE_TRACING
+    {false, SectionId::Main,                "ETHLT_TOGGLE_TRACING",                      "ethlt: Toggle Action Tracing",                  toggle_tracing, is_tracing},
+    {false, SectionId::Main,                "ETHLT_WRITE_TRACE_FILE",                    "ethlt: Write Action Trace File",                write_trace_file},
+#endif
+#ifndef NDEBUG
+    {false, SectionId::Main,                "ETHLT_SHOW_THING_UNDER_POINT",              "ethlt: Show Thing Under Point",                 show_thing_under_point},
+    {false, SectionId::Main,                "ETHLT_SHOW_ALL_ENVELOPE_POINTS",            "ethlt: Show All Envelope Points",               show_all_envelope_points},
+    {false, SectionId::Main,                "ETHLT_TEST_COMMAND_MAIN",                   "ethlt: Test (Main Section)",                    test},
+    {false, SectionId::MidiEditor,          "ETHLT_TEST_SHOW_SELECTED_MIDI_ITEMS",       "ethlt: Show Selected MIDI Items (Midi Editor)", show_selected_midi_items},
+    {false, SectionId::MidiEditor,          "ETHLT_TEST_SHOW_ALL_MIDI_ITEMS",            "ethlt: Show All MIDI Items (Midi Editor)",      show_all_midi_items},
+    {false, SectionId::Main,                "ETHLT_TEST_SHOW_TRACK_UI",                  "ethlt: Show Track UI (Main Section)",           show_track_ui},
+    {false, SectionId::MidiEventListEditor, "ETHLT_TEST_COMMAND_MIDI_EVENT_LIST_EDITOR", "ethlt: Test (Midi Event List Editor Section)",  test},
+    {false, SectionId::MidiInlineEditor,    "ETHLT_TEST_COMMAND_MIDI_INLINE_EDITOR",     "ethlt: Test (Midi Inline Editor Section)",      test},
+    {false, SectionId::MediaExplorer,       "ETHLT_TEST_COMMAND_MEDIA_EXPLORER",         "ethlt: Test (Media Explorer Section)",          test},
+#endif
 };
 // clang-format on
 
+constexpr int ACTION_COUNT = static_cast<int>(std::size(actions));
+
+constexpr bool any_action_toggles() noexcept
+{
+    for (const ActionInfo &action_info : actions)
+        if (action_info.run_on_timer || action_info.toggle_state)
+            return true;
+    return false;
+}
+
+// runtime state of each action, indexed like actions[]
+custom_action_register_t action_regs[ACTION_COUNT];
+bool toggle_states[ACTION_COUNT];
+TaskId timer_tasks[ACTION_COUNT]; // scheduler task of each running run_on_timer action
+
+// dense command_id -> action index map, REAPER hands out our command ids (nearly) contiguously
+int first_command_id {0};
+std::vector<int8_t> action_index_table; // -1 for ids in range that aren't ours
+
+static_assert(ACTION_COUNT <= INT8_MAX, "action_index_table entries overflow");
+
+// returns -1 for foreign command ids, one range check for the common case
+inline int find_action(int command) noexcept
+{
+    const unsigned offset = static_cast<unsigned>(command - first_command_id);
+    if (offset >= action_index_table.size())
+        return -1;
+    return action_index_table[offset];
+}
+
+void build_action_index_table(const int (&command_ids)[ACTION_COUNT])
+{
+    int min_id = INT_MAX, max_id = 0;
+    for (int command_id : command_ids) {
+        if (command_id <= 0) // registration failed
+            continue;
+        min_id = min(min_id, command_id);
+        max_id = max(max_id, command_id);
+    }
+    if (max_id == 0)
+        return;
+
+    first_command_id = min_id;
+    action_index_table.assign(max_id - min_id + 1, -1);
+    for (int i = 0; i < ACTION_COUNT; i++)
+        if (command_ids[i] > 0)
+            action_index_table[command_ids[i] - min_id] = static_cast<int8_t>(i);
+}
+
 // hInstance is declared in header file my_plugin.hpp
 // defined here
 REAPER_PLUGIN_HINSTANCE hInstance {nullptr}; // used for dialogs, if any
@@ -81,15 +177,12 @@ REAPER_PLUGIN_HINSTANCE hInstance {nullptr}; // used for dialogs, if any
 // REAPER calls this to check my plugin toggle state
 int ToggleActionCallback(int command)
 {
-    for (ActionInfo &action_info : actions) {
-        if (command == action_info.command_id) {
-            if (action_info.toggle_state)
-                return 1;
-            return 0;
-        }
-    }
-    // not quite our command_id
-    return -1;
+    int index = find_action(command);
+    if (index < 0) // not quite our command_id
+        return -1;
+    if (actions[index].toggle_state)
+        return actions[index].toggle_state() ? 1 : 0;
+    return toggle_states[index] ? 1 : 0;
 }
 
 // this gets called when my plugin action is run (e.g. from action list)
@@ -102,30 +195,151 @@ bool OnAction(KbdSectionInfo *sec, int command, int val, int valhw, int relmode,
     (void)relmode;
     (void)hwnd;
 
-    for (ActionInfo &action_info : actions) {
-        // check command
-        if (command != action_info.command_id)
-            continue;
+    int index = find_action(command);
+    if (index < 0) {
+        // pipelines from the config file, registered on top of the fixed table and timed in the
+        // stats slots after it; run_pipeline has its own arena
+        const int pipeline = find_pipeline_action(command);
+        if (pipeline < 0)
+            return false;
+        {
+            ScopedActionTimer timer {ACTION_COUNT + pipeline};
+            ETHLT_TRACE_SCOPE(pipeline_action_name(pipeline));
+            run_pipeline_action(pipeline);
+        }
+        log_flush();
+        return true;
+    }
+
+    const ActionInfo &action_info = actions[index];
 
-        // register action-specific function to timer
-        if (action_info.run_on_timer) {
-            action_info.toggle_state = !action_info.toggle_state; // flip state on/off
-
-            if (action_info.toggle_state) {
-                plugin_register("timer",
-                                (void *)action_info.onaction.target<void()>()); // "reaper.defer(action)"
-            } else {
-                plugin_register(
-                    "-timer",
-                    (void *)action_info.onaction.target<void()>()); // "reaper.atexit(shutdown)"
-            }
+    // run action-specific function on every timer tick
+    if (action_info.run_on_timer) {
+        toggle_states[index] = !toggle_states[index]; // flip state on/off
+
+        if (toggle_states[index]) {
+            // "reaper.defer(action)"
+            timer_tasks[index] = schedule_on_main([onaction = action_info.onaction](TaskContext &) {
+                ScopedActionArena arena;
+                onaction();
+                return TaskStatus::Continue;
+            });
         } else {
-            // ShowConsoleMsg(("________________________________\n" + std::string(action_info.action_name) + " called\n").c_str()); // DEBUG
+            // "reaper.atexit(shutdown)"
+            main_scheduler().cancel(timer_tasks[index]);
+            timer_tasks[index] = INVALID_TASK_ID;
+        }
+    } else {
+        {
+            ScopedActionTimer timer {index};
+            ScopedActionArena arena; // reset before the timer stops, so its high-water mark is this action's
+            ETHLT_TRACE_SCOPE(action_info.action_name);
             action_info.onaction(); // Call the action-specific function
         }
-        return true;
+        log_flush(); // one console/file write per action, outside of its timing
     }
-    return false;
+    return true;
+}
+
+int find_action_by_name(const char *command_name)
+{
+    if (!command_name)
+        return -1;
+    for (int i = 0; i < ACTION_COUNT; i++)
+        if (strcmp(actions[i].command_name, command_name) == 0)
+            return i;
+    return -1;
+}
+
+// the fixed actions, then the pipeline actions
+const char *stats_action_name(int index)
+{
+    return index < ACTION_COUNT ? actions[index].action_name : pipeline_action_name(index - ACTION_COUNT);
+}
+
+// print one line per action that ran since startup
+void dump_action_stats()
+{
+    char line[256];
+    snprintf(line, sizeof(line), "%-50s %7s %10s %10s %10s %10s %10s %10s\n", "action", "count", "mean ms",
+             "p50 ms", "p95 ms", "max ms", "objects", "arena KB");
+    std::string report = line;
+    for (int i = 0; i < ACTION_COUNT + pipeline_action_count(); i++) {
+        const ActionStats *stats = get_action_stats(i);
+        if (!stats || !stats->count)
+            continue;
+        snprintf(line, sizeof(line), "%-50s %7llu %10.3f %10.3f %10.3f %10.3f %10llu %10.1f\n",
+                 stats_action_name(i), static_cast<unsigned long long>(stats->count),
+                 stats->total_us / stats->count / 1000, latency_quantile_us(*stats, 0.5) / 1000,
+                 latency_quantile_us(*stats, 0.95) / 1000, stats->max_us / 1000,
+                 static_cast<unsigned long long>(stats->objects_touched), stats->arena_high_water / 1024.0);
+        report += line;
+    }
+    ShowConsoleMsg(report.c_str());
+}
+
+#ifdef ETHLT_API_PROFILING
+// print the REAPER API calls each action made, most expensive first, then reset the counters
+void dump_api_profile()
+{
+    char line[256];
+    std::string report;
+    std::vector<int> order(profiled_api_count());
+
+    for (int action = -1; action < ACTION_COUNT + pipeline_action_count(); action++) {
+        for (int i = 0; i < profiled_api_count(); i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [action](int a, int b) {
+            return profiled_api_stats(action, a).total_us > profiled_api_stats(action, b).total_us;
+        });
+        if (order.empty() || !profiled_api_stats(action, order[0]).calls)
+            continue;
+
+        report += action < 0 ? "(outside of actions)" : stats_action_name(action);
+        snprintf(line, sizeof(line), "\n    %-32s %10s %12s %12s\n", "api", "calls", "total ms", "us/call");
+        report += line;
+        for (int api : order) {
+            const ApiCallStats &stats = profiled_api_stats(action, api);
+            if (!stats.calls)
+                break;
+            snprintf(line, sizeof(line), "    %-32s %10llu %12.3f %12.3f\n", profiled_api_name(api),
+                     static_cast<unsigned long long>(stats.calls), stats.total_us / 1000,
+                     stats.total_us / stats.calls);
+            report += line;
+        }
+    }
+    ShowConsoleMsg(report.empty() ? "No REAPER API calls recorded\n" : report.c_str());
+    reset_api_profile();
+}
+#endif
+
+const char *defstring_GetActionStats =
+    "bool" // return type
+    "\0"   // delimiter ('separator')
+    // input parameter types
+    "const char*,int*,double*,double*,double*,double*,int*"
+    "\0"
+    // input parameter names
+    "command_name,countOut,meanMsOut,p50MsOut,p95MsOut,maxMsOut,objectsTouchedOut"
+    "\0"
+    "returns the latency statistics of a toolkit action since startup, "
+    "looked up by its command name (e.g. \"ETHLT_CLEAN_ENVELOPE_POINTS\").\n"
+    "Quantiles are bucket upper bounds of a power-of-two histogram.\n";
+
+bool GetActionStats(const char *command_name, int *countOut, double *meanMsOut, double *p50MsOut,
+                    double *p95MsOut, double *maxMsOut, int *objectsTouchedOut)
+{
+    const ActionStats *stats = get_action_stats(find_action_by_name(command_name));
+    if (!stats)
+        return false;
+
+    *countOut = static_cast<int>(stats->count);
+    *meanMsOut = stats->count ? stats->total_us / stats->count / 1000 : 0;
+    *p50MsOut = latency_quantile_us(*stats, 0.5) / 1000;
+    *p95MsOut = latency_quantile_us(*stats, 0.95) / 1000;
+    *maxMsOut = stats->max_us / 1000;
+    *objectsTouchedOut = static_cast<int>(stats->objects_touched);
+    return true;
 }
 
 // definition string for example API function
@@ -196,19 +410,24 @@ void GetVersion(int *majorOut, int *minorOut, int *patchOut, int *tweakOut, char
 // function to register my plugins 'stuff' with REAPER
 void Register()
 {
-    bool anyone_run_on_timer {false};
     // register each action
-    for (ActionInfo &action_info : actions) {
+    int command_ids[ACTION_COUNT];
+    for (int i = 0; i < ACTION_COUNT; i++) {
         // register action name and get command_id
-        action_info.action = {static_cast<int>(action_info.section_id), action_info.command_name,
-                              action_info.action_name, nullptr};
-        action_info.command_id = plugin_register("custom_action", &action_info.action);
-
-        // register action on/off state and callback function
-        if (action_info.run_on_timer)
-            anyone_run_on_timer = true;
+        action_regs[i] = {static_cast<int>(actions[i].section_id), actions[i].command_name,
+                          actions[i].action_name, nullptr};
+        command_ids[i] = plugin_register("custom_action", &action_regs[i]);
     }
-    if (anyone_run_on_timer)
+    build_action_index_table(command_ids);
+    init_log();
+    register_pipeline_actions(); // after the log, it reports bad lines of the pipeline file
+    init_action_stats(ACTION_COUNT + pipeline_action_count());
+#ifdef ETHLT_API_PROFILING
+    install_api_profiler(ACTION_COUNT + pipeline_action_count());
+#endif
+
+    // register action on/off state and callback function
+    if constexpr (any_action_toggles())
         plugin_register("toggleaction", (void *)ToggleActionCallback);
 
     // register run action/command
@@ -227,16 +446,59 @@ void Register()
     plugin_register("APIdef_" STRINGIZE(API_ID)"_GetVersion", (void *)defstring_GetVersion);
     plugin_register("APIvararg_" STRINGIZE(API_ID)"_GetVersion",
                                            (void *)&InvokeReaScriptAPI<&GetVersion>);
+
+    plugin_register("API_" STRINGIZE(API_ID)"_GetActionStats", (void *)GetActionStats);
+    plugin_register("APIdef_" STRINGIZE(API_ID)"_GetActionStats", (void *)defstring_GetActionStats);
+    plugin_register("APIvararg_" STRINGIZE(API_ID)"_GetActionStats",
+                                           (void *)&InvokeReaScriptAPI<&GetActionStats>);
+
+    plugin_register("API_" STRINGIZE(API_ID)"_StepVolumes", (void *)StepVolumes);
+    plugin_register("APIdef_" STRINGIZE(API_ID)"_StepVolumes", (void *)defstring_StepVolumes);
+    plugin_register("APIvararg_" STRINGIZE(API_ID)"_StepVolumes",
+                                           (void *)&InvokeReaScriptAPI<&StepVolumes>);
+
+    plugin_register("API_" STRINGIZE(API_ID)"_StepVelocities", (void *)StepVelocities);
+    plugin_register("APIdef_" STRINGIZE(API_ID)"_StepVelocities", (void *)defstring_StepVelocities);
+    plugin_register("APIvararg_" STRINGIZE(API_ID)"_StepVelocities",
+                                           (void *)&InvokeReaScriptAPI<&StepVelocities>);
+
+    plugin_register("API_" STRINGIZE(API_ID)"_StepEnvelopeValues", (void *)StepEnvelopeValues);
+    plugin_register("APIdef_" STRINGIZE(API_ID)"_StepEnvelopeValues", (void *)defstring_StepEnvelopeValues);
+    plugin_register("APIvararg_" STRINGIZE(API_ID)"_StepEnvelopeValues",
+                                           (void *)&InvokeReaScriptAPI<&StepEnvelopeValues>);
+
+    plugin_register("API_" STRINGIZE(API_ID)"_AdjustTracksVolume", (void *)AdjustTracksVolume);
+    plugin_register("APIdef_" STRINGIZE(API_ID)"_AdjustTracksVolume", (void *)defstring_AdjustTracksVolume);
+    plugin_register("APIvararg_" STRINGIZE(API_ID)"_AdjustTracksVolume",
+                                           (void *)&InvokeReaScriptAPI<&AdjustTracksVolume>);
+
+    plugin_register("API_" STRINGIZE(API_ID)"_AdjustItemsVolume", (void *)AdjustItemsVolume);
+    plugin_register("APIdef_" STRINGIZE(API_ID)"_AdjustItemsVolume", (void *)defstring_AdjustItemsVolume);
+    plugin_register("APIvararg_" STRINGIZE(API_ID)"_AdjustItemsVolume",
+                                           (void *)&InvokeReaScriptAPI<&AdjustItemsVolume>);
+
+    plugin_register("API_" STRINGIZE(API_ID)"_AdjustNotesVelocity", (void *)AdjustNotesVelocity);
+    plugin_register("APIdef_" STRINGIZE(API_ID)"_AdjustNotesVelocity", (void *)defstring_AdjustNotesVelocity);
+    plugin_register("APIvararg_" STRINGIZE(API_ID)"_AdjustNotesVelocity",
+                                           (void *)&InvokeReaScriptAPI<&AdjustNotesVelocity>);
+
+    plugin_register("API_" STRINGIZE(API_ID)"_RunPipeline", (void *)RunPipeline);
+    plugin_register("APIdef_" STRINGIZE(API_ID)"_RunPipeline", (void *)defstring_RunPipeline);
+    plugin_register("APIvararg_" STRINGIZE(API_ID)"_RunPipeline",
+                                           (void *)&InvokeReaScriptAPI<&RunPipeline>);
 }
 
 // shutdown, time to exit
 void Unregister()
 {
     // unregister each action
-    for (ActionInfo &action_info : actions)
-        plugin_register("-custom_action", &action_info.action);
+    for (custom_action_register_t &action_reg : action_regs)
+        plugin_register("-custom_action", &action_reg);
     plugin_register("-toggleaction", (void *)ToggleActionCallback);
     plugin_register("-hookcommand2", (void *)OnAction);
+    unregister_pipeline_actions();
+    stop_track_metering();
+    shutdown_main_scheduler();
 }
 
 } // namespace PROJECT_NAME
@@ -0,0 +1,165 @@
+#include "log.h"
+#include "mapped_file.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+#include <reaper_plugin_functions.h>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+constexpr const char *EXTSTATE_SECTION = "ethlt_reaper_toolkit";
+constexpr const char *EXTSTATE_LOG_TO_FILE = "log_to_file";
+
+// ethlt_toolkit.log is rotated to .1, .2 once it grows past the limit
+constexpr long LOG_FILE_MAX_BYTES = 1 << 20;
+constexpr int LOG_FILE_GENERATIONS = 3;
+
+std::mutex log_mutex;
+std::string log_buffer;
+std::atomic<bool> log_to_file {false};
+
+const char *level_name(LogLevel level) noexcept
+{
+    switch (level) {
+    case LogLevel::Trace:
+        return "TRACE";
+    case LogLevel::Debug:
+        return "DEBUG";
+    case LogLevel::Info:
+        return "INFO";
+    case LogLevel::Warn:
+        return "WARN";
+    case LogLevel::Error:
+        return "ERROR";
+    default:
+        return "";
+    }
+}
+
+// the resource path is UTF-8
+std::filesystem::path log_file_path(int generation)
+{
+    std::string path = std::string(GetResourcePath()) + "/ethlt_toolkit.log";
+    if (generation)
+        path += "." + std::to_string(generation);
+    return std::filesystem::u8path(path);
+}
+
+void rotate_log_files()
+{
+    std::error_code ec; // a generation that does not exist yet is fine
+    std::filesystem::remove(log_file_path(LOG_FILE_GENERATIONS - 1), ec);
+    for (int i = LOG_FILE_GENERATIONS - 2; i >= 0; i--)
+        std::filesystem::rename(log_file_path(i), log_file_path(i + 1), ec);
+}
+
+void write_log_file(const std::string &text)
+{
+    FILE *file = open_file(log_file_path(0), "ab");
+    if (!file) { // rather show than drop
+        ShowConsoleMsg(text.c_str());
+        return;
+    }
+    fwrite(text.data(), 1, text.size(), file);
+    const long size = ftell(file);
+    fclose(file);
+
+    if (size > LOG_FILE_MAX_BYTES)
+        rotate_log_files();
+}
+
+} // anonymous namespace
+
+void log_printf(LogLevel level, const char *fmt, ...)
+{
+    char stack_buf[512];
+    std::string heap_buf;
+    const char *text = stack_buf;
+
+    va_list args, args_copy;
+    va_start(args, fmt);
+    va_copy(args_copy, args);
+    int len = vsnprintf(stack_buf, sizeof(stack_buf), fmt, args);
+    if (len >= static_cast<int>(sizeof(stack_buf))) {
+        heap_buf.resize(len + 1);
+        vsnprintf(heap_buf.data(), len + 1, fmt, args_copy);
+        text = heap_buf.c_str();
+    }
+    va_end(args_copy);
+    va_end(args);
+    if (len < 0)
+        return;
+
+    std::lock_guard<std::mutex> lock {log_mutex};
+    if (log_to_file.load(std::memory_order_relaxed)) {
+        char prefix[48];
+        const std::time_t now = std::time(nullptr);
+        std::tm local {};
+#ifdef _WIN32
+        localtime_s(&local, &now); // std::localtime shares one buffer between threads
+#else
+        localtime_r(&now, &local);
+#endif
+        const size_t n = std::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S ", &local);
+        log_buffer.append(prefix, n);
+        log_buffer += level_name(level);
+        log_buffer += ' ';
+    } else if (level >= LogLevel::Warn) {
+        log_buffer += level_name(level);
+        log_buffer += ": ";
+    }
+    log_buffer.append(text, len);
+    if (!len || text[len - 1] != '\n')
+        log_buffer += '\n';
+}
+
+void log_flush()
+{
+    std::string text;
+    {
+        std::lock_guard<std::mutex> lock {log_mutex};
+        if (log_buffer.empty())
+            return;
+        text.swap(log_buffer);
+    }
+
+    if (log_to_file.load(std::memory_order_relaxed))
+        write_log_file(text);
+    else
+        ShowConsoleMsg(text.c_str());
+}
+
+void init_log()
+{
+    log_to_file = strcmp(GetExtState(EXTSTATE_SECTION, EXTSTATE_LOG_TO_FILE), "1") == 0;
+}
+
+void toggle_log_to_file()
+{
+    log_flush(); // pending messages still go where they were meant to
+    log_to_file = !log_to_file;
+    SetExtState(EXTSTATE_SECTION, EXTSTATE_LOG_TO_FILE, log_to_file ? "1" : "0", true);
+
+    const std::string path = log_file_path(0);
+    ShowConsoleMsg((log_to_file ? "Toolkit log messages now go to " + path + "\n"
+                                : "Toolkit log messages now go to the console\n")
+                       .c_str());
+}
+
+bool is_logging_to_file()
+{
+    return log_to_file;
+}
+
+} // namespace PROJECT_NAME
@@ -0,0 +1,57 @@
+#pragma once
+#include "config.h"
+
+// ETHLT_LOG(Level, fmt, ...) formats a message into an in-memory buffer that is flushed once per
+// action (and once per timer tick), either to the ReaScript console or to a rotating log file in
+// the REAPER resource path. Levels below ETHLT_LOG_LEVEL are discarded at compile time, arguments
+// included; release builds default to Info, debug builds to Debug.
+//   ETHLT_LOG(Debug, "%d\t%d\t%f", autoitem_idx, point_idx, value);
+#define ETHLT_LOG(level, ...)                                                                                \
+    do {                                                                                                     \
+        if constexpr (::PROJECT_NAME::LogLevel::level >= ::PROJECT_NAME::COMPILED_LOG_LEVEL)                 \
+            ::PROJECT_NAME::log_printf(::PROJECT_NAME::LogLevel::level, __VA_ARGS__);                        \
+    } while (0)
+
+#ifndef ETHLT_LOG_LEVEL
+#ifdef NDEBUG
+#define ETHLT_LOG_LEVEL 2 // Info
+#else
+#define ETHLT_LOG_LEVEL 1 // Debug
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ETHLT_PRINTF_FORMAT(fmt_index, args_index) __attribute__((format(printf, fmt_index, args_index)))
+#else
+#define ETHLT_PRINTF_FORMAT(fmt_index, args_index)
+#endif
+
+namespace PROJECT_NAME
+{
+
+enum class LogLevel
+{
+    Trace = 0,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off,
+};
+
+constexpr LogLevel COMPILED_LOG_LEVEL = static_cast<LogLevel>(ETHLT_LOG_LEVEL);
+
+// use ETHLT_LOG instead, so disabled levels are compiled out; safe to call from any thread
+void log_printf(LogLevel level, const char *fmt, ...) ETHLT_PRINTF_FORMAT(2, 3);
+
+// writes the buffered messages to the current sink; main thread only
+void log_flush();
+
+// reads the persisted sink choice, call once from Register()
+void init_log();
+
+// action: switch between console and log file output, persisted across sessions
+void toggle_log_to_file();
+bool is_logging_to_file();
+
+} // namespace PROJECT_NAME
@@ -0,0 +1,44 @@
+#pragma once
+#include "config.h"
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <string_view>
+
+namespace PROJECT_NAME
+{
+
+// A read-only memory mapping of a whole file. Has no REAPER dependency, so the offline tools can
+// share it. An empty file maps to an empty view and still counts as open.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::filesystem::path &path);
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool is_open() const noexcept { return open_; }
+    std::string_view view() const noexcept { return {data_, size_}; }
+    size_t size() const noexcept { return size_; }
+
+private:
+    void close() noexcept;
+
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+#ifdef _WIN32
+    void *mapping_ = nullptr; // HANDLE of the file mapping object
+#endif
+};
+
+// fopen for paths that may not be ASCII, e.g. under the resource path of a non-ASCII user profile:
+// the narrow fopen goes through the ANSI code page on Windows, so this takes the wide API there
+FILE *open_file(const std::filesystem::path &path, const char *mode);
+
+} // namespace PROJECT_NAME
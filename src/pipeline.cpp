@@ -0,0 +1,349 @@
+#include "pipeline.h"
+#include "action_stats.h"
+#include "arena.h"
+#include "log.h"
+#include "mapped_file.h"
+#include "refresh.h"
+#include "trace.h"
+#include "actions/append_duplicate.h"
+#include "actions/clean_envelope_points.h"
+#include "core/volume.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+using core::adjust_volume;
+
+constexpr size_t MAX_PIPELINES = 32;
+
+using VolumeStep = double (*)(double);
+
+enum class StageKind
+{
+    Items,     // a volume step for each selected item
+    Tracks,    // a volume step for each selected track
+    Envelopes, // cleaning every envelope
+    Barrier    // a whole action, which changes what the stages after it see
+};
+
+struct StageInfo
+{
+    const char *name;
+    StageKind kind;
+    VolumeStep step;         // Items and Tracks
+    void (*run)() = nullptr; // Barrier
+};
+
+// clang-format off
+const StageInfo stages[] = {
+    {"item_vol_up",                         StageKind::Items,      adjust_volume<true, false>},
+    {"item_vol_down",                       StageKind::Items,      adjust_volume<false, false>},
+    {"item_vol_up_fine",                    StageKind::Items,      adjust_volume<true, true>},
+    {"item_vol_down_fine",                  StageKind::Items,      adjust_volume<false, true>},
+    {"track_vol_up",                        StageKind::Tracks,     adjust_volume<true, false>},
+    {"track_vol_down",                      StageKind::Tracks,     adjust_volume<false, false>},
+    {"track_vol_up_fine",                   StageKind::Tracks,     adjust_volume<true, true>},
+    {"track_vol_down_fine",                 StageKind::Tracks,     adjust_volume<false, true>},
+    {"clean_envelopes",                     StageKind::Envelopes,  nullptr},
+    {"append_duplicate",                    StageKind::Barrier,    nullptr, append_duplicate_main},
+    {"append_duplicate_to_time_selection",  StageKind::Barrier,    nullptr, append_duplicate_to_time_selection_main},
+};
+// clang-format on
+
+// the stages between two barriers, fused into at most one pass per kind of object, then the
+// barrier that ends them, if any
+struct Segment
+{
+    std::vector<VolumeStep> item_steps, track_steps;
+    bool clean_envelopes = false;
+    void (*barrier)() = nullptr;
+};
+
+struct Pipeline
+{
+    std::string name;
+    std::vector<Segment> segments;
+};
+
+struct PipelineAction
+{
+    Pipeline pipeline;
+    std::string command_name, action_name;
+    custom_action_register_t reg;
+    int command_id;
+};
+
+std::vector<PipelineAction> pipeline_actions; // reserved up front, reg pointers stay valid
+int min_command_id = INT_MAX, max_command_id = INT_MIN; // range of the registered ids
+
+bool is_separator(char c)
+{
+    return c == ',' || isspace(static_cast<unsigned char>(c));
+}
+
+std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && isspace(static_cast<unsigned char>(s.front())))
+        s.remove_prefix(1);
+    while (!s.empty() && isspace(static_cast<unsigned char>(s.back())))
+        s.remove_suffix(1);
+    return s;
+}
+
+// false with the offending stage name in error if one is unknown
+bool compile(std::string_view text, std::vector<Segment> &segments, std::string &error)
+{
+    segments.assign(1, Segment {});
+    size_t stage_count = 0;
+    for (size_t pos = 0; pos < text.size();) {
+        if (is_separator(text[pos])) {
+            pos++;
+            continue;
+        }
+        size_t end = pos;
+        while (end < text.size() && !is_separator(text[end]))
+            end++;
+        const std::string_view name = text.substr(pos, end - pos);
+        pos = end;
+
+        const StageInfo *stage = nullptr;
+        for (const StageInfo &info : stages) {
+            if (name == info.name)
+                stage = &info;
+        }
+        if (!stage) {
+            error = name;
+            return false;
+        }
+
+        Segment &segment = segments.back();
+        switch (stage->kind) {
+        case StageKind::Items:
+            segment.item_steps.push_back(stage->step);
+            break;
+        case StageKind::Tracks:
+            segment.track_steps.push_back(stage->step);
+            break;
+        case StageKind::Envelopes:
+            segment.clean_envelopes = true; // once is as clean as it gets
+            break;
+        case StageKind::Barrier:
+            segment.barrier = stage->run;
+            segments.emplace_back();
+            break;
+        }
+        stage_count++;
+    }
+    if (!stage_count) {
+        error = "(no stages)";
+        return false;
+    }
+    return true;
+}
+
+double apply_steps(const std::vector<VolumeStep> &steps, double vol)
+{
+    for (VolumeStep step : steps)
+        vol = step(vol);
+    return vol;
+}
+
+// everything in one undo block; the barriers' own undo points fold into it
+int run_pipeline(const Pipeline &pipeline)
+{
+    ETHLT_TRACE_SCOPE("run_pipeline");
+    ScopedActionArena arena; // the barriers' temporaries, when a script runs the pipeline
+    int touched = 0;
+    int undo_flags = 0;
+    unsigned regions = 0;
+
+    PreventUIRefresh(1);
+    Undo_BeginBlock2(nullptr);
+    for (const Segment &segment : pipeline.segments) {
+        if (!segment.item_steps.empty()) {
+            ETHLT_TRACE_SCOPE("pipeline: items");
+            // one walk over all items, GetSelectedMediaItem would walk them again per index
+            const int count = CountMediaItems(nullptr);
+            for (int i = 0; i < count; i++) {
+                MediaItem *item = GetMediaItem(nullptr, i);
+                if (!IsMediaItemSelected(item))
+                    continue;
+                const double vol = GetMediaItemInfo_Value(item, "D_VOL");
+                SetMediaItemInfo_Value(item, "D_VOL", apply_steps(segment.item_steps, vol));
+                touched++;
+            }
+            undo_flags |= UNDO_STATE_ITEMS;
+            regions |= REFRESH_ARRANGE;
+        }
+        if (!segment.track_steps.empty()) {
+            ETHLT_TRACE_SCOPE("pipeline: tracks");
+            const int count = CountTracks(nullptr);
+            for (int i = 0; i < count; i++) {
+                MediaTrack *track = GetTrack(nullptr, i);
+                if (!track || !IsTrackSelected(track))
+                    continue;
+                const double vol = GetMediaTrackInfo_Value(track, "D_VOL");
+                SetMediaTrackInfo_Value(track, "D_VOL", apply_steps(segment.track_steps, vol));
+                touched++;
+            }
+            undo_flags |= UNDO_STATE_TRACKCFG;
+            regions |= REFRESH_TRACK_CONTROLS;
+        }
+        if (segment.clean_envelopes) {
+            ETHLT_TRACE_SCOPE("pipeline: envelopes");
+            touched += clean_all_envelope_points();
+            undo_flags |= UNDO_STATE_TRACKCFG | UNDO_STATE_FXENVELOPES | UNDO_STATE_ITEMS;
+            regions |= REFRESH_ARRANGE;
+        }
+        if (segment.barrier) {
+            segment.barrier();
+            undo_flags |= UNDO_STATE_ITEMS;
+        }
+    }
+    record_objects_touched(touched);
+    Undo_EndBlock2(nullptr, pipeline.name.c_str(), undo_flags);
+    PreventUIRefresh(-1);
+    request_refresh(regions);
+    return touched;
+}
+
+std::string command_name_for(std::string_view name)
+{
+    std::string command = "ETHLT_PIPELINE_";
+    for (char c : name) {
+        const unsigned char u = static_cast<unsigned char>(c);
+        command += isalnum(u) ? static_cast<char>(toupper(u)) : '_';
+    }
+    return command;
+}
+
+// "Name = stages"; blank lines and lines starting with # are skipped
+void read_pipeline_file(std::vector<Pipeline> &pipelines)
+{
+    const std::string path = std::string(GetResourcePath()) + "/ethlt_pipelines.txt";
+    FILE *file = open_file(std::filesystem::u8path(path), "r");
+    if (!file)
+        return;
+
+    char line[1024];
+    for (int line_number = 1; fgets(line, sizeof(line), file); line_number++) {
+        const std::string_view text = trim(line);
+        if (text.empty() || text.front() == '#')
+            continue;
+
+        const size_t equals = text.find('=');
+        Pipeline pipeline;
+        std::string error;
+        if (equals != std::string_view::npos)
+            pipeline.name = trim(text.substr(0, equals));
+        if (pipeline.name.empty()) {
+            ETHLT_LOG(Warn, "%s:%d: expected \"Name = stage, stage, ...\"", path.c_str(), line_number);
+            continue;
+        }
+        if (!compile(text.substr(equals + 1), pipeline.segments, error)) {
+            ETHLT_LOG(Warn, "%s:%d: unknown pipeline stage %s", path.c_str(), line_number, error.c_str());
+            continue;
+        }
+        if (pipelines.size() == MAX_PIPELINES) {
+            ETHLT_LOG(Warn, "%s: only the first %zu pipelines are registered", path.c_str(), MAX_PIPELINES);
+            break;
+        }
+        pipelines.push_back(std::move(pipeline));
+    }
+    fclose(file);
+}
+
+} // anonymous namespace
+
+const char *defstring_RunPipeline =
+    "int" // return type
+    "\0"  // delimiter ('separator')
+    // input parameter types
+    "const char*"
+    "\0"
+    // input parameter names
+    "stages"
+    "\0"
+    "Runs the comma- or space-separated toolkit stages (e.g. \"clean_envelopes, item_vol_up_fine, "
+    "append_duplicate\") as one undo point with one redraw, fusing the per-object stages into one "
+    "pass over the selected items and tracks.\n"
+    "Returns the number of objects touched, or -1 if a stage is unknown.\n";
+
+int RunPipeline(const char *stages)
+{
+    Pipeline pipeline {"Toolkit Pipeline", {}};
+    std::string error;
+    if (!stages || !compile(stages, pipeline.segments, error))
+        return -1;
+    return run_pipeline(pipeline);
+}
+
+void register_pipeline_actions()
+{
+    std::vector<Pipeline> pipelines;
+    read_pipeline_file(pipelines);
+
+    pipeline_actions.clear();
+    pipeline_actions.reserve(pipelines.size());
+    for (Pipeline &pipeline : pipelines) {
+        PipelineAction &action = pipeline_actions.emplace_back();
+        action.command_name = command_name_for(pipeline.name);
+        action.action_name = "ethlt: Pipeline: " + pipeline.name;
+        action.pipeline = std::move(pipeline);
+        action.reg = {0, action.command_name.c_str(), action.action_name.c_str(), nullptr};
+        action.command_id = plugin_register("custom_action", &action.reg);
+        if (action.command_id > 0) {
+            min_command_id = std::min(min_command_id, action.command_id);
+            max_command_id = std::max(max_command_id, action.command_id);
+        }
+    }
+}
+
+void unregister_pipeline_actions()
+{
+    for (PipelineAction &action : pipeline_actions)
+        plugin_register("-custom_action", &action.reg);
+    pipeline_actions.clear();
+    min_command_id = INT_MAX;
+    max_command_id = INT_MIN;
+}
+
+int pipeline_action_count()
+{
+    return static_cast<int>(pipeline_actions.size());
+}
+
+const char *pipeline_action_name(int index)
+{
+    return pipeline_actions[index].action_name.c_str();
+}
+
+int find_pipeline_action(int command)
+{
+    // every command of every other plugin comes through here, most are rejected by the range
+    if (command < min_command_id || command > max_command_id)
+        return -1;
+    for (size_t i = 0; i < pipeline_actions.size(); i++) {
+        if (pipeline_actions[i].command_id == command)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void run_pipeline_action(int index)
+{
+    run_pipeline(pipeline_actions[index].pipeline);
+}
+
+} // namespace PROJECT_NAME
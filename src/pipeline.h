@@ -0,0 +1,35 @@
+#pragma once
+#include "config.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+#include <reaper_plugin_functions.h>
+
+// Pipelines chain toolkit stages into one action with one undo point and one redraw, e.g.
+//   Clean And Lift = clean_envelopes, item_vol_up_fine, item_vol_up_fine, track_vol_down
+// Stages that work object by object are fused: all item stages between two barriers (stages that
+// change which objects there are, like append_duplicate) become one pass over the selected items
+// that reads and writes each volume once, likewise for tracks. Named pipelines come from
+// ethlt_pipelines.txt in the REAPER resource path, one "Name = stage, stage, ..." per line, and
+// are registered as actions at startup; scripts run a stage list directly through RunPipeline.
+namespace PROJECT_NAME
+{
+
+extern const char *defstring_RunPipeline;
+
+// runs the comma- or space-separated stages as one undo point; returns the number of objects
+// touched, or -1 if a stage is unknown
+int RunPipeline(const char *stages);
+
+// reads the pipeline file and registers an action per valid pipeline, from Register()
+void register_pipeline_actions();
+void unregister_pipeline_actions();
+
+// the registered pipeline actions, indexed from 0; OnAction times them in the action stats slots
+// after the fixed actions
+int pipeline_action_count();
+const char *pipeline_action_name(int index);
+
+// index of the pipeline action registered under this command id, -1 if it is not one
+int find_pipeline_action(int command);
+void run_pipeline_action(int index);
+
+} // namespace PROJECT_NAME
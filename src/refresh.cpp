@@ -0,0 +1,50 @@
+#include "refresh.h"
+#include "scheduler.h"
+#include "trace.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+#include <reaper_plugin_functions.h>
+#include <climits>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+unsigned dirty_regions = 0;
+TaskId refresh_task = INVALID_TASK_ID;
+
+} // anonymous namespace
+
+void request_refresh(unsigned regions)
+{
+    if (!regions)
+        return;
+    dirty_regions |= regions;
+    // lowest priority, so the redraw comes after whatever else this tick changes
+    if (!main_scheduler().is_scheduled(refresh_task)) {
+        refresh_task = schedule_on_main(
+            [](TaskContext &) {
+                flush_refresh();
+                return TaskStatus::Done;
+            },
+            {INT_MIN, 0, 0});
+    }
+}
+
+void flush_refresh()
+{
+    const unsigned regions = dirty_regions;
+    dirty_regions = 0;
+    if (regions & (REFRESH_TRACK_CONTROLS | REFRESH_TRACK_LIST)) {
+        ETHLT_TRACE_SCOPE("TrackList_AdjustWindows");
+        // a minor update unless tracks came or went, which needs the full layout
+        TrackList_AdjustWindows(!(regions & REFRESH_TRACK_LIST));
+    }
+    if (regions & REFRESH_ARRANGE) {
+        ETHLT_TRACE_SCOPE("UpdateArrange");
+        UpdateArrange();
+    }
+}
+
+} // namespace PROJECT_NAME
@@ -0,0 +1,21 @@
+#pragma once
+#include "config.h"
+
+namespace PROJECT_NAME
+{
+
+// parts of REAPER's UI an action may have to redraw, combined as flags
+constexpr unsigned REFRESH_ARRANGE = 1;        // items, envelopes and the timeline
+constexpr unsigned REFRESH_TRACK_CONTROLS = 2; // track panels and mixer strips, e.g. faders and sends
+constexpr unsigned REFRESH_TRACK_LIST = 4;     // tracks inserted or removed, the track layout changed
+
+// Marks parts of the UI dirty instead of redrawing them right away. The redraw happens once, at the
+// end of the next UI timer tick, however many actions (key repeat, scripted batches) marked it
+// since; nothing is redrawn when nothing was marked. The MIDI editor needs no request, it redraws
+// itself when its take changes. Main thread only.
+void request_refresh(unsigned regions);
+
+// redraws what is dirty now, e.g. before something reads the UI back
+void flush_refresh();
+
+} // namespace PROJECT_NAME
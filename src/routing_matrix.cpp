@@ -0,0 +1,227 @@
+#include "routing_matrix.h"
+#include "log.h"
+#include "refresh.h"
+#include "trace.h"
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+struct SendUpdate
+{
+    MediaTrack *src;
+    int send_idx;
+    const char *parm;
+    double value;
+};
+
+struct SendRemoval
+{
+    MediaTrack *src;
+    int send_idx;
+};
+
+struct SendCreation
+{
+    MediaTrack *src, *dest;
+};
+
+bool match_name_prefix(MediaTrack *track, const char *prefix)
+{
+    char name[256];
+    if (!GetTrackName(track, name, sizeof(name)))
+        return false;
+    return strncmp(name, prefix, strlen(prefix)) == 0;
+}
+
+std::vector<MediaTrack *> resolve_selector(ReaProject *proj, const TrackSelector &selector)
+{
+    std::vector<MediaTrack *> tracks;
+
+    if (selector.kind == TrackSelector::Kind::Track) {
+        if (selector.track && ValidatePtr2(proj, selector.track, "MediaTrack*"))
+            tracks.push_back(selector.track);
+        return tracks;
+    }
+
+    int track_count = CountTracks(proj);
+    tracks.reserve(track_count);
+    for (int i = 0; i < track_count; i++) {
+        MediaTrack *track = GetTrack(proj, i);
+        if (!track)
+            continue;
+
+        switch (selector.kind) {
+        case TrackSelector::Kind::AllTracks:
+            tracks.push_back(track);
+            break;
+        case TrackSelector::Kind::SelectedTracks:
+            if (IsTrackSelected(track))
+                tracks.push_back(track);
+            break;
+        case TrackSelector::Kind::NamePrefix:
+            if (selector.name_prefix && match_name_prefix(track, selector.name_prefix))
+                tracks.push_back(track);
+            break;
+        default:
+            break;
+        }
+    }
+    return tracks;
+}
+
+// pruning goes by the channels alone, so a mapping that leaves one open would match the user's
+// own sends as well
+bool pins_channels(const SendMapping &mapping)
+{
+    return mapping.src_chan && mapping.dst_chan && mapping.midi_flags;
+}
+
+// an existing send looks like one this mapping created if its channel routing matches
+bool match_mapping_channels(MediaTrack *src, int send_idx, const SendMapping &mapping)
+{
+    return (!mapping.src_chan ||
+            static_cast<int>(GetTrackSendInfo_Value(src, 0, send_idx, "I_SRCCHAN")) == *mapping.src_chan) &&
+           (!mapping.dst_chan ||
+            static_cast<int>(GetTrackSendInfo_Value(src, 0, send_idx, "I_DSTCHAN")) == *mapping.dst_chan) &&
+           (!mapping.midi_flags ||
+            static_cast<int>(GetTrackSendInfo_Value(src, 0, send_idx, "I_MIDIFLAGS")) == *mapping.midi_flags);
+}
+
+// queue an update for every enforced parameter that differs from the existing send, which matches
+// the mapping's channels already
+int diff_send_params(MediaTrack *src, int send_idx, const SendMapping &mapping,
+                     std::vector<SendUpdate> &updates)
+{
+    size_t prev_size = updates.size();
+
+    auto diff_int = [&](const std::optional<int> &want, const char *parm) {
+        if (want && static_cast<int>(GetTrackSendInfo_Value(src, 0, send_idx, parm)) != *want)
+            updates.push_back({src, send_idx, parm, static_cast<double>(*want)});
+    };
+
+    diff_int(mapping.src_chan, "I_SRCCHAN");
+    diff_int(mapping.dst_chan, "I_DSTCHAN");
+    diff_int(mapping.midi_flags, "I_MIDIFLAGS");
+    diff_int(mapping.send_mode, "I_SENDMODE");
+    if (mapping.volume && GetTrackSendInfo_Value(src, 0, send_idx, "D_VOL") != *mapping.volume)
+        updates.push_back({src, send_idx, "D_VOL", *mapping.volume});
+
+    return updates.size() != prev_size;
+}
+
+void apply_send_params(MediaTrack *src, int send_idx, const SendMapping &mapping)
+{
+    if (mapping.src_chan)
+        SetTrackSendInfo_Value(src, 0, send_idx, "I_SRCCHAN", *mapping.src_chan);
+    if (mapping.dst_chan)
+        SetTrackSendInfo_Value(src, 0, send_idx, "I_DSTCHAN", *mapping.dst_chan);
+    if (mapping.midi_flags)
+        SetTrackSendInfo_Value(src, 0, send_idx, "I_MIDIFLAGS", *mapping.midi_flags);
+    if (mapping.send_mode)
+        SetTrackSendInfo_Value(src, 0, send_idx, "I_SENDMODE", *mapping.send_mode);
+    if (mapping.volume)
+        SetTrackSendInfo_Value(src, 0, send_idx, "D_VOL", *mapping.volume);
+}
+
+std::string describe_diff(const char *undo_desc, const RoutingDiff &diff)
+{
+    std::string desc = undo_desc;
+    const char *sep = ": ";
+    auto append = [&](int n, const char *what) {
+        if (!n)
+            return;
+        desc += sep + std::to_string(n) + (n == 1 ? " Send " : " Sends ") + what;
+        sep = ", ";
+    };
+
+    append(diff.created, "Created");
+    append(diff.updated, "Updated");
+    append(diff.removed, "Removed");
+    return desc;
+}
+
+} // anonymous namespace
+
+RoutingDiff apply_routing_spec(ReaProject *proj, const RoutingSpec &spec, const char *undo_desc)
+{
+    ETHLT_TRACE_SCOPE("apply_routing_spec");
+    RoutingDiff diff {};
+
+    const bool prune = spec.prune && pins_channels(spec.mapping);
+    if (spec.prune && !prune)
+        ETHLT_LOG(Warn, "%s: not pruning sends, the mapping leaves channel fields open", undo_desc);
+
+    std::vector<MediaTrack *> sources = resolve_selector(proj, spec.source);
+    std::vector<MediaTrack *> dests = resolve_selector(proj, spec.destination);
+    if (sources.empty() || (dests.empty() && !prune))
+        return diff;
+
+    std::vector<SendUpdate> updates;
+    std::vector<SendRemoval> removals; // ascending send index per source
+    std::vector<SendCreation> creations;
+    std::unordered_set<MediaTrack *> dest_set(dests.begin(), dests.end());
+    std::unordered_set<MediaTrack *> matched; // destinations with a send of this mapping
+
+    // diff pass: one read of each source's send list, no writes. Only sends whose channels match
+    // the mapping are its own; other sends to the same destination are the user's and stay as they are
+    for (MediaTrack *src : sources) {
+        ETHLT_TRACE_SCOPE("diff sends");
+        matched.clear();
+
+        int send_count = GetTrackNumSends(src, 0);
+        for (int j = 0; j < send_count; j++) {
+            auto *dest = static_cast<MediaTrack *>(GetSetTrackSendInfo(src, 0, j, "P_DESTTRACK", nullptr));
+            if (!dest || !match_mapping_channels(src, j, spec.mapping))
+                continue;
+
+            if (dest_set.count(dest)) {
+                if (matched.insert(dest).second)
+                    diff.updated += diff_send_params(src, j, spec.mapping, updates);
+            } else if (prune) {
+                removals.push_back({src, j});
+            }
+        }
+
+        for (MediaTrack *dest : dests) {
+            if (dest != src && !matched.count(dest))
+                creations.push_back({src, dest});
+        }
+    }
+
+    diff.removed = static_cast<int>(removals.size());
+    diff.created = static_cast<int>(creations.size());
+    if (diff.empty())
+        return diff;
+
+    // apply pass: updates keep send indices stable, removals run backwards, creations append
+    ETHLT_TRACE_SCOPE("apply sends");
+    PreventUIRefresh(1);
+    Undo_BeginBlock2(proj);
+
+    for (const SendUpdate &update : updates)
+        SetTrackSendInfo_Value(update.src, 0, update.send_idx, update.parm, update.value);
+
+    for (auto it = removals.rbegin(); it != removals.rend(); ++it)
+        RemoveTrackSend(it->src, 0, it->send_idx);
+
+    for (const SendCreation &creation : creations) {
+        int send_idx = CreateTrackSend(creation.src, creation.dest);
+        if (send_idx >= 0)
+            apply_send_params(creation.src, send_idx, spec.mapping);
+    }
+
+    Undo_EndBlock2(proj, describe_diff(undo_desc, diff).c_str(), UNDO_STATE_TRACKCFG);
+    PreventUIRefresh(-1);
+    request_refresh(REFRESH_TRACK_CONTROLS);
+
+    return diff;
+}
+
+} // namespace PROJECT_NAME
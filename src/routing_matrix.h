@@ -0,0 +1,61 @@
+#pragma once
+#include "config.h"
+#include "reaper_plugin_functions.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+#include <optional>
+
+namespace PROJECT_NAME
+{
+
+// picks the tracks on one side of a routing rule
+struct TrackSelector
+{
+    enum class Kind
+    {
+        Track,          // a single track
+        AllTracks,      // every track in the project
+        SelectedTracks, // currently selected tracks
+        NamePrefix      // tracks whose name starts with name_prefix
+    };
+
+    Kind kind;
+    MediaTrack *track = nullptr;
+    const char *name_prefix = nullptr;
+};
+
+// send parameters enforced by a rule, named after their GetTrackSendInfo_Value counterparts;
+// parameters left empty keep whatever REAPER or the user set on the send
+struct SendMapping
+{
+    std::optional<int> src_chan;   // I_SRCCHAN, -1 for no audio
+    std::optional<int> dst_chan;   // I_DSTCHAN
+    std::optional<int> midi_flags; // I_MIDIFLAGS
+    std::optional<int> send_mode;  // I_SENDMODE, 0: post-fader, 1: pre-fx, 3: post-fx
+    std::optional<double> volume;  // D_VOL
+};
+
+// every source track sends to every destination track (except itself) with the given mapping; an
+// existing send counts as the mapping's own only if its channels match the mapping's, otherwise a
+// new send is created next to it
+struct RoutingSpec
+{
+    TrackSelector source, destination;
+    SendMapping mapping;
+
+    // also remove sends from the sources that match the mapping's channels but whose destination
+    // is no longer selected; ignored unless the mapping sets src_chan, dst_chan and midi_flags
+    bool prune = false;
+};
+
+struct RoutingDiff
+{
+    int created, updated, removed;
+
+    constexpr bool empty() const noexcept { return created == 0 && updated == 0 && removed == 0; }
+};
+
+// Diffs the spec against the existing sends and applies only the minimal creates, updates and
+// removals as one undo point named after undo_desc. An unchanged spec touches nothing.
+RoutingDiff apply_routing_spec(ReaProject *proj, const RoutingSpec &spec, const char *undo_desc);
+
+} // namespace PROJECT_NAME
@@ -0,0 +1,196 @@
+#include "scheduler.h"
+#include "log.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+#include <reaper_plugin_functions.h>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace PROJECT_NAME
+{
+
+Scheduler::Scheduler(std::function<double()> clock, double tick_budget_ms)
+    : clock_(std::move(clock)), tick_budget_(tick_budget_ms / 1000)
+{
+}
+
+TaskId Scheduler::schedule(TaskFn fn, const TaskOptions &options)
+{
+    Task task {++last_id_,
+               options.priority,
+               options.budget_ms / 1000,
+               options.interval_ms / 1000,
+               clock_(),
+               std::move(fn),
+               false};
+
+    pending_.push_back(std::move(task));
+    if (!ticking_)
+        merge_pending();
+    return last_id_;
+}
+
+bool Scheduler::cancel(TaskId id)
+{
+    Task *task = find(id);
+    if (!task || task->cancelled)
+        return false;
+
+    task->cancelled = true;
+    if (!ticking_) {
+        tasks_.erase(std::remove_if(tasks_.begin(), tasks_.end(), [](const Task &t) { return t.cancelled; }),
+                     tasks_.end());
+    }
+    return true;
+}
+
+void Scheduler::cancel_all()
+{
+    for (Task &task : tasks_)
+        task.cancelled = true;
+    for (Task &task : pending_)
+        task.cancelled = true;
+    if (!ticking_) {
+        tasks_.clear();
+        pending_.clear();
+    }
+}
+
+bool Scheduler::is_scheduled(TaskId id) const
+{
+    const Task *task = find(id);
+    return task && !task->cancelled;
+}
+
+size_t Scheduler::size() const
+{
+    size_t n = 0;
+    for (const Task &task : tasks_)
+        n += !task.cancelled;
+    for (const Task &task : pending_)
+        n += !task.cancelled;
+    return n;
+}
+
+void Scheduler::tick()
+{
+    if (ticking_) // re-entered from a task, e.g. through a modal dialog
+        return;
+
+    ticking_ = true;
+    const double tick_start = clock_();
+
+    // a tick that ran out of budget is picked up where it stopped, so the tasks behind a slow one
+    // get their turn instead of the scan restarting at the highest priority every time
+    const size_t n = tasks_.size();
+    size_t start = 0;
+    for (size_t i = 0; i < n && resume_id_ != INVALID_TASK_ID; i++) {
+        if (tasks_[i].id == resume_id_)
+            start = i;
+    }
+    resume_id_ = INVALID_TASK_ID;
+
+    for (size_t k = 0; k < n; k++) {
+        // tasks_ may not grow while ticking, so the reference stays valid
+        Task &task = tasks_[(start + k) % n];
+        double now = clock_();
+        if (now - tick_start >= tick_budget_) {
+            resume_id_ = task.id; // the rest waits for the next tick
+            break;
+        }
+
+        if (task.cancelled || now < task.next_run)
+            continue;
+
+        TaskContext context {clock_, now + task.budget};
+        if (task.fn(context) == TaskStatus::Done)
+            task.cancelled = true;
+        else
+            task.next_run = now + task.interval;
+    }
+
+    tasks_.erase(std::remove_if(tasks_.begin(), tasks_.end(), [](const Task &t) { return t.cancelled; }),
+                 tasks_.end());
+    ticking_ = false;
+    merge_pending();
+}
+
+void Scheduler::merge_pending()
+{
+    for (Task &task : pending_) {
+        if (task.cancelled)
+            continue;
+        // stable order: after every queued task of the same or higher priority
+        auto pos = std::upper_bound(tasks_.begin(), tasks_.end(), task.priority,
+                                    [](int priority, const Task &t) { return priority > t.priority; });
+        tasks_.insert(pos, std::move(task));
+    }
+    pending_.clear();
+}
+
+Scheduler::Task *Scheduler::find(TaskId id)
+{
+    return const_cast<Task *>(std::as_const(*this).find(id));
+}
+
+const Scheduler::Task *Scheduler::find(TaskId id) const
+{
+    for (const std::vector<Task> *list : {&tasks_, &pending_}) {
+        auto it = std::find_if(list->begin(), list->end(), [id](const Task &t) { return t.id == id; });
+        if (it != list->end())
+            return &*it;
+    }
+    return nullptr;
+}
+
+namespace
+{
+
+bool main_timer_registered {false};
+
+double steady_seconds()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+void main_timer_callback();
+
+void set_main_timer(bool enable)
+{
+    if (enable == main_timer_registered)
+        return;
+    main_timer_registered = enable;
+    plugin_register(enable ? "timer" : "-timer", (void *)main_timer_callback);
+}
+
+void main_timer_callback()
+{
+    main_scheduler().tick();
+    log_flush();
+    if (main_scheduler().size() == 0)
+        set_main_timer(false);
+}
+
+} // anonymous namespace
+
+Scheduler &main_scheduler()
+{
+    static Scheduler scheduler {steady_seconds};
+    return scheduler;
+}
+
+TaskId schedule_on_main(TaskFn fn, const TaskOptions &options)
+{
+    TaskId id = main_scheduler().schedule(std::move(fn), options);
+    set_main_timer(true);
+    return id;
+}
+
+void shutdown_main_scheduler()
+{
+    main_scheduler().cancel_all();
+    set_main_timer(false);
+}
+
+} // namespace PROJECT_NAME
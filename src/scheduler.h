@@ -0,0 +1,97 @@
+#pragma once
+#include "config.h"
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+using TaskId = unsigned int;
+constexpr TaskId INVALID_TASK_ID = 0;
+
+enum class TaskStatus
+{
+    Continue, // resume the task on a later tick
+    Done      // drop the task
+};
+
+// handed to a task on every slice it gets
+class TaskContext
+{
+public:
+    TaskContext(const std::function<double()> &clock, double deadline) noexcept
+        : clock_(clock), deadline_(deadline)
+    {
+    }
+
+    // true once the task has used up its time budget for this tick
+    bool should_yield() const { return clock_() >= deadline_; }
+
+    double now() const { return clock_(); }
+
+private:
+    const std::function<double()> &clock_;
+    double deadline_;
+};
+
+using TaskFn = std::function<TaskStatus(TaskContext &)>;
+
+struct TaskOptions
+{
+    int priority = 0;        // higher runs first within a tick
+    double budget_ms = 2;    // time slice per tick, checked by the task through should_yield()
+    double interval_ms = 0;  // minimum time between two slices, 0 for every tick
+};
+
+// Multiplexes many background tasks onto a single timer. Tasks are resumable: each slice returns
+// TaskStatus::Continue to be called again later, keeping its progress in its own captures.
+// The clock is injectable (seconds, monotonic), so the scheduler can be driven headless with a
+// simulated timer by calling tick() directly.
+class Scheduler
+{
+public:
+    explicit Scheduler(std::function<double()> clock, double tick_budget_ms = 10);
+
+    TaskId schedule(TaskFn fn, const TaskOptions &options = {});
+
+    // safe to call from inside a running task, including on itself
+    bool cancel(TaskId id);
+    void cancel_all();
+
+    bool is_scheduled(TaskId id) const;
+    size_t size() const;
+
+    // runs one timer tick: due tasks by priority until the tick budget is spent, the next tick
+    // continuing with the first task this one did not get to
+    void tick();
+
+private:
+    struct Task
+    {
+        TaskId id;
+        int priority;
+        double budget, interval, next_run; // seconds
+        TaskFn fn;
+        bool cancelled;
+    };
+
+    void merge_pending();
+    Task *find(TaskId id);
+    const Task *find(TaskId id) const;
+
+    std::function<double()> clock_;
+    double tick_budget_;
+    TaskId last_id_ {INVALID_TASK_ID};
+    TaskId resume_id_ {INVALID_TASK_ID}; // first task the last tick had no budget left for
+    bool ticking_ {false};
+    std::vector<Task> tasks_;   // sorted by priority, then by scheduling order
+    std::vector<Task> pending_; // scheduled while ticking
+};
+
+// the scheduler driven by REAPER's UI timer, registered only while it has tasks
+Scheduler &main_scheduler();
+TaskId schedule_on_main(TaskFn fn, const TaskOptions &options = {});
+void shutdown_main_scheduler();
+
+} // namespace PROJECT_NAME
@@ -0,0 +1,137 @@
+#include "trace.h"
+#include "log.h"
+
+#ifdef ETHLT_ENABLE_TRACING
+
+#include "mapped_file.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+#include <reaper_plugin_functions.h>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <string>
+
+namespace PROJECT_NAME
+{
+
+std::atomic<bool> tracing_enabled {false};
+
+namespace
+{
+
+constexpr size_t TRACE_RING_SIZE = 1 << 16; // power of two
+
+struct TraceEvent
+{
+    // index + 1 of the span stored in the slot, published last so readers can skip torn slots
+    std::atomic<uint64_t> seq;
+    const char *name;
+    uint64_t start_us, end_us;
+    uint32_t thread_id;
+};
+
+TraceEvent trace_ring[TRACE_RING_SIZE];
+std::atomic<uint64_t> trace_head {0};
+std::atomic<uint32_t> next_thread_id {1};
+
+const auto trace_epoch = std::chrono::steady_clock::now();
+
+uint32_t current_thread_id() noexcept
+{
+    thread_local const uint32_t id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void append_json_string(std::string &out, const char *str)
+{
+    out += '"';
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            out += '\\';
+        out += *str;
+    }
+    out += '"';
+}
+
+} // anonymous namespace
+
+uint64_t trace_now_us() noexcept
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now() - trace_epoch).count();
+}
+
+void record_trace_span(const char *name, uint64_t start_us, uint64_t end_us) noexcept
+{
+    const uint64_t index = trace_head.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent &event = trace_ring[index & (TRACE_RING_SIZE - 1)];
+
+    event.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name = name;
+    event.start_us = start_us;
+    event.end_us = end_us;
+    event.thread_id = current_thread_id();
+    event.seq.store(index + 1, std::memory_order_release);
+}
+
+void toggle_tracing()
+{
+    tracing_enabled.store(!tracing_enabled.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+bool is_tracing()
+{
+    return tracing_enabled.load(std::memory_order_relaxed);
+}
+
+void write_trace_file()
+{
+    const uint64_t head = trace_head.load(std::memory_order_acquire);
+    const uint64_t first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char *sep = "";
+    char fields[128];
+    for (uint64_t index = first; index < head; index++) {
+        const TraceEvent &event = trace_ring[index & (TRACE_RING_SIZE - 1)];
+        if (event.seq.load(std::memory_order_acquire) != index + 1)
+            continue; // overwritten or still being written
+
+        const char *name = event.name;
+        const uint64_t start_us = event.start_us, end_us = event.end_us;
+        const uint32_t thread_id = event.thread_id;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (event.seq.load(std::memory_order_relaxed) != index + 1)
+            continue;
+
+        json += sep;
+        json += "{\"ph\":\"X\",\"pid\":1,\"name\":";
+        append_json_string(json, name);
+        snprintf(fields, sizeof(fields), ",\"tid\":%u,\"ts\":%llu,\"dur\":%llu}", thread_id,
+                 static_cast<unsigned long long>(start_us),
+                 static_cast<unsigned long long>(end_us - start_us));
+        json += fields;
+        sep = ",\n";
+    }
+    json += "]}\n";
+
+    char filename[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(filename, sizeof(filename), "ethlt_trace_%Y%m%d_%H%M%S.json", std::localtime(&now));
+    const std::string path = std::string(GetResourcePath()) + "/" + filename;
+
+    FILE *file = open_file(std::filesystem::u8path(path), "wb");
+    if (!file) {
+        ETHLT_LOG(Error, "Cannot write trace file %s", path.c_str());
+        return;
+    }
+    fwrite(json.data(), 1, json.size(), file);
+    fclose(file);
+    ETHLT_LOG(Info, "Trace written to %s", path.c_str());
+}
+
+} // namespace PROJECT_NAME
+
+#endif // ETHLT_ENABLE_TRACING
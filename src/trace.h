@@ -0,0 +1,61 @@
+#pragma once
+#include "config.h"
+#include <atomic>
+#include <cstdint>
+
+// ETHLT_TRACE_SCOPE("name") records a span from the statement to the end of the enclosing block.
+// Spans only exist in builds with ETHLT_ENABLE_TRACING (debug builds, or ETHLT_TRACING=ON), and
+// only record while tracing is switched on at runtime; otherwise they cost a relaxed atomic load.
+#ifdef ETHLT_ENABLE_TRACING
+#define ETHLT_TRACE_CONCAT_DEF(a, b) a##b
+#define ETHLT_TRACE_CONCAT(a, b) ETHLT_TRACE_CONCAT_DEF(a, b)
+#define ETHLT_TRACE_SCOPE(name) ::PROJECT_NAME::TraceSpan ETHLT_TRACE_CONCAT(trace_span_, __LINE__) {name}
+#else
+#define ETHLT_TRACE_SCOPE(name) ((void)0)
+#endif
+
+namespace PROJECT_NAME
+{
+
+#ifdef ETHLT_ENABLE_TRACING
+
+extern std::atomic<bool> tracing_enabled;
+
+uint64_t trace_now_us() noexcept;
+
+// pushes a complete span into the lock-free ring, overwriting the oldest ones when full;
+// name must point to static storage
+void record_trace_span(const char *name, uint64_t start_us, uint64_t end_us) noexcept;
+
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *name) noexcept
+        : name_(tracing_enabled.load(std::memory_order_relaxed) ? name : nullptr),
+          start_us_(name_ ? trace_now_us() : 0)
+    {
+    }
+
+    ~TraceSpan()
+    {
+        if (name_)
+            record_trace_span(name_, start_us_, trace_now_us());
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *name_;
+    uint64_t start_us_;
+};
+
+// actions: flip recording on/off, and write the recorded spans as a Chrome/Perfetto JSON trace
+// into the REAPER resource path
+void toggle_tracing();
+bool is_tracing();
+void write_trace_file();
+
+#endif // ETHLT_ENABLE_TRACING
+
+} // namespace PROJECT_NAME
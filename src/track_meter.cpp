@@ -0,0 +1,266 @@
+#include "track_meter.h"
+#include "log.h"
+#include "scheduler.h"
+#include "core/spsc_ring.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+namespace PROJECT_NAME
+{
+
+namespace
+{
+
+constexpr double WINDOW_SECONDS = 0.3;
+constexpr double MAX_AGE_SECONDS = 1; // older levels are from before playback stopped
+constexpr double DRAIN_INTERVAL_MS = 50;
+
+// one finished window, audio thread -> main thread
+struct Reading
+{
+    int slot;
+    uint32_t generation; // of the metering run that took it
+    uint32_t window;     // per slot, counting from 0
+    float peak, rms;
+};
+
+// per track sums of the audio thread. Written by the main thread only while the hook is not
+// registered, which REAPER synchronises with the audio thread.
+struct AudioSlot
+{
+    MediaTrack *track;
+    double peak, sum_squares, frames;
+    uint32_t window;
+};
+
+AudioSlot audio_slots[MAX_METERED_TRACKS];
+int audio_slot_count = 0;
+uint32_t audio_generation = 0;
+
+// at 64 tracks and 300 ms windows it takes minutes of a stalled main thread to fill up
+core::SpscRing<Reading, 1024> readings;
+std::atomic<uint32_t> dropped_readings {0};
+
+// what the main thread knows of each slot
+struct LatestLevel
+{
+    TrackLevel level;
+    double received; // seconds, steady clock
+    bool valid;
+    uint32_t next_window; // expected next from the audio thread
+    uint32_t min_window;  // readings before this one are forgotten
+};
+
+LatestLevel latest[MAX_METERED_TRACKS];
+ReaProject *metered_project = nullptr;
+std::vector<MediaTrack *> metered_tracks; // main thread's copy, indexed like the slots
+bool hook_registered = false;
+TaskId drain_task = INVALID_TASK_ID;
+
+double steady_seconds()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Audio thread. Track_GetPeakInfo only reads the meter value REAPER keeps for the track, which
+// holds the peak of the block the track last processed; after the block (isPost) that is this one.
+void on_audio_buffer(bool is_post, int len, double srate, audio_hook_register_t *)
+{
+    if (!is_post || len <= 0 || srate <= 0)
+        return;
+
+    const double window_frames = WINDOW_SECONDS * srate;
+    for (int i = 0; i < audio_slot_count; i++) {
+        AudioSlot &slot = audio_slots[i];
+        const double left = Track_GetPeakInfo(slot.track, 0);
+        const double right = Track_GetPeakInfo(slot.track, 1);
+        slot.peak = std::max(slot.peak, std::max(left, right));
+        slot.sum_squares += (left * left + right * right) / 2 * len;
+        slot.frames += len;
+        if (slot.frames < window_frames)
+            continue;
+
+        const Reading reading {i, audio_generation, slot.window++, static_cast<float>(slot.peak),
+                               static_cast<float>(std::sqrt(slot.sum_squares / slot.frames))};
+        if (!readings.try_push(reading))
+            dropped_readings.fetch_add(1, std::memory_order_relaxed);
+        slot.peak = slot.sum_squares = slot.frames = 0;
+    }
+}
+
+audio_hook_register_t audio_hook {on_audio_buffer, nullptr, nullptr, 0, 0, nullptr};
+
+void set_hook(bool enable)
+{
+    if (enable == hook_registered)
+        return;
+    hook_registered = enable;
+    Audio_RegHardwareHook(enable, &audio_hook);
+}
+
+void drain_readings()
+{
+    const double now = steady_seconds();
+    Reading reading;
+    while (readings.try_pop(reading)) {
+        if (reading.generation != audio_generation)
+            continue; // from an earlier run, its slot may be another track now
+        LatestLevel &slot = latest[reading.slot];
+        slot.next_window = reading.window + 1;
+        if (reading.window < slot.min_window)
+            continue;
+        slot.level = {reading.peak, reading.rms};
+        slot.received = now;
+        slot.valid = true;
+    }
+
+    if (const uint32_t dropped = dropped_readings.exchange(0, std::memory_order_relaxed))
+        ETHLT_LOG(Warn, "Track metering: %u readings dropped, the main thread fell behind", dropped);
+}
+
+int slot_of(MediaTrack *track)
+{
+    auto it = std::find(metered_tracks.begin(), metered_tracks.end(), track);
+    return it == metered_tracks.end() ? -1 : static_cast<int>(it - metered_tracks.begin());
+}
+
+bool is_open_project(ReaProject *proj)
+{
+    for (int i = 0; ReaProject *open = EnumProjects(i, nullptr, 0); i++) {
+        if (open == proj)
+            return true;
+    }
+    return false;
+}
+
+// the audio thread must never see a deleted track, so a run with one is restarted without it; the
+// tracks of a closed project tab are all gone, and so is the project ValidatePtr2 would need
+void detach_deleted_tracks()
+{
+    if (!hook_registered)
+        return;
+    std::vector<MediaTrack *> alive;
+    if (is_open_project(metered_project)) {
+        for (MediaTrack *track : metered_tracks) {
+            if (ValidatePtr2(metered_project, track, "MediaTrack*"))
+                alive.push_back(track);
+        }
+    }
+    if (alive.size() == metered_tracks.size())
+        return;
+    if (alive.empty())
+        stop_track_metering();
+    else
+        start_track_metering(alive);
+}
+
+// REAPER calls SetTrackListChange synchronously on the main thread whenever tracks are added,
+// deleted or reordered and when project tabs change, so the slots are detached before the audio
+// thread processes another block
+class TrackListWatch : public IReaperControlSurface
+{
+public:
+    const char *GetTypeString() override { return ""; }
+    const char *GetDescString() override { return ""; }
+    const char *GetConfigString() override { return ""; }
+
+    void SetTrackListChange() override
+    {
+        in_track_list_change = true;
+        detach_deleted_tracks();
+        in_track_list_change = false;
+    }
+
+    bool registered = false;
+    bool in_track_list_change = false; // REAPER is going through its surfaces, this one must stay
+};
+
+TrackListWatch track_list_watch;
+
+TaskStatus check_tracks(TaskContext &)
+{
+    drain_readings();
+    detach_deleted_tracks(); // in case a change went by without a notification
+    return is_track_metering() ? TaskStatus::Continue : TaskStatus::Done;
+}
+
+} // anonymous namespace
+
+bool start_track_metering(const std::vector<MediaTrack *> &tracks)
+{
+    set_hook(false);
+    drain_readings();
+
+    metered_project = EnumProjects(-1, nullptr, 0);
+    metered_tracks.assign(tracks.begin(), tracks.begin() + std::min<size_t>(tracks.size(), MAX_METERED_TRACKS));
+    audio_generation++;
+    audio_slot_count = static_cast<int>(metered_tracks.size());
+    for (int i = 0; i < audio_slot_count; i++) {
+        audio_slots[i] = {metered_tracks[i], 0, 0, 0, 0};
+        latest[i] = {{0, 0}, 0, false, 0, 0};
+    }
+    if (tracks.size() > metered_tracks.size())
+        ETHLT_LOG(Warn, "Track metering: only the first %d of %zu tracks are metered", MAX_METERED_TRACKS,
+                  tracks.size());
+    if (metered_tracks.empty()) {
+        stop_track_metering();
+        return false;
+    }
+
+    if (!track_list_watch.registered) {
+        plugin_register("csurf_inst", &track_list_watch);
+        track_list_watch.registered = true;
+    }
+    set_hook(true);
+    if (!main_scheduler().is_scheduled(drain_task))
+        drain_task = schedule_on_main(check_tracks, {0, 1, DRAIN_INTERVAL_MS});
+    return true;
+}
+
+void stop_track_metering()
+{
+    set_hook(false);
+    audio_slot_count = 0;
+    metered_tracks.clear();
+    main_scheduler().cancel(drain_task);
+    drain_task = INVALID_TASK_ID;
+    if (track_list_watch.registered && !track_list_watch.in_track_list_change) {
+        plugin_register("-csurf_inst", &track_list_watch);
+        track_list_watch.registered = false;
+    }
+}
+
+bool is_track_metering()
+{
+    return hook_registered;
+}
+
+bool get_track_level(MediaTrack *track, TrackLevel &level)
+{
+    const int slot = slot_of(track);
+    if (slot < 0)
+        return false;
+    drain_readings();
+    const LatestLevel &latest_level = latest[slot];
+    if (!latest_level.valid || steady_seconds() - latest_level.received > MAX_AGE_SECONDS)
+        return false;
+    level = latest_level.level;
+    return true;
+}
+
+void forget_track_level(MediaTrack *track)
+{
+    const int slot = slot_of(track);
+    if (slot < 0)
+        return;
+    drain_readings();
+    // the window the audio thread is filling now still has audio from before
+    latest[slot].min_window = latest[slot].next_window + 1;
+    latest[slot].valid = false;
+}
+
+} // namespace PROJECT_NAME
@@ -0,0 +1,36 @@
+#pragma once
+#include "config.h"
+#include <WDL/wdltypes.h> // might be unnecessary in future
+#include <reaper_plugin_functions.h>
+#include <vector>
+
+namespace PROJECT_NAME
+{
+
+constexpr int MAX_METERED_TRACKS = 64;
+
+// a track's level over one metering window, post fader
+struct TrackLevel
+{
+    double peak; // linear
+    double rms;  // linear, of the track meter's block peaks over both channels
+};
+
+// Live track metering from an audio hook. On the audio thread the hook reads the meters of a fixed
+// set of tracks once per block and sums them up into windows of a few hundred milliseconds; each
+// finished window goes to the main thread through a lock-free single-producer/single-consumer
+// ring, so the audio thread neither locks nor allocates. Readings are only taken while audio runs,
+// i.e. during playback or with the tracks armed and monitored. Deleted tracks leave the run as the
+// track list changes, and closing the project tab ends it. Everything below is main thread.
+bool start_track_metering(const std::vector<MediaTrack *> &tracks);
+void stop_track_metering();
+bool is_track_metering();
+
+// the level of the last window finished after the track's last forget_track_level(), and at most
+// a second old; false for tracks not metered or without such a window yet
+bool get_track_level(MediaTrack *track, TrackLevel &level);
+
+// discards the readings so far, e.g. after the track's volume changed
+void forget_track_level(MediaTrack *track);
+
+} // namespace PROJECT_NAME
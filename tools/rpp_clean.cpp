@@ -0,0 +1,235 @@
+#include "mapped_file.h"
+#include "rpp_cleaner.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Applies the Clean Envelope Points rules to .RPP files without opening them in REAPER, e.g.
+//   ethlt_rpp_clean -j 8 -o cleaned/ archive/
+// Directories are searched recursively. Each project is written to a new file, either next to the
+// original as NAME.cleaned.RPP or, with -o, under the output directory with the same relative path.
+// Like the action, it cleans every track and take envelope and the automation items they use, and
+// leaves the master track's envelopes alone.
+
+using namespace PROJECT_NAME;
+namespace fs = std::filesystem;
+
+namespace
+{
+
+constexpr std::string_view CLEANED_SUFFIX = ".cleaned";
+
+struct Options
+{
+    unsigned jobs = 0; // 0 for one per core
+    fs::path output_dir;
+    bool dry_run = false;
+    bool quiet = false;
+};
+
+struct Job
+{
+    fs::path input, output;
+};
+
+struct FileResult : rpp::CleanStats
+{
+    bool ok = true;
+    std::string error;
+};
+
+FileResult process(const Job &job, const Options &options)
+{
+    FileResult result;
+    MappedFile file {job.input};
+    if (!file.is_open()) {
+        result.ok = false;
+        result.error = "cannot open";
+        return result;
+    }
+
+    if (options.dry_run) {
+        rpp::clean_project(file.view(), nullptr, result);
+        return result;
+    }
+
+    std::error_code ec;
+    fs::create_directories(job.output.parent_path(), ec);
+
+    // written next to the target and renamed when complete, so no half-written project is left
+    fs::path partial = job.output;
+    partial += ".partial";
+#ifdef _WIN32
+    FILE *out = _wfopen(partial.c_str(), L"wb");
+#else
+    FILE *out = fopen(partial.c_str(), "wb");
+#endif
+    if (!out) {
+        result.ok = false;
+        result.error = "cannot create " + job.output.string();
+        return result;
+    }
+    static thread_local std::vector<char> out_buffer(1 << 20);
+    setvbuf(out, out_buffer.data(), _IOFBF, out_buffer.size());
+
+    const bool written = rpp::clean_project(file.view(), out, result);
+    if ((fclose(out) != 0 || !written) && result.ok) {
+        result.ok = false;
+        result.error = "write failed";
+    }
+
+    if (result.ok)
+        fs::rename(partial, job.output, ec);
+    if (!result.ok || ec) {
+        fs::remove(partial, ec);
+        if (result.ok) {
+            result.ok = false;
+            result.error = "cannot create " + job.output.string();
+        }
+    }
+    return result;
+}
+
+bool is_project_file(const fs::path &path)
+{
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return tolower(c); });
+    if (ext != ".rpp")
+        return false;
+    const std::string stem = path.stem().string();
+    return stem.size() < CLEANED_SUFFIX.size() ||
+           stem.compare(stem.size() - CLEANED_SUFFIX.size(), CLEANED_SUFFIX.size(), CLEANED_SUFFIX) != 0;
+}
+
+fs::path output_path(const fs::path &input, const fs::path &relative, const Options &options)
+{
+    if (!options.output_dir.empty())
+        return options.output_dir / relative;
+    fs::path output = input;
+    output.replace_extension();
+    output += std::string(CLEANED_SUFFIX);
+    output += input.extension();
+    return output;
+}
+
+bool collect_jobs(const char *arg, const Options &options, std::vector<Job> &jobs)
+{
+    const fs::path root {arg};
+    std::error_code ec;
+    if (fs::is_regular_file(root, ec)) {
+        jobs.push_back({root, output_path(root, root.filename(), options)});
+        return true;
+    }
+    if (!fs::is_directory(root, ec))
+        return false;
+
+    for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->is_regular_file(ec) && is_project_file(it->path()))
+            jobs.push_back({it->path(), output_path(it->path(), it->path().lexically_relative(root), options)});
+    }
+    return !ec;
+}
+
+void print_usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [-j JOBS] [-o OUTPUT_DIR] [--dry-run] [--quiet] PROJECT_OR_DIR...\n"
+            "  writes NAME.cleaned.RPP next to each project, or OUTPUT_DIR/<relative path> with -o\n",
+            argv0);
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    std::vector<const char *> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(arg, "-j") && value) {
+            options.jobs = static_cast<unsigned>(std::max(1, atoi(argv[++i])));
+        } else if (!strcmp(arg, "-o") && value) {
+            options.output_dir = argv[++i];
+        } else if (!strcmp(arg, "--dry-run")) {
+            options.dry_run = true;
+        } else if (!strcmp(arg, "--quiet")) {
+            options.quiet = true;
+        } else if (arg[0] == '-') {
+            print_usage(argv[0]);
+            return 2;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty()) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<Job> jobs;
+    for (const char *input : inputs) {
+        if (!collect_jobs(input, options, jobs)) {
+            fprintf(stderr, "%s: cannot read %s\n", argv[0], input);
+            return 1;
+        }
+    }
+
+    // largest first, so one big project does not start last and hold up the whole run
+    std::vector<uintmax_t> sizes(jobs.size());
+    std::vector<size_t> order(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        std::error_code ec;
+        sizes[i] = fs::file_size(jobs[i].input, ec);
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    std::atomic<size_t> next {0};
+    std::atomic<size_t> failed {0}, total_removed {0}, total_points {0};
+    std::mutex print_mutex;
+
+    auto worker = [&] {
+        for (size_t i; (i = next.fetch_add(1)) < order.size();) {
+            const Job &job = jobs[order[i]];
+            const FileResult result = process(job, options);
+            total_points += result.points;
+            total_removed += result.removed;
+
+            std::lock_guard<std::mutex> lock {print_mutex};
+            if (!result.ok) {
+                failed++;
+                fprintf(stderr, "%s: %s\n", job.input.string().c_str(), result.error.c_str());
+            } else if (!options.quiet) {
+                printf("%s: %zu envelopes, %zu of %zu points removed\n", job.input.string().c_str(),
+                       result.envelopes, result.removed, result.points);
+            }
+        }
+    };
+
+    unsigned thread_count = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    thread_count = static_cast<unsigned>(std::min<size_t>(thread_count, std::max<size_t>(1, jobs.size())));
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < thread_count; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    printf("%zu projects, %zu of %zu points removed%s\n", jobs.size() - failed, total_removed.load(),
+           total_points.load(), failed ? ", some projects failed" : "");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,275 @@
+#pragma once
+#include "config.h"
+#include "core/envelope_cleaner.h"
+#include "core/parse_number.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The .RPP side of ethlt_rpp_clean: a line and block reader for project files and the Clean Envelope
+// Points rules applied to the PT lines of every track and take envelope and of the automation item
+// pools they use. Shared with ethlt_bench, which checks it against the action in the mock host.
+namespace PROJECT_NAME::rpp
+{
+
+struct CleanStats
+{
+    size_t envelopes = 0, points = 0, removed = 0;
+};
+
+// one line of the mapped file, without its line break
+struct Line
+{
+    std::string_view text;    // leading indentation trimmed
+    size_t begin, next_begin; // offsets of this line and the one after it
+};
+
+class LineReader
+{
+public:
+    explicit LineReader(std::string_view data) noexcept : data_(data) { }
+
+    bool next(Line &line) noexcept
+    {
+        if (pos_ >= data_.size())
+            return false;
+        const char *start = data_.data() + pos_;
+        const void *nl = memchr(start, '\n', data_.size() - pos_);
+        const size_t end = nl ? static_cast<const char *>(nl) - data_.data() : data_.size();
+
+        std::string_view text = data_.substr(pos_, end - pos_);
+        if (!text.empty() && text.back() == '\r')
+            text.remove_suffix(1);
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+            text.remove_prefix(1);
+
+        line = {text, pos_, nl ? end + 1 : end};
+        pos_ = line.next_begin;
+        return true;
+    }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+};
+
+inline std::string_view first_token(std::string_view text) noexcept
+{
+    const size_t end = text.find_first_of(" \t");
+    return end == std::string_view::npos ? text : text.substr(0, end);
+}
+
+// splits off the next space-separated field
+inline std::string_view next_field(std::string_view &text) noexcept
+{
+    const size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+        text = {};
+        return {};
+    }
+    text.remove_prefix(begin);
+    const std::string_view field = first_token(text);
+    text.remove_prefix(field.size());
+    return field;
+}
+
+// <VOLENV2, <PANENV, <PARMENV, <AUXVOLENV, <MUTEENV, <PITCHENV ... but not the automation item
+// pool, which is cleaned through the instances that use it
+inline bool is_envelope_tag(std::string_view tag) noexcept
+{
+    while (!tag.empty() && isdigit(static_cast<unsigned char>(tag.back())))
+        tag.remove_suffix(1);
+    return tag.size() > 3 && tag.substr(tag.size() - 3) == "ENV" && tag != "POOLEDENV";
+}
+
+struct Block
+{
+    std::string_view tag;
+    bool in_track;
+};
+
+// walks the block structure, calling on_open(tag, depth, in_track) and on_close(depth) for every
+// block and on_line(line, depth) for everything else; depth counts the blocks the line is in
+template<typename OnOpen, typename OnClose, typename OnLine>
+void walk_blocks(std::string_view data, OnOpen &&on_open, OnClose &&on_close, OnLine &&on_line)
+{
+    std::vector<Block> stack;
+    LineReader reader {data};
+    Line line;
+    while (reader.next(line)) {
+        if (!line.text.empty() && line.text.front() == '<') {
+            const std::string_view tag = first_token(line.text.substr(1));
+            const bool in_track = tag == "TRACK" || (!stack.empty() && stack.back().in_track);
+            stack.push_back({tag, in_track});
+            on_open(tag, stack.size(), in_track);
+        } else if (!line.text.empty() && line.text.front() == '>') {
+            if (stack.empty())
+                continue;
+            on_close(stack.size());
+            stack.pop_back();
+        } else {
+            on_line(line, stack.size());
+        }
+    }
+}
+
+// automation item pools by ID, with the number of track/take envelope instances using them; the
+// action cleans a pooled item once per instance it finds, so the pool is cleaned that many times
+inline std::unordered_map<int, int> count_pool_instances(std::string_view data)
+{
+    std::unordered_map<int, int> instances;
+    size_t env_depth = 0; // depth of the envelope block being read, 0 outside one
+    walk_blocks(
+        data,
+        [&](std::string_view tag, size_t depth, bool in_track) {
+            if (!env_depth && in_track && is_envelope_tag(tag))
+                env_depth = depth;
+        },
+        [&](size_t depth) {
+            if (depth == env_depth)
+                env_depth = 0;
+        },
+        [&](const Line &line, size_t depth) {
+            if (!env_depth || depth != env_depth)
+                return;
+            std::string_view rest = line.text;
+            int pool_id;
+            if (next_field(rest) == "POOLEDENVINST" && core::parse_int(next_field(rest), pool_id))
+                instances[pool_id]++;
+        });
+    return instances;
+}
+
+struct RppPoint
+{
+    double time, value;
+    int shape;
+    size_t begin, next_begin; // the PT line
+};
+
+inline bool parse_point(const Line &line, RppPoint &point)
+{
+    std::string_view rest = line.text;
+    if (next_field(rest) != "PT")
+        return false;
+    point.begin = line.begin;
+    point.next_begin = line.next_begin;
+    point.shape = 0;
+    if (!core::parse_double(next_field(rest), point.time) || !core::parse_double(next_field(rest), point.value))
+        return false;
+    const std::string_view shape = next_field(rest);
+    return shape.empty() || core::parse_int(shape, point.shape);
+}
+
+// copies the input to the output, leaving out the ranges of deleted lines
+class Writer
+{
+public:
+    Writer(std::string_view data, FILE *out) noexcept : data_(data), out_(out) { }
+
+    void skip(size_t begin, size_t end)
+    {
+        copy_until(begin);
+        copied_ = end;
+    }
+
+    bool finish()
+    {
+        copy_until(data_.size());
+        return ok_;
+    }
+
+private:
+    void copy_until(size_t pos)
+    {
+        if (out_ && pos > copied_ && fwrite(data_.data() + copied_, 1, pos - copied_, out_) != pos - copied_)
+            ok_ = false;
+        copied_ = std::max(copied_, pos);
+    }
+
+    std::string_view data_;
+    FILE *out_;
+    size_t copied_ = 0;
+    bool ok_ = true;
+};
+
+// cleans one project, streaming the result to out (nullptr for a dry run); false if writing failed
+inline bool clean_project(std::string_view data, FILE *out, CleanStats &result)
+{
+    const std::unordered_map<int, int> pool_instances = count_pool_instances(data);
+
+    Writer writer {data, out};
+    std::vector<RppPoint> read, kept;
+    size_t block_depth = 0;   // depth of the envelope or pool block being read, 0 outside one
+    int passes = 0;           // how often the points of the current block are cleaned
+    bool pool_header = false; // inside a POOLEDENV before its ID line
+
+    auto flush_block = [&] {
+        result.points += read.size();
+        kept = read;
+        for (int i = 0; i < passes; i++)
+            core::clean_envelope_points(kept);
+        result.removed += read.size() - kept.size();
+
+        auto survivor = kept.begin();
+        for (const RppPoint &point : read) {
+            if (survivor != kept.end() && survivor->begin == point.begin)
+                ++survivor;
+            else
+                writer.skip(point.begin, point.next_begin);
+        }
+        read.clear();
+    };
+
+    walk_blocks(
+        data,
+        [&](std::string_view tag, size_t depth, bool in_track) {
+            if (block_depth)
+                return;
+            if (in_track && is_envelope_tag(tag)) {
+                block_depth = depth;
+                passes = 1;
+                result.envelopes++;
+            } else if (tag == "POOLEDENV") {
+                block_depth = depth;
+                passes = 0;
+                pool_header = true;
+            }
+        },
+        [&](size_t depth) {
+            if (block_depth != depth)
+                return;
+            if (passes)
+                flush_block();
+            read.clear();
+            block_depth = 0;
+            pool_header = false;
+        },
+        [&](const Line &line, size_t line_depth) {
+            if (!block_depth || line_depth != block_depth)
+                return;
+
+            if (pool_header) {
+                std::string_view rest = line.text;
+                int pool_id;
+                if (next_field(rest) == "ID" && core::parse_int(next_field(rest), pool_id)) {
+                    auto it = pool_instances.find(pool_id);
+                    passes = it == pool_instances.end() ? 0 : it->second;
+                    pool_header = false;
+                }
+                return;
+            }
+
+            RppPoint point;
+            if (parse_point(line, point))
+                read.push_back(point);
+        });
+
+    return writer.finish();
+}
+
+} // namespace PROJECT_NAME::rpp